@@ -9,6 +9,7 @@ private:
 	vec2 m_position = vec2();
 	vec2 m_zoom = vec2(1.0f);
 	vec2 m_zoomOffset = vec2(1.0f);
+	vec2 m_screenSize = vec2();
 	std::vector<float> m_viewMatrix = {
 		1.0f, 0.0f, 0.0f, 0.0f,
 		0.0f, 1.0f, 0.0f, 0.0f,
@@ -36,6 +37,9 @@ public:
 	const vec2& getPosition();
 	const std::vector<float>& getViewMatrix() const ;
 	const std::vector<float>& getProjectionMatrix()const;
+	const vec2& getScreenSize() const;
+	vec2 screenToWorld(const vec2& _screen) const;
+	vec2 worldToScreen(const vec2& _world) const;
 };
 
 
@@ -2,6 +2,7 @@
 #define COLOR_RECT_H
 
 #include "math_utils.h"
+#include "render_queue.h"
 #include <glad/glad.h>
 
 class ColorRect final {
@@ -13,6 +14,7 @@ private:
 	vec4 m_color = vec4(1, 1, 1, 1);
 	bool m_visible = true;
 	bool m_ignoreViewMatrix = false;
+	RenderLayer m_layer = RenderLayer::Selection;
 public:
 	ColorRect(class Camera* _cam);
 	~ColorRect();
@@ -26,6 +28,7 @@ public:
 	const vec4& getColor();
 	void setVisible(const bool& flag);
 	void setIgnoreViewMatrix(const bool& flag);
+	void setLayer(const RenderLayer& _layer);
 };
 
 class Singleton4ColorRect{
@@ -38,10 +41,9 @@ public:
 		static Singleton4ColorRect instance;
 		return instance;
 	}
-	unsigned int m_VAO, m_VBO, m_EBO;
+	unsigned int m_VAO;
+	class Shader* m_shader = nullptr;
 	~Singleton4ColorRect() {
-		glDeleteBuffers(1, &m_VBO);
-		glDeleteBuffers(1, &m_EBO);
 		glDeleteVertexArrays(1, &m_VAO);
 	}
 };
@@ -0,0 +1,50 @@
+#ifndef CONTENT_HASH_H
+#define CONTENT_HASH_H
+
+#include <vector>
+#include <string>
+#include <cstddef>
+
+struct ContentDigest {
+	unsigned long long Hash = 0;
+	unsigned long long Power = 1;
+	unsigned long long Length = 0;
+	bool operator==(const ContentDigest& _other) const;
+};
+
+/*
+ * Polynomial hash of a byte string, kept in a bottom-up tree over chunks of varying length.
+ * The digest depends on the bytes alone, not on how they happen to be chunked, so texts compare equal
+ * however they were edited, and an edit only rehashes the chunk it landed in plus the O(log n) path above it.
+ * noteEdit() takes the edit before the bytes change, update() folds the pending edits in once they have.
+ */
+class ContentHash final {
+private:
+	std::vector<ContentDigest> m_nodes{};
+	std::vector<size_t> m_dirty{};
+	size_t m_leafCount = 0;
+	size_t m_chunkCount = 0;
+	bool m_resplit = false;
+private:
+	void assign(const std::vector<ContentDigest>& _chunks);
+	void setChunk(const size_t& _index, const ContentDigest& _digest);
+	size_t locate(size_t _byte) const;
+	size_t getChunkStart(const size_t& _index) const;
+	void resplit(const std::string& _bytes);
+public:
+	static ContentDigest digest(const char* _data, const size_t& _size);
+	static ContentDigest concat(const ContentDigest& _left, const ContentDigest& _right);
+public:
+	void build(const std::string& _bytes);
+	void noteEdit(const size_t& _byte, const size_t& _erasedBytes, const size_t& _insertedBytes);
+	const ContentDigest& update(const std::string& _bytes);
+	bool hasPendingEdits() const;
+};
+
+
+
+
+
+
+
+#endif
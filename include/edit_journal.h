@@ -0,0 +1,81 @@
+#ifndef EDIT_JOURNAL_H
+#define EDIT_JOURNAL_H
+
+#include <string>
+#include <vector>
+#include <mutex>
+#include <thread>
+#include <condition_variable>
+#include <cstddef>
+
+// which version of the file a journal applies to, and the size of its text once loaded
+struct JournalHeader {
+	unsigned long long FileSize = 0;
+	long long FileTime = 0;
+	unsigned long long TextSize = 0;
+};
+
+// replaces Erased bytes of the text at byte Offset with Inserted, all in the loaded UTF-8 text
+struct JournalRecord {
+	unsigned long long Offset = 0;
+	unsigned long long Erased = 0;
+	std::string Inserted{};
+};
+
+/*
+ * Append-only log of the edits made since the file was loaded or saved, kept next to the file
+ * so unsaved work survives a crash.
+ * record() only queues the edit, a worker thread merges runs of typing and erasing
+ * and appends a batch every EDIT_JOURNAL_FLUSH_INTERVAL seconds with a single flush to disk.
+ * The worker also folds everything it wrote into sorted, disjoint edits of the text the header describes,
+ * and once EDIT_JOURNAL_COMPACT_RECORDS records piled up it writes the journal again from those,
+ * so compacting costs what was typed rather than what lies between the first and the last edit.
+ * reset() replaces the whole journal at once, which is how it starts over after a save.
+ * updateHeader() appends a new header instead, for a file that grew at the end while edits were being journaled:
+ * the appended text sits after everything the recorded edits touched, so they replay the same on the longer file.
+ * Nothing is written before the first reset() or start(), so an old journal stays intact until it is restored or dropped.
+ */
+class EditJournal final {
+private:
+	std::string m_path;
+	std::thread m_thread{};
+	std::mutex m_mutex{};
+	std::condition_variable m_wake{};
+	std::vector<JournalRecord> m_pending{};
+	JournalHeader m_rewriteHeader{};
+	std::vector<JournalRecord> m_rewriteRecords{};
+	bool m_rewritePending = false;
+	bool m_removePending = false;
+	bool m_started = false;
+	bool m_stopping = false;
+	JournalHeader m_header{};
+private:
+	void work();
+	static void appendRecord(std::string& _out, const JournalRecord& _record);
+	static void appendHeader(std::string& _out, const JournalHeader& _header);
+	static bool readHeader(const std::string& _in, size_t& _pos, JournalHeader& _header);
+	static bool merge(JournalRecord& _into, const JournalRecord& _next);
+	static void fold(std::vector<JournalRecord>& _folded, const JournalRecord& _edit);
+public:
+	EditJournal(const std::string& _filePath, const JournalHeader& _header);
+	~EditJournal();
+	EditJournal(const EditJournal&) = delete;
+	EditJournal& operator=(const EditJournal&) = delete;
+public:
+	void reset(const JournalHeader& _header, const std::vector<JournalRecord>& _records);
+	void start(const JournalHeader& _header);
+	void record(const size_t& _offset, const size_t& _erased, const std::string& _inserted);
+	void updateHeader(const JournalHeader& _header);
+	void remove();
+	const JournalHeader& getHeader() const;
+	static JournalHeader identify(const std::string& _filePath, const size_t& _textSize);
+	static bool read(const std::string& _filePath, JournalHeader& _header, std::vector<JournalRecord>& _records);
+};
+
+
+
+
+
+
+
+#endif
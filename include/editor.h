@@ -18,11 +18,18 @@
 #include "utils.h"
 #include "math_utils.h"
 #include "macros.h"
+#include "file_loader.h"
+#include "content_hash.h"
 
 enum class EditorState {
 	Normal, NeedToSaved
 };
 
+struct EditorCursor {
+	unsigned long long Position = 0;
+	unsigned long long SelectionPosition = 0;
+};
+
 class Editor final {
 private:
 	GLFWwindow* m_window = nullptr;
@@ -32,6 +39,8 @@ private:
 private:
 	const vec4 m_normalStateColor = hex2rgba(0x00e000);
 	const vec4 m_needToSavedStateColor = hex2rgba(0xe00000);
+	const vec4 m_loadingStateColor = hex2rgba(0x0080e0);
+	const vec4 m_recoveryStateColor = hex2rgba(0xe0a000);
 	EditorState m_state = EditorState::Normal;
 public:
 	class ColorRect* m_stateVisual = nullptr;
@@ -46,17 +55,68 @@ private:
 	unsigned long long m_cursorPosition = 0;
 	unsigned long long m_cursorSelectionPosition = 0;
 	unsigned long long m_cursorSelectionEndPosition = 0;
+	// cursors besides the primary one above, sorted by Position
+	std::vector<EditorCursor> m_extraCursors{};
+	std::vector<class ColorRect*> m_extraCursorRects{};
 	class Tween* m_posTween = nullptr;
 	class Tween* m_zoomTween = nullptr;
+	class Tween* m_scrollTween = nullptr;
+	bool m_scrolled = false;
+	vec2 m_scrollOrigin = vec2();
+	vec2 m_scrollTarget = vec2();
 	class Label* m_label = nullptr;
 	std::string m_filePath = "";
+	TextFormat m_textFormat{};
+	class FileLoader* m_fileLoader = nullptr;
+	// read-only viewer for files of LARGE_FILE_VIEWER_THRESHOLD bytes or more, the label then holds only a window of lines
+	class LargeFileView* m_largeFile = nullptr;
+	size_t m_largeFileFirstLine = 0;
+	size_t m_largeFileLoadedLines = 0;
+	bool m_largeFileAtEnd = false;
+	// follow mode (F7), what other programs append to the file is appended to the buffer
+	class FileFollower* m_follower = nullptr;
+	bool m_following = false;
+	bool m_tailing = false;
+	size_t m_loadedFileSize = 0;
+	// background save, a Ctrl + S while one is running is remembered and started after it
+	class FileSaver* m_fileSaver = nullptr;
+	unsigned long long m_savingRevision = 0;
+	size_t m_savingPrefix = 0;
+	size_t m_savingSuffix = 0;
+	size_t m_savingTextSize = 0;
+	// crash recovery journal, when one is found for the loaded file F8 restores it and any edit drops it
+	class EditJournal* m_journal = nullptr;
+	bool m_recoveryOffered = false;
+	bool m_journalEdited = false;
+	// set while follow mode adds what it read from the file, which the journal must not take for edits
+	bool m_readingFollowedFile = false;
+	class Label* m_recoveryPrompt = nullptr;
+	class Camera* m_recoveryCamera = nullptr;
+	// the text only counts as modified while its digest differs from the one of what the file holds
+	class ContentHash* m_contentHash = nullptr;
+	ContentDigest m_savedDigest{};
+	ContentDigest m_savingDigest{};
+	bool m_savedDigestKnown = false;
+	// how the text maps onto the file as it was loaded or last saved, lets a save copy untouched parts
+	std::vector<SourceSpan> m_sourceMap{};
+	bool m_saveAgain = false;
 	bool m_waitingForEnter = false;
+	int m_fittedLineWidth = -1;
+	bool m_mouseSelecting = false;
+	double m_lastClickTime = -1.0;
+	unsigned long long m_lastClickOffset = 0;
+	double m_cursorBlinkTime = 0.0;
+	class LatencyTracker* m_latency = nullptr;
+	class Label* m_latencyOverlay = nullptr;
+	class Camera* m_overlayCamera = nullptr;
+	double m_latencyOverlayTime = 0.0;
 public:
 	FrameEvent currentFrameEvent{};
 	vec2i windowSize = m_windowSizeOrigin;
 	class Camera* camera = nullptr;
+	class RenderQueue* renderQueue = nullptr;
 private:
-	void updateCursorPos();
+	void updateCursorPos(const bool& followCamera = true);
 	void updateCursorSelectionPos();
 	void tryToPushUpCursor();
 	void tryToPushUpCursorSelection();
@@ -65,6 +125,44 @@ private:
 	void tweenCameraPos(const vec2& amount);
 	void tweenCameraZoom(const vec2& amount);
 	void tweenCameraZoomOffset(const vec2& amount);
+	void scrollCamera(const vec2& amount);
+	void applyTheme();
+	void fitZoomToText();
+	void updateWrapWidth();
+	unsigned long long hitTestMouse();
+	void mousePress(const int& mods, const double& now);
+	void keyPress(const int& key, const int& mods, const bool& repeat);
+	void moveCursor(const int& key, const bool& select);
+	void eraseBackward();
+	void insertNewLine();
+	void insertCharacter(const unsigned int& codepoint);
+	void toggleLatencyOverlay();
+	unsigned long long getVerticalTarget(const unsigned long long& position, const int& direction);
+	void addCursorVertical(const int& direction);
+	void addNextOccurrence();
+	void clearExtraCursors();
+	void normalizeExtraCursors();
+	void moveExtraCursors(const int& key, const bool& select);
+	void replaceAtCursors(const std::wstring& text, const bool& eraseBefore);
+	void drawExtraCursors(const bool& visible);
+	void layoutLatencyOverlay();
+	void layoutStateVisual();
+	void pollFileLoader();
+	void startSave();
+	void pollFileSaver();
+	void openJournal(const size_t& textSize);
+	void setRecoveryOffered(const bool& offered);
+	void rebaseJournal(const size_t& baselineTextSize);
+	void restoreJournal();
+	void pollJournal();
+	void pollContentHash();
+	void updateModifiedState();
+	void toggleFollow();
+	void pollFollower();
+	float getRowsBelowViewport();
+	void updateLargeFileView();
+	bool viewerKeyPress(const int& key, const int& mods);
+	void mouseDrag();
 public:
 	Editor(const char* _filePath = "");
 	~Editor();
@@ -72,7 +170,7 @@ public:
 public:
 	void setWindowFullscreen(const bool& flag);
 public:
-	void charCallback(unsigned int codepoint);
+	void resizeCallback(int width, int height);
 };
 
 
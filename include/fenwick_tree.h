@@ -0,0 +1,30 @@
+#ifndef FENWICK_TREE_H
+#define FENWICK_TREE_H
+
+#include <vector>
+#include <cstddef>
+
+/*
+ * Binary indexed tree of ints: point adds and prefix sums in O(log n),
+ * plus findByPrefix() which maps a running total back to the element that contains it.
+ */
+class FenwickTree final {
+private:
+	std::vector<long long> m_nodes{};
+	size_t m_size = 0;
+public:
+	void build(const std::vector<int>& _values);
+	void add(const size_t& _index, const long long& _delta);
+	long long prefixSum(const size_t& _count) const;
+	long long total() const;
+	size_t findByPrefix(const long long& _value) const;
+	const size_t& size() const;
+};
+
+
+
+
+
+
+
+#endif
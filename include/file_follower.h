@@ -0,0 +1,38 @@
+#ifndef FILE_FOLLOWER_H
+#define FILE_FOLLOWER_H
+
+#include <string>
+#include <fstream>
+#include <cstddef>
+#include "platform.h"
+
+/*
+ * Follows a file that other programs keep appending to, like tail -f.
+ * Only the bytes past the last read offset are read, and only up to the last complete line,
+ * so a line that is still being written waits for its line break and no UTF-8 sequence is split.
+ */
+class FileFollower final {
+private:
+	FileWatcher m_watcher;
+	std::ifstream m_stream{};
+	std::string m_buffer{};
+	size_t m_offset = 0;
+	bool m_pending = true;
+public:
+	FileFollower(const std::string& _path, const size_t& _offset);
+	FileFollower(const FileFollower&) = delete;
+	FileFollower& operator=(const FileFollower&) = delete;
+public:
+	const bool& isOpen() const;
+	bool hasChanged();
+	bool readAppended(std::string& _utf8, bool& _truncated);
+	const size_t& getOffset() const;
+};
+
+
+
+
+
+
+
+#endif
@@ -0,0 +1,62 @@
+#ifndef FILE_LOADER_H
+#define FILE_LOADER_H
+
+#include <string>
+#include <deque>
+#include <vector>
+#include <mutex>
+#include <thread>
+#include <atomic>
+#include <cstddef>
+#include "text_codec.h"
+
+// where a piece of the loaded text came from in the file, Verbatim when encoding the text gives back exactly those bytes
+struct SourceSpan {
+	size_t Text = 0;
+	size_t TextLength = 0;
+	size_t File = 0;
+	size_t FileLength = 0;
+	bool Verbatim = false;
+};
+
+/*
+ * Reads and normalizes a file on a worker thread and hands it over in pieces,
+ * so the first screen can be shown long before a large file has been read to the end.
+ * The first piece is small to get it out quickly, the others are cut at line breaks
+ * so no piece ends inside a UTF-8 sequence or a CRLF pair.
+ * Every piece is also recorded as a SourceSpan, which a later save uses to copy untouched pieces from the file.
+ */
+class FileLoader final {
+private:
+	std::thread m_thread{};
+	mutable std::mutex m_mutex{};
+	std::deque<std::string> m_chunks{};
+	std::vector<SourceSpan> m_sourceMap{};
+	TextFormat m_format{};
+	std::atomic<size_t> m_loadedBytes{ 0 };
+	std::atomic<size_t> m_totalBytes{ 0 };
+	std::atomic<bool> m_finished{ false };
+	std::atomic<bool> m_cancelled{ false };
+private:
+	void work(const std::string& _path);
+public:
+	FileLoader(const std::string& _path);
+	~FileLoader();
+	FileLoader(const FileLoader&) = delete;
+	FileLoader& operator=(const FileLoader&) = delete;
+public:
+	bool takeChunk(std::string& _out);
+	bool isFinished() const;
+	float getProgress() const;
+	TextFormat getFormat() const;
+	size_t getFileSize() const;
+	std::vector<SourceSpan> takeSourceMap();
+};
+
+
+
+
+
+
+
+#endif
@@ -0,0 +1,51 @@
+#ifndef FILE_SAVER_H
+#define FILE_SAVER_H
+
+#include <string>
+#include <vector>
+#include <thread>
+#include <atomic>
+#include <memory>
+#include <cstddef>
+#include "text_codec.h"
+#include "file_loader.h"
+
+/*
+ * Saves a snapshot of the buffer on a worker thread, so a large file never stalls the frame.
+ * The snapshot shares the buffer's bytes when the save starts, edits made while it is written go into the next save.
+ * Verbatim spans of the old file inside the snapshot's unchanged prefix and suffix are copied from the file
+ * as they are, only the edited middle is encoded, and the result becomes the source map of the new file.
+ * The bytes reach the file through writeFileAtomically, so a crash mid-save cannot truncate it.
+ */
+class FileSaver final {
+private:
+	std::thread m_thread{};
+	std::vector<SourceSpan> m_sourceMap{};
+	std::atomic<size_t> m_writtenBytes{ 0 };
+	std::atomic<size_t> m_copiedBytes{ 0 };
+	std::atomic<bool> m_succeeded{ false };
+	std::atomic<bool> m_finished{ false };
+private:
+	void work(const std::string& _path, std::shared_ptr<const std::string> _snapshot, const size_t& _unchangedPrefix, const size_t& _unchangedSuffix,
+		const TextFormat& _format, std::vector<SourceSpan> _sourceMap, const size_t& _sourceSize);
+public:
+	FileSaver(const std::string& _path, std::shared_ptr<const std::string> _snapshot, const size_t& _unchangedPrefix, const size_t& _unchangedSuffix,
+		const TextFormat& _format, std::vector<SourceSpan> _sourceMap, const size_t& _sourceSize);
+	~FileSaver();
+	FileSaver(const FileSaver&) = delete;
+	FileSaver& operator=(const FileSaver&) = delete;
+public:
+	bool isFinished() const;
+	bool hasSucceeded() const;
+	size_t getWrittenBytes() const;
+	size_t getCopiedBytes() const;
+	std::vector<SourceSpan> takeSourceMap();
+};
+
+
+
+
+
+
+
+#endif
@@ -1,9 +1,22 @@
 #ifndef FRAME_EVENT_H
 #define FRAME_EVENT_H
 
+#include <vector>
 
-struct KeyInfo {
-    int scancode, action, mods;
+#define FRAME_EVENT_KEY_COUNT 349
+
+enum class InputEventType {
+    Key, Char, MouseButton, Scroll
+};
+// one GLFW callback, stamped with glfwGetTime() when it arrived
+struct InputEvent {
+    InputEventType type;
+    double time;
+    int code = 0; // key or mouse button
+    int action = 0;
+    int mods = 0;
+    unsigned int codepoint = 0;
+    double xOffset = 0.0, yOffset = 0.0;
 };
 struct MouseInfo {
     struct MousePosition { double xPos, yPos; };
@@ -24,16 +37,16 @@ struct WindowInfo {
 };
 
 struct FrameEvent {
-    KeyInfo justKeys[349];
-    bool pressedKeys[349];
+    std::vector<InputEvent> events{};
+    // tracked from key events, so it stays valid across frames
+    bool pressedKeys[FRAME_EVENT_KEY_COUNT]{};
     MouseInfo mouse;
     WindowInfo window;
     void clear() {
         for (int i = 0; i < 3; i++) mouse.buttons[i] = { -1, 0 };
         for (int i = 0; i < 3; i++) mouse.lastButtons[i] = { -1, 0 };
-        for (int i = 0; i < 349; i++) justKeys[i] = { 0, 0, 0 };
-        for (int i = 0; i < 349; i++) pressedKeys[i] = false;
         mouse.scroll = {};
+        events.clear();
     }
 };
 
@@ -0,0 +1,117 @@
+#ifndef GAP_BUFFER_H
+#define GAP_BUFFER_H
+
+#include <vector>
+#include <cstddef>
+#include <utility>
+#include <algorithm>
+
+#define GAP_BUFFER_MIN_GAP 16
+
+/*
+ * List with a hole where it was last edited: inserting or erasing at the hole is O(1),
+ * moving the hole costs the number of items it passes. Every item that crosses it is
+ * reported with its old and new physical slot, which is how an owner keeps offsets stored
+ * relative to the hole, or a tree over the physical slots, in step.
+ */
+template<typename T>
+class GapBuffer final {
+private:
+	std::vector<T> m_items{};
+	size_t m_gapStart = 0;
+	size_t m_gapEnd = 0;
+public:
+	size_t size() const {
+		return m_items.size() - (m_gapEnd - m_gapStart);
+	}
+	bool empty() const {
+		return size() == 0;
+	}
+	size_t capacity() const {
+		return m_items.size();
+	}
+	const size_t& gapStart() const {
+		return m_gapStart;
+	}
+	bool isGap(const size_t& _physical) const {
+		return _physical >= m_gapStart && _physical < m_gapEnd;
+	}
+	size_t toPhysical(const size_t& _index) const {
+		return _index < m_gapStart ? _index : _index + (m_gapEnd - m_gapStart);
+	}
+	// a slot inside the hole maps to the first item after it
+	size_t toLogical(const size_t& _physical) const {
+		if (_physical < m_gapStart) {
+			return _physical;
+		}
+		return _physical < m_gapEnd ? m_gapStart : _physical - (m_gapEnd - m_gapStart);
+	}
+	T& operator[](const size_t& _index) {
+		return m_items[toPhysical(_index)];
+	}
+	const T& operator[](const size_t& _index) const {
+		return m_items[toPhysical(_index)];
+	}
+	const T& physical(const size_t& _physical) const {
+		return m_items[_physical];
+	}
+	void assign(std::vector<T> _items) {
+		m_items = std::move(_items);
+		m_gapStart = m_items.size();
+		m_items.resize(m_items.size() + GAP_BUFFER_MIN_GAP);
+		m_gapEnd = m_items.size();
+	}
+	void clear() {
+		assign({});
+	}
+	template<typename Moved>
+	void moveGap(const size_t& _index, Moved&& _moved) {
+		while (m_gapStart > _index) {
+			m_gapStart--;
+			m_gapEnd--;
+			m_items[m_gapEnd] = std::move(m_items[m_gapStart]);
+			m_items[m_gapStart] = T{};
+			_moved(m_items[m_gapEnd], m_gapStart, m_gapEnd);
+		}
+		while (m_gapStart < _index) {
+			m_items[m_gapStart] = std::move(m_items[m_gapEnd]);
+			m_items[m_gapEnd] = T{};
+			_moved(m_items[m_gapStart], m_gapEnd, m_gapStart);
+			m_gapStart++;
+			m_gapEnd++;
+		}
+	}
+	// true when the hole had to grow, every physical slot after it has moved then;
+	// it never closes completely, so an item crossing it always changes slot
+	bool insertAtGap(T _item) {
+		bool grown = false;
+		if (m_gapEnd - m_gapStart <= 1) {
+			const size_t grow = GAP_BUFFER_MIN_GAP + m_items.size() / 4;
+			const size_t after = m_items.size() - m_gapEnd;
+			m_items.resize(m_items.size() + grow);
+			std::move_backward(m_items.begin() + m_gapEnd, m_items.begin() + m_gapEnd + after, m_items.end());
+			m_gapEnd += grow;
+			grown = true;
+		}
+		m_items[m_gapStart++] = std::move(_item);
+		return grown;
+	}
+	T eraseAfterGap() {
+		T item = std::move(m_items[m_gapEnd]);
+		m_items[m_gapEnd++] = T{};
+		return item;
+	}
+	T eraseBeforeGap() {
+		T item = std::move(m_items[--m_gapStart]);
+		m_items[m_gapStart] = T{};
+		return item;
+	}
+};
+
+
+
+
+
+
+
+#endif
@@ -0,0 +1,69 @@
+#ifndef GL_STATE_H
+#define GL_STATE_H
+
+#include <glad/glad.h>
+
+#define GL_STATE_TEXTURE_UNITS 8
+
+struct GLStateStats {
+	unsigned long long issued = 0;
+	unsigned long long skipped = 0;
+};
+
+/*
+ * Shadow copy of the GL state this application touches.
+ * Every setter compares against the cached value and only reaches the driver when the value changes.
+ * Anything that changes GL state behind the cache's back must call invalidate().
+ */
+class GLStateCache final {
+private:
+	GLStateCache() {
+
+	}
+	unsigned int m_program = 0;
+	unsigned int m_vertexArray = 0;
+	unsigned int m_arrayBuffer = 0;
+	unsigned int m_activeTextureUnit = 0;
+	unsigned int m_boundTextures[GL_STATE_TEXTURE_UNITS] = {};
+	int m_blendEnabled = -1;
+	int m_depthTestEnabled = -1;
+	int m_multisampleEnabled = -1;
+	GLenum m_blendSrc = GL_NONE;
+	GLenum m_blendDst = GL_NONE;
+	GLStateStats m_stats{};
+	GLStateStats m_frameStats{};
+private:
+	void countIssued();
+	void countSkipped();
+public:
+	static GLStateCache& get() {
+		static GLStateCache instance;
+		return instance;
+	}
+	void useProgram(unsigned int _program);
+	void bindVertexArray(unsigned int _vertexArray);
+	void bindArrayBuffer(unsigned int _buffer);
+	void activeTexture(unsigned int _unit);
+	void bindTexture(unsigned int _unit, unsigned int _texture);
+	void setBlend(bool _enabled, GLenum _src = GL_SRC_ALPHA, GLenum _dst = GL_ONE_MINUS_SRC_ALPHA);
+	void setDepthTest(bool _enabled);
+	void setMultisample(bool _enabled);
+public:
+	void forgetProgram(unsigned int _program);
+	void forgetVertexArray(unsigned int _vertexArray);
+	void forgetBuffer(unsigned int _buffer);
+	void forgetTexture(unsigned int _texture);
+	void invalidate();
+public:
+	const GLStateStats& getStats() const;
+	const GLStateStats& getFrameStats() const;
+	void beginFrame();
+};
+
+
+
+
+
+
+
+#endif
\ No newline at end of file
@@ -0,0 +1,71 @@
+#ifndef GPU_TEXT_LAYOUT_H
+#define GPU_TEXT_LAYOUT_H
+
+#include <vector>
+#include "math_utils.h"
+
+// glyphs the pool may hold beyond what is on screen before the owner should clear it
+#define GPU_TEXT_LAYOUT_POOL_SLACK 65536
+
+/*
+ * Experimental text renderer that lays glyphs out in the vertex shader.
+ * Glyphs live in a pool of codepoints, with the token class in the top byte, next to the x of each glyph from its line start,
+ * which the CPU already knows from the line's advance chunks, so the shader never sums advances.
+ * A line is appended to the pool once and drawn from there for as long as its glyphs do not change,
+ * which keeps scrolling down to uploading the lines that came into view plus the small table of visible lines.
+ * Stale lines are left in the pool until the owner clears it.
+ */
+class GpuTextLayout final {
+private:
+	struct TextureBuffer {
+		unsigned int Buffer = 0;
+		unsigned int Texture = 0;
+		size_t Capacity = 0;
+	};
+	struct PendingGlyph {
+		unsigned int Codepoint;
+		std::vector<unsigned char> Bitmap;
+		int Width, Height;
+		vec2 Bearing;
+		unsigned int AdvanceX;
+	};
+private:
+	class Shader* m_shader = nullptr;
+	class Texture* m_atlas = nullptr;
+	unsigned int m_VAO = 0;
+	TextureBuffer m_metrics{}, m_codepoints{}, m_advances{}, m_lines{};
+	std::vector<unsigned int> m_codepointPool{};
+	std::vector<int> m_advancePool{};
+	std::vector<int> m_lineMirror{};
+	size_t m_instanceCount = 0;
+	std::vector<PendingGlyph> m_pendingGlyphs{};
+	unsigned long long m_uploadedBytes = 0;
+private:
+	static void createTextureBuffer(TextureBuffer& _tb, unsigned int _format);
+	static void deleteTextureBuffer(TextureBuffer& _tb);
+	template<typename T>
+	void uploadChanged(TextureBuffer& _tb, std::vector<T>& _mirror, const std::vector<T>& _data);
+	template<typename T>
+	void appendToPool(TextureBuffer& _tb, std::vector<T>& _pool, const std::vector<T>& _data);
+public:
+	GpuTextLayout();
+	~GpuTextLayout();
+public:
+	void addGlyph(unsigned int _codepoint, const unsigned char* _bitmap, int _width, int _height, const vec2& _bearing, unsigned int _advanceX);
+	void buildAtlas();
+	size_t placeGlyphs(const size_t& _offset, const std::vector<unsigned int>& _codepoints, const std::vector<int>& _advances);
+	void clearGlyphs();
+	size_t getGlyphCount() const;
+	void setLines(const std::vector<int>& _lines, const size_t& _instanceCount);
+	void setPalette(const vec4* _palette);
+	void draw(class RenderQueue* _queue, const float* _viewMatrix, const vec2& _origin, bool _rainbow, float _time) const;
+	const unsigned long long& getUploadedBytes() const;
+};
+
+
+
+
+
+
+
+#endif
\ No newline at end of file
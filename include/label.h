@@ -3,480 +3,611 @@
 
 #include <vector>
 #include <string>
-#include <optional>
+#include <functional>
+#include <unordered_map>
 #include "math_utils.h"
 #include "utils.h"
 #include "macros.h"
+#include "theme.h"
+#include "max_segment_tree.h"
+#include "fenwick_tree.h"
+#include "gap_buffer.h"
+#include "render_queue.h"
+#include "utf8_text.h"
 
 #include <stb_image.h>
 
+#define SYNTAX_HIGHLIGHT_MAX_LENGTH 0xFFFF
+#define LABEL_ADVANCE_CHUNK_SIZE 256
+
+struct TextLayoutPosition {
+	size_t Line = 0;
+	size_t Column = 0;
+	size_t Row = 0;
+	float X = 0.0f;
+};
+
+struct WrappedLine {
+	int WrapWidth = -1;
+	std::vector<int> Breaks{};
+};
+
+// caret advance at Column, a chunk runs on to the next one and an edit only walks the chunk it is in
+struct AdvanceChunk {
+	int Column = 0;
+	int Advance = 0;
+};
+
+// one line of the text: the offsets of its first character and of its line break, how wide it is and where soft wrap breaks it
+struct LineLayout {
+	int Start = 0;
+	int End = 0;
+	int Width = 0;
+	// about every LABEL_ADVANCE_CHUNK_SIZE columns starting with {0, 0}, left empty for lines that are fixed pitch
+	std::vector<AdvanceChunk> Chunks{};
+	WrappedLine Wrap{};
+};
+
+struct GpuLine {
+	size_t FromColumn = 0;
+	size_t ToColumn = 0;
+	unsigned long long Revision = ~0ULL;
+	size_t Offset = ~size_t(0);
+	size_t Count = 0;
+};
+
+// told about every change to the text: the byte offset in the UTF-8 text, the bytes erased there and the bytes inserted instead
+using TextEditListener = std::function<void(const size_t& byte, const size_t& erasedBytes, const std::string& inserted)>;
+
 struct SyntaxHighlight {
-	int Start;
-	int End;
-	vec4 Color;
+	unsigned int Start;
+	unsigned short Length;
+	TokenClass Token;
+	unsigned int getEnd() const { return Start + Length; }
 };
 
 
 class Label final {
 private:
 #if TARGET_LANG == TARGET_LANG_TYPE_CPP
-	vec4 m_NumberLiteralColor = hex2rgba(0xb5cea8);
-	vec4 m_CommentColor = hex2rgba(0x57a64a);
-	vec4 m_StringLiteralColor = hex2rgba(0xd69d85);
-	vec4 m_PreprocessorColor = hex2rgba(0x9b9b9b);
-	vec4 m_KeywordDefaultColor = hex2rgba(0x569cd6);
-	vec4 m_KeywordSpecialColor = hex2rgba(0xd8a0df);
-	vec4 m_FunctionColor = hex2rgba(0xd4b964);
-	vec4 m_MacroColor = hex2rgba(0xbeb7ff);
-	std::map<std::wstring, vec4> m_Keywords = {
-		{L"NULL", m_MacroColor},
-		{L"TRUE", m_MacroColor},
-		{L"FALSE", m_MacroColor},
-		{L"EXIT_SUCCESS", m_MacroColor},
-		{L"EXIT_FAILIURE", m_MacroColor},
-		{L"__FILE__", m_MacroColor},
-		{L"__LINE__", m_MacroColor},
-		{L"__FUNCTION__", m_MacroColor},
-		{L"__DATE__", m_MacroColor},
-		{L"__TIME__", m_MacroColor},
-		{L"__STDC__", m_MacroColor},
-		{L"__STDC_VERSION__", m_MacroColor},
-		{L"__STDC_HOSTED__", m_MacroColor},
-		{L"__cplusplus", m_MacroColor},
-		{L"__OBJC__", m_MacroColor},
-		{L"__ASSEMBLER__", m_MacroColor},
-		{L"__cdecl", m_KeywordDefaultColor},
-		{L"__thiscall", m_KeywordDefaultColor},
-		{L"__stdcall", m_KeywordDefaultColor},
-		{L"__fastcall", m_KeywordDefaultColor},
-		{L"asm", m_KeywordDefaultColor},
-		{L"alignas", m_KeywordDefaultColor},
-		{L"alignof", m_KeywordDefaultColor},
-		{L"and", m_KeywordDefaultColor},
-		{L"and_eq", m_KeywordDefaultColor},
-		{L"auto", m_KeywordDefaultColor},
-		{L"bitand", m_KeywordDefaultColor},
-		{L"bitor", m_KeywordDefaultColor},
-		{L"bool", m_KeywordDefaultColor},
-		{L"break", m_KeywordSpecialColor},
-		{L"case", m_KeywordSpecialColor},
-		{L"catch", m_KeywordSpecialColor},
-		{L"char", m_KeywordDefaultColor},
-		{L"char8_t", m_KeywordDefaultColor},
-		{L"char16_t", m_KeywordDefaultColor},
-		{L"char32_t", m_KeywordDefaultColor},
-		{L"class", m_KeywordDefaultColor},
-		{L"compl", m_KeywordDefaultColor},
-		{L"const", m_KeywordDefaultColor},
-		{L"const_cast", m_KeywordDefaultColor},
-		{L"constexpr", m_KeywordDefaultColor},
-		{L"continue", m_KeywordSpecialColor },
-		{L"decltype", m_KeywordDefaultColor},
-		{L"__declspec", m_KeywordDefaultColor},
-		{L"dllimport", m_KeywordDefaultColor},
-		{L"dllexport", m_KeywordDefaultColor},
-		{L"default", m_KeywordSpecialColor },
-		{L"delete", m_KeywordDefaultColor},
-		{L"do", m_KeywordSpecialColor},
-		{L"double", m_KeywordDefaultColor},
-		{L"dynamic_cast", m_KeywordDefaultColor},
-		{L"else", m_KeywordSpecialColor },
-		{L"enum", m_KeywordDefaultColor},
-		{L"explicit", m_KeywordDefaultColor},
-		{L"extern", m_KeywordDefaultColor},
-		{L"false", m_KeywordDefaultColor},
-		{L"float", m_KeywordDefaultColor},
-		{L"for", m_KeywordSpecialColor},
-		{L"friend", m_KeywordDefaultColor},
-		{L"final", m_KeywordDefaultColor},
-		{L"goto", m_KeywordDefaultColor},
-		{L"if", m_KeywordSpecialColor },
-		{L"inline", m_KeywordDefaultColor},
-		{L"int", m_KeywordDefaultColor},
-		{L"long", m_KeywordDefaultColor},
-		{L"mutable", m_KeywordDefaultColor},
-		{L"namespace", m_KeywordDefaultColor},
-		{L"new", m_KeywordDefaultColor},
-		{L"noexcept", m_KeywordDefaultColor},
-		{L"not", m_KeywordDefaultColor},
-		{L"not_eq", m_KeywordDefaultColor},
-		{L"nullptr", m_KeywordDefaultColor},
-		{L"operator", m_KeywordDefaultColor},
-		{L"or", m_KeywordDefaultColor},
-		{L"or_eq", m_KeywordDefaultColor},
-		{L"private", m_KeywordDefaultColor},
-		{L"protected", m_KeywordDefaultColor},
-		{L"public", m_KeywordDefaultColor},
-		{L"register", m_KeywordDefaultColor},
-		{L"reinterpret_cast", m_KeywordDefaultColor},
-		{L"return", m_KeywordSpecialColor},
-		{L"short", m_KeywordDefaultColor},
-		{L"signed", m_KeywordDefaultColor},
-		{L"sizeof", m_KeywordDefaultColor},
-		{L"static", m_KeywordDefaultColor},
-		{L"static_assert", m_KeywordDefaultColor},
-		{L"static_cast", m_KeywordDefaultColor},
-		{L"struct", m_KeywordDefaultColor},
-		{L"switch", m_KeywordSpecialColor },
-		{L"template", m_KeywordDefaultColor},
-		{L"this", m_KeywordDefaultColor},
-		{L"thread_local", m_KeywordDefaultColor},
-		{L"throw", m_KeywordSpecialColor },
-		{L"true", m_KeywordDefaultColor},
-		{L"try", m_KeywordSpecialColor },
-		{L"typedef", m_KeywordDefaultColor},
-		{L"typeid", m_KeywordDefaultColor},
-		{L"union", m_KeywordDefaultColor},
-		{L"unsigned", m_KeywordDefaultColor},
-		{L"using", m_KeywordDefaultColor},
-		{L"virtual", m_KeywordDefaultColor},
-		{L"void", m_KeywordDefaultColor},
-		{L"volatile", m_KeywordDefaultColor},
-		{L"wchar_t", m_KeywordDefaultColor},
-		{L"while", m_KeywordSpecialColor }, 
-		{L"xor", m_KeywordDefaultColor},
-		{L"xor_eq", m_KeywordDefaultColor},
+	std::map<std::wstring, TokenClass> m_Keywords = {
+		{L"NULL", TokenClass::Macro},
+		{L"TRUE", TokenClass::Macro},
+		{L"FALSE", TokenClass::Macro},
+		{L"EXIT_SUCCESS", TokenClass::Macro},
+		{L"EXIT_FAILIURE", TokenClass::Macro},
+		{L"__FILE__", TokenClass::Macro},
+		{L"__LINE__", TokenClass::Macro},
+		{L"__FUNCTION__", TokenClass::Macro},
+		{L"__DATE__", TokenClass::Macro},
+		{L"__TIME__", TokenClass::Macro},
+		{L"__STDC__", TokenClass::Macro},
+		{L"__STDC_VERSION__", TokenClass::Macro},
+		{L"__STDC_HOSTED__", TokenClass::Macro},
+		{L"__cplusplus", TokenClass::Macro},
+		{L"__OBJC__", TokenClass::Macro},
+		{L"__ASSEMBLER__", TokenClass::Macro},
+		{L"__cdecl", TokenClass::KeywordDefault},
+		{L"__thiscall", TokenClass::KeywordDefault},
+		{L"__stdcall", TokenClass::KeywordDefault},
+		{L"__fastcall", TokenClass::KeywordDefault},
+		{L"asm", TokenClass::KeywordDefault},
+		{L"alignas", TokenClass::KeywordDefault},
+		{L"alignof", TokenClass::KeywordDefault},
+		{L"and", TokenClass::KeywordDefault},
+		{L"and_eq", TokenClass::KeywordDefault},
+		{L"auto", TokenClass::KeywordDefault},
+		{L"bitand", TokenClass::KeywordDefault},
+		{L"bitor", TokenClass::KeywordDefault},
+		{L"bool", TokenClass::KeywordDefault},
+		{L"break", TokenClass::KeywordSpecial},
+		{L"case", TokenClass::KeywordSpecial},
+		{L"catch", TokenClass::KeywordSpecial},
+		{L"char", TokenClass::KeywordDefault},
+		{L"char8_t", TokenClass::KeywordDefault},
+		{L"char16_t", TokenClass::KeywordDefault},
+		{L"char32_t", TokenClass::KeywordDefault},
+		{L"class", TokenClass::KeywordDefault},
+		{L"compl", TokenClass::KeywordDefault},
+		{L"const", TokenClass::KeywordDefault},
+		{L"const_cast", TokenClass::KeywordDefault},
+		{L"constexpr", TokenClass::KeywordDefault},
+		{L"continue", TokenClass::KeywordSpecial },
+		{L"decltype", TokenClass::KeywordDefault},
+		{L"__declspec", TokenClass::KeywordDefault},
+		{L"dllimport", TokenClass::KeywordDefault},
+		{L"dllexport", TokenClass::KeywordDefault},
+		{L"default", TokenClass::KeywordSpecial },
+		{L"delete", TokenClass::KeywordDefault},
+		{L"do", TokenClass::KeywordSpecial},
+		{L"double", TokenClass::KeywordDefault},
+		{L"dynamic_cast", TokenClass::KeywordDefault},
+		{L"else", TokenClass::KeywordSpecial },
+		{L"enum", TokenClass::KeywordDefault},
+		{L"explicit", TokenClass::KeywordDefault},
+		{L"extern", TokenClass::KeywordDefault},
+		{L"false", TokenClass::KeywordDefault},
+		{L"float", TokenClass::KeywordDefault},
+		{L"for", TokenClass::KeywordSpecial},
+		{L"friend", TokenClass::KeywordDefault},
+		{L"final", TokenClass::KeywordDefault},
+		{L"goto", TokenClass::KeywordDefault},
+		{L"if", TokenClass::KeywordSpecial },
+		{L"inline", TokenClass::KeywordDefault},
+		{L"int", TokenClass::KeywordDefault},
+		{L"long", TokenClass::KeywordDefault},
+		{L"mutable", TokenClass::KeywordDefault},
+		{L"namespace", TokenClass::KeywordDefault},
+		{L"new", TokenClass::KeywordDefault},
+		{L"noexcept", TokenClass::KeywordDefault},
+		{L"not", TokenClass::KeywordDefault},
+		{L"not_eq", TokenClass::KeywordDefault},
+		{L"nullptr", TokenClass::KeywordDefault},
+		{L"operator", TokenClass::KeywordDefault},
+		{L"or", TokenClass::KeywordDefault},
+		{L"or_eq", TokenClass::KeywordDefault},
+		{L"private", TokenClass::KeywordDefault},
+		{L"protected", TokenClass::KeywordDefault},
+		{L"public", TokenClass::KeywordDefault},
+		{L"register", TokenClass::KeywordDefault},
+		{L"reinterpret_cast", TokenClass::KeywordDefault},
+		{L"return", TokenClass::KeywordSpecial},
+		{L"short", TokenClass::KeywordDefault},
+		{L"signed", TokenClass::KeywordDefault},
+		{L"sizeof", TokenClass::KeywordDefault},
+		{L"static", TokenClass::KeywordDefault},
+		{L"static_assert", TokenClass::KeywordDefault},
+		{L"static_cast", TokenClass::KeywordDefault},
+		{L"struct", TokenClass::KeywordDefault},
+		{L"switch", TokenClass::KeywordSpecial },
+		{L"template", TokenClass::KeywordDefault},
+		{L"this", TokenClass::KeywordDefault},
+		{L"thread_local", TokenClass::KeywordDefault},
+		{L"throw", TokenClass::KeywordSpecial },
+		{L"true", TokenClass::KeywordDefault},
+		{L"try", TokenClass::KeywordSpecial },
+		{L"typedef", TokenClass::KeywordDefault},
+		{L"typeid", TokenClass::KeywordDefault},
+		{L"union", TokenClass::KeywordDefault},
+		{L"unsigned", TokenClass::KeywordDefault},
+		{L"using", TokenClass::KeywordDefault},
+		{L"virtual", TokenClass::KeywordDefault},
+		{L"void", TokenClass::KeywordDefault},
+		{L"volatile", TokenClass::KeywordDefault},
+		{L"wchar_t", TokenClass::KeywordDefault},
+		{L"while", TokenClass::KeywordSpecial }, 
+		{L"xor", TokenClass::KeywordDefault},
+		{L"xor_eq", TokenClass::KeywordDefault},
 	};
 #elif TARGET_LANG == TARGET_LANG_TYPE_PYTHON
-	vec4 m_NumberLiteralColor = hex2rgba(0xb5cea8);
-	vec4 m_CommentColor = hex2rgba(0x57a64a);
-	vec4 m_StringLiteralColor = hex2rgba(0xce9178);
-	vec4 m_KeywordDefaultColor = hex2rgba(0xd8a0df);
-	vec4 m_KeywordSpecialColor = hex2rgba(0x569cd6);
-	vec4 m_MagicMethodColor = hex2rgba(0xFF0000);
-	vec4 m_BuiltinFunctionColor = hex2rgba(0xff00ff);
-	std::map<std::wstring, vec4> m_Keywords = {
-		{L"abs", m_BuiltinFunctionColor},
-		{L"aiter", m_BuiltinFunctionColor},
-		{L"all", m_BuiltinFunctionColor},
-		{L"anext", m_BuiltinFunctionColor},
-		{L"any", m_BuiltinFunctionColor},
-		{L"ascii", m_BuiltinFunctionColor},
-		{L"bin", m_BuiltinFunctionColor},
-		{L"bool", m_BuiltinFunctionColor},
-		{L"breakpoint", m_BuiltinFunctionColor},
-		{L"bytearray", m_BuiltinFunctionColor},
-		{L"bytes", m_BuiltinFunctionColor},
-		{L"callable", m_BuiltinFunctionColor},
-		{L"chr", m_BuiltinFunctionColor},
-		{L"classmethod", m_BuiltinFunctionColor},
-		{L"compile", m_BuiltinFunctionColor},
-		{L"complex", m_BuiltinFunctionColor},
-		{L"delattr", m_BuiltinFunctionColor},
-		{L"dict", m_BuiltinFunctionColor},
-		{L"dir", m_BuiltinFunctionColor},
-		{L"divmod", m_BuiltinFunctionColor},
-		{L"enumerate", m_BuiltinFunctionColor},
-		{L"eval", m_BuiltinFunctionColor},
-		{L"exec", m_BuiltinFunctionColor},
-		{L"filter", m_BuiltinFunctionColor},
-		{L"float", m_BuiltinFunctionColor},
-		{L"format", m_BuiltinFunctionColor},
-		{L"frozenset", m_BuiltinFunctionColor},
-		{L"getattr", m_BuiltinFunctionColor},
-		{L"globals", m_BuiltinFunctionColor},
-		{L"hasattr", m_BuiltinFunctionColor},
-		{L"hash", m_BuiltinFunctionColor},
-		{L"help", m_BuiltinFunctionColor},
-		{L"hex", m_BuiltinFunctionColor},
-		{L"id", m_BuiltinFunctionColor},
-		{L"input", m_BuiltinFunctionColor},
-		{L"int", m_BuiltinFunctionColor},
-		{L"isinstance", m_BuiltinFunctionColor},
-		{L"issubclass", m_BuiltinFunctionColor},
-		{L"iter", m_BuiltinFunctionColor},
-		{L"len", m_BuiltinFunctionColor},
-		{L"list", m_BuiltinFunctionColor},
-		{L"locals", m_BuiltinFunctionColor},
-		{L"map", m_BuiltinFunctionColor},
-		{L"max", m_BuiltinFunctionColor},
-		{L"memoryview", m_BuiltinFunctionColor},
-		{L"min", m_BuiltinFunctionColor},
-		{L"next", m_BuiltinFunctionColor},
-		{L"object", m_BuiltinFunctionColor},
-		{L"oct", m_BuiltinFunctionColor},
-		{L"open", m_BuiltinFunctionColor},
-		{L"ord", m_BuiltinFunctionColor},
-		{L"pow", m_BuiltinFunctionColor},
-		{L"print", m_BuiltinFunctionColor},
-		{L"property", m_BuiltinFunctionColor},
-		{L"range", m_BuiltinFunctionColor},
-		{L"repr", m_BuiltinFunctionColor},
-		{L"reversed", m_BuiltinFunctionColor},
-		{L"round", m_BuiltinFunctionColor},
-		{L"set", m_BuiltinFunctionColor},
-		{L"setattr", m_BuiltinFunctionColor},
-		{L"slice", m_BuiltinFunctionColor},
-		{L"sorted", m_BuiltinFunctionColor},
-		{L"staticmethod", m_BuiltinFunctionColor},
-		{L"str", m_BuiltinFunctionColor},
-		{L"sum", m_BuiltinFunctionColor},
-		{L"tuple", m_BuiltinFunctionColor},
-		{L"type", m_BuiltinFunctionColor},
-		{L"vars", m_BuiltinFunctionColor},
-		{L"zip", m_BuiltinFunctionColor},
-		{L"__import__", m_BuiltinFunctionColor},
-		{L"super", m_MagicMethodColor},
-		{L"self", m_MagicMethodColor},
-		{L"__new__", m_MagicMethodColor},
-		{L"__init__", m_MagicMethodColor},
-		{L"__del__", m_MagicMethodColor},
-		{L"__eq__", m_MagicMethodColor},
-		{L"__ne__", m_MagicMethodColor},
-		{L"__lt__", m_MagicMethodColor},
-		{L"__gt__", m_MagicMethodColor},
-		{L"__le__", m_MagicMethodColor},
-		{L"__ge__", m_MagicMethodColor},
-		{L"__cmp__", m_MagicMethodColor},
-		{L"__pos__", m_MagicMethodColor},
-		{L"__neg__", m_MagicMethodColor},
-		{L"__abs__", m_MagicMethodColor},
-		{L"__round__", m_MagicMethodColor},
-		{L"__floor__", m_MagicMethodColor},
-		{L"__ceil__", m_MagicMethodColor},
-		{L"__trunc__", m_MagicMethodColor},
-		{L"__invert__", m_MagicMethodColor},
-		{L"__index__", m_MagicMethodColor},
-		{L"__nonzero__", m_MagicMethodColor},
-		{L"__add__", m_MagicMethodColor},
-		{L"__sub__", m_MagicMethodColor},
-		{L"__mul__", m_MagicMethodColor},
-		{L"__floordiv__", m_MagicMethodColor},
-		{L"__div__", m_MagicMethodColor},
-		{L"__truediv__", m_MagicMethodColor},
-		{L"__mod__", m_MagicMethodColor},
-		{L"__divmod__", m_MagicMethodColor},
-		{L"__pow__", m_MagicMethodColor},
-		{L"__lshift__", m_MagicMethodColor},
-		{L"__rshift__", m_MagicMethodColor},
-		{L"__and__", m_MagicMethodColor},
-		{L"__or__", m_MagicMethodColor},
-		{L"__xor__", m_MagicMethodColor},
-		{L"__radd__", m_MagicMethodColor},
-		{L"__rsub__", m_MagicMethodColor},
-		{L"__rmul__", m_MagicMethodColor},
-		{L"__rfloordiv__", m_MagicMethodColor},
-		{L"__rdiv__", m_MagicMethodColor},
-		{L"__rtruediv__", m_MagicMethodColor},
-		{L"__rmod__", m_MagicMethodColor},
-		{L"__rdivmod__", m_MagicMethodColor},
-		{L"__rpow__", m_MagicMethodColor},
-		{L"__rlshift__", m_MagicMethodColor},
-		{L"__rrshift__", m_MagicMethodColor},
-		{L"__rand__", m_MagicMethodColor},
-		{L"__ror__", m_MagicMethodColor},
-		{L"__rxor__", m_MagicMethodColor},
-		{L"__iadd__", m_MagicMethodColor},
-		{L"__isub__", m_MagicMethodColor},
-		{L"__imul__", m_MagicMethodColor},
-		{L"__ifloordiv__", m_MagicMethodColor},
-		{L"__idiv__", m_MagicMethodColor},
-		{L"__itruediv__", m_MagicMethodColor},
-		{L"__imod__", m_MagicMethodColor},
-		{L"__idivmod__", m_MagicMethodColor},
-		{L"__ipow__", m_MagicMethodColor},
-		{L"__ilshift__", m_MagicMethodColor},
-		{L"__irshift__", m_MagicMethodColor},
-		{L"__iand__", m_MagicMethodColor},
-		{L"__ior__", m_MagicMethodColor},
-		{L"__ixor__", m_MagicMethodColor},
-		{L"__int__", m_MagicMethodColor},
-		{L"__long__", m_MagicMethodColor},
-		{L"__float__", m_MagicMethodColor},
-		{L"__complex__", m_MagicMethodColor},
-		{L"__oct__", m_MagicMethodColor},
-		{L"__hex__", m_MagicMethodColor},
-		{L"__index__", m_MagicMethodColor},
-		{L"__coerce__", m_MagicMethodColor},
-		{L"__getattr__", m_MagicMethodColor},
-		{L"__setattr__", m_MagicMethodColor},
-		{L"__delattr__", m_MagicMethodColor},
-		{L"__getattribute__", m_MagicMethodColor},
-		{L"__getitem__", m_MagicMethodColor},
-		{L"__setitem__", m_MagicMethodColor},
-		{L"__delitem__", m_MagicMethodColor},
-		{L"__iter__", m_MagicMethodColor},
-		{L"__contains__", m_MagicMethodColor},
-		{L"__call__", m_MagicMethodColor},
-		{L"__enter__", m_MagicMethodColor},
-		{L"__exit__", m_MagicMethodColor},
-		{L"__getstate__", m_MagicMethodColor},
-		{L"__setstate__", m_MagicMethodColor},
-		{L"__str__", m_MagicMethodColor},
-		{L"__repr__", m_MagicMethodColor},
-		{L"__unicode__", m_MagicMethodColor},
-		{L"__format__", m_MagicMethodColor},
-		{L"__hash__", m_MagicMethodColor},
-		{L"__dir__", m_MagicMethodColor},
-		{L"__sizeof__", m_MagicMethodColor},
-		{L"__len__", m_MagicMethodColor},
-		{L"__reversed__", m_MagicMethodColor},
-		{L"__contains__", m_MagicMethodColor},
-		{L"__missing__", m_MagicMethodColor},
-		{L"__copy__", m_MagicMethodColor},
-		{L"__deepcopy__", m_MagicMethodColor},
-		{L"__getinitargs__", m_MagicMethodColor},
-		{L"__getnewargs__", m_MagicMethodColor},
-		{L"__reduce__", m_MagicMethodColor},
-		{L"__reduce_ex__", m_MagicMethodColor},
-		{L"False", m_KeywordSpecialColor},
-		{L"await", m_KeywordDefaultColor},
-		{L"else", m_KeywordDefaultColor},
-		{L"import", m_KeywordDefaultColor},
-		{L"pass", m_KeywordDefaultColor},
-		{L"None", m_KeywordSpecialColor},
-		{L"break", m_KeywordDefaultColor},
-		{L"except", m_KeywordDefaultColor},
-		{L"in", m_KeywordSpecialColor},
-		{L"raise", m_KeywordDefaultColor},
-		{L"True", m_KeywordSpecialColor},
-		{L"class", m_KeywordSpecialColor},
-		{L"finally", m_KeywordDefaultColor},
-		{L"is", m_KeywordSpecialColor},
-		{L"return", m_KeywordDefaultColor},
-		{L"and", m_KeywordSpecialColor},
-		{L"continue", m_KeywordDefaultColor},
-		{L"for", m_KeywordDefaultColor},
-		{L"lambda", m_KeywordSpecialColor},
-		{L"try", m_KeywordDefaultColor},
-		{L"as", m_KeywordDefaultColor},
-		{L"def", m_KeywordDefaultColor},
-		{L"from", m_KeywordDefaultColor},
-		{L"nonlocal", m_KeywordDefaultColor},
-		{L"while", m_KeywordDefaultColor},
-		{L"assert", m_KeywordDefaultColor},
-		{L"del", m_KeywordDefaultColor},
-		{L"global", m_KeywordDefaultColor},
-		{L"not", m_KeywordSpecialColor},
-		{L"with", m_KeywordDefaultColor},
-		{L"async", m_KeywordDefaultColor},
-		{L"elif", m_KeywordDefaultColor},
-		{L"if", m_KeywordDefaultColor},
-		{L"or", m_KeywordSpecialColor},
-		{L"yield", m_KeywordDefaultColor},
+	std::map<std::wstring, TokenClass> m_Keywords = {
+		{L"abs", TokenClass::BuiltinFunction},
+		{L"aiter", TokenClass::BuiltinFunction},
+		{L"all", TokenClass::BuiltinFunction},
+		{L"anext", TokenClass::BuiltinFunction},
+		{L"any", TokenClass::BuiltinFunction},
+		{L"ascii", TokenClass::BuiltinFunction},
+		{L"bin", TokenClass::BuiltinFunction},
+		{L"bool", TokenClass::BuiltinFunction},
+		{L"breakpoint", TokenClass::BuiltinFunction},
+		{L"bytearray", TokenClass::BuiltinFunction},
+		{L"bytes", TokenClass::BuiltinFunction},
+		{L"callable", TokenClass::BuiltinFunction},
+		{L"chr", TokenClass::BuiltinFunction},
+		{L"classmethod", TokenClass::BuiltinFunction},
+		{L"compile", TokenClass::BuiltinFunction},
+		{L"complex", TokenClass::BuiltinFunction},
+		{L"delattr", TokenClass::BuiltinFunction},
+		{L"dict", TokenClass::BuiltinFunction},
+		{L"dir", TokenClass::BuiltinFunction},
+		{L"divmod", TokenClass::BuiltinFunction},
+		{L"enumerate", TokenClass::BuiltinFunction},
+		{L"eval", TokenClass::BuiltinFunction},
+		{L"exec", TokenClass::BuiltinFunction},
+		{L"filter", TokenClass::BuiltinFunction},
+		{L"float", TokenClass::BuiltinFunction},
+		{L"format", TokenClass::BuiltinFunction},
+		{L"frozenset", TokenClass::BuiltinFunction},
+		{L"getattr", TokenClass::BuiltinFunction},
+		{L"globals", TokenClass::BuiltinFunction},
+		{L"hasattr", TokenClass::BuiltinFunction},
+		{L"hash", TokenClass::BuiltinFunction},
+		{L"help", TokenClass::BuiltinFunction},
+		{L"hex", TokenClass::BuiltinFunction},
+		{L"id", TokenClass::BuiltinFunction},
+		{L"input", TokenClass::BuiltinFunction},
+		{L"int", TokenClass::BuiltinFunction},
+		{L"isinstance", TokenClass::BuiltinFunction},
+		{L"issubclass", TokenClass::BuiltinFunction},
+		{L"iter", TokenClass::BuiltinFunction},
+		{L"len", TokenClass::BuiltinFunction},
+		{L"list", TokenClass::BuiltinFunction},
+		{L"locals", TokenClass::BuiltinFunction},
+		{L"map", TokenClass::BuiltinFunction},
+		{L"max", TokenClass::BuiltinFunction},
+		{L"memoryview", TokenClass::BuiltinFunction},
+		{L"min", TokenClass::BuiltinFunction},
+		{L"next", TokenClass::BuiltinFunction},
+		{L"object", TokenClass::BuiltinFunction},
+		{L"oct", TokenClass::BuiltinFunction},
+		{L"open", TokenClass::BuiltinFunction},
+		{L"ord", TokenClass::BuiltinFunction},
+		{L"pow", TokenClass::BuiltinFunction},
+		{L"print", TokenClass::BuiltinFunction},
+		{L"property", TokenClass::BuiltinFunction},
+		{L"range", TokenClass::BuiltinFunction},
+		{L"repr", TokenClass::BuiltinFunction},
+		{L"reversed", TokenClass::BuiltinFunction},
+		{L"round", TokenClass::BuiltinFunction},
+		{L"set", TokenClass::BuiltinFunction},
+		{L"setattr", TokenClass::BuiltinFunction},
+		{L"slice", TokenClass::BuiltinFunction},
+		{L"sorted", TokenClass::BuiltinFunction},
+		{L"staticmethod", TokenClass::BuiltinFunction},
+		{L"str", TokenClass::BuiltinFunction},
+		{L"sum", TokenClass::BuiltinFunction},
+		{L"tuple", TokenClass::BuiltinFunction},
+		{L"type", TokenClass::BuiltinFunction},
+		{L"vars", TokenClass::BuiltinFunction},
+		{L"zip", TokenClass::BuiltinFunction},
+		{L"__import__", TokenClass::BuiltinFunction},
+		{L"super", TokenClass::MagicMethod},
+		{L"self", TokenClass::MagicMethod},
+		{L"__new__", TokenClass::MagicMethod},
+		{L"__init__", TokenClass::MagicMethod},
+		{L"__del__", TokenClass::MagicMethod},
+		{L"__eq__", TokenClass::MagicMethod},
+		{L"__ne__", TokenClass::MagicMethod},
+		{L"__lt__", TokenClass::MagicMethod},
+		{L"__gt__", TokenClass::MagicMethod},
+		{L"__le__", TokenClass::MagicMethod},
+		{L"__ge__", TokenClass::MagicMethod},
+		{L"__cmp__", TokenClass::MagicMethod},
+		{L"__pos__", TokenClass::MagicMethod},
+		{L"__neg__", TokenClass::MagicMethod},
+		{L"__abs__", TokenClass::MagicMethod},
+		{L"__round__", TokenClass::MagicMethod},
+		{L"__floor__", TokenClass::MagicMethod},
+		{L"__ceil__", TokenClass::MagicMethod},
+		{L"__trunc__", TokenClass::MagicMethod},
+		{L"__invert__", TokenClass::MagicMethod},
+		{L"__index__", TokenClass::MagicMethod},
+		{L"__nonzero__", TokenClass::MagicMethod},
+		{L"__add__", TokenClass::MagicMethod},
+		{L"__sub__", TokenClass::MagicMethod},
+		{L"__mul__", TokenClass::MagicMethod},
+		{L"__floordiv__", TokenClass::MagicMethod},
+		{L"__div__", TokenClass::MagicMethod},
+		{L"__truediv__", TokenClass::MagicMethod},
+		{L"__mod__", TokenClass::MagicMethod},
+		{L"__divmod__", TokenClass::MagicMethod},
+		{L"__pow__", TokenClass::MagicMethod},
+		{L"__lshift__", TokenClass::MagicMethod},
+		{L"__rshift__", TokenClass::MagicMethod},
+		{L"__and__", TokenClass::MagicMethod},
+		{L"__or__", TokenClass::MagicMethod},
+		{L"__xor__", TokenClass::MagicMethod},
+		{L"__radd__", TokenClass::MagicMethod},
+		{L"__rsub__", TokenClass::MagicMethod},
+		{L"__rmul__", TokenClass::MagicMethod},
+		{L"__rfloordiv__", TokenClass::MagicMethod},
+		{L"__rdiv__", TokenClass::MagicMethod},
+		{L"__rtruediv__", TokenClass::MagicMethod},
+		{L"__rmod__", TokenClass::MagicMethod},
+		{L"__rdivmod__", TokenClass::MagicMethod},
+		{L"__rpow__", TokenClass::MagicMethod},
+		{L"__rlshift__", TokenClass::MagicMethod},
+		{L"__rrshift__", TokenClass::MagicMethod},
+		{L"__rand__", TokenClass::MagicMethod},
+		{L"__ror__", TokenClass::MagicMethod},
+		{L"__rxor__", TokenClass::MagicMethod},
+		{L"__iadd__", TokenClass::MagicMethod},
+		{L"__isub__", TokenClass::MagicMethod},
+		{L"__imul__", TokenClass::MagicMethod},
+		{L"__ifloordiv__", TokenClass::MagicMethod},
+		{L"__idiv__", TokenClass::MagicMethod},
+		{L"__itruediv__", TokenClass::MagicMethod},
+		{L"__imod__", TokenClass::MagicMethod},
+		{L"__idivmod__", TokenClass::MagicMethod},
+		{L"__ipow__", TokenClass::MagicMethod},
+		{L"__ilshift__", TokenClass::MagicMethod},
+		{L"__irshift__", TokenClass::MagicMethod},
+		{L"__iand__", TokenClass::MagicMethod},
+		{L"__ior__", TokenClass::MagicMethod},
+		{L"__ixor__", TokenClass::MagicMethod},
+		{L"__int__", TokenClass::MagicMethod},
+		{L"__long__", TokenClass::MagicMethod},
+		{L"__float__", TokenClass::MagicMethod},
+		{L"__complex__", TokenClass::MagicMethod},
+		{L"__oct__", TokenClass::MagicMethod},
+		{L"__hex__", TokenClass::MagicMethod},
+		{L"__index__", TokenClass::MagicMethod},
+		{L"__coerce__", TokenClass::MagicMethod},
+		{L"__getattr__", TokenClass::MagicMethod},
+		{L"__setattr__", TokenClass::MagicMethod},
+		{L"__delattr__", TokenClass::MagicMethod},
+		{L"__getattribute__", TokenClass::MagicMethod},
+		{L"__getitem__", TokenClass::MagicMethod},
+		{L"__setitem__", TokenClass::MagicMethod},
+		{L"__delitem__", TokenClass::MagicMethod},
+		{L"__iter__", TokenClass::MagicMethod},
+		{L"__contains__", TokenClass::MagicMethod},
+		{L"__call__", TokenClass::MagicMethod},
+		{L"__enter__", TokenClass::MagicMethod},
+		{L"__exit__", TokenClass::MagicMethod},
+		{L"__getstate__", TokenClass::MagicMethod},
+		{L"__setstate__", TokenClass::MagicMethod},
+		{L"__str__", TokenClass::MagicMethod},
+		{L"__repr__", TokenClass::MagicMethod},
+		{L"__unicode__", TokenClass::MagicMethod},
+		{L"__format__", TokenClass::MagicMethod},
+		{L"__hash__", TokenClass::MagicMethod},
+		{L"__dir__", TokenClass::MagicMethod},
+		{L"__sizeof__", TokenClass::MagicMethod},
+		{L"__len__", TokenClass::MagicMethod},
+		{L"__reversed__", TokenClass::MagicMethod},
+		{L"__contains__", TokenClass::MagicMethod},
+		{L"__missing__", TokenClass::MagicMethod},
+		{L"__copy__", TokenClass::MagicMethod},
+		{L"__deepcopy__", TokenClass::MagicMethod},
+		{L"__getinitargs__", TokenClass::MagicMethod},
+		{L"__getnewargs__", TokenClass::MagicMethod},
+		{L"__reduce__", TokenClass::MagicMethod},
+		{L"__reduce_ex__", TokenClass::MagicMethod},
+		{L"False", TokenClass::KeywordSpecial},
+		{L"await", TokenClass::KeywordDefault},
+		{L"else", TokenClass::KeywordDefault},
+		{L"import", TokenClass::KeywordDefault},
+		{L"pass", TokenClass::KeywordDefault},
+		{L"None", TokenClass::KeywordSpecial},
+		{L"break", TokenClass::KeywordDefault},
+		{L"except", TokenClass::KeywordDefault},
+		{L"in", TokenClass::KeywordSpecial},
+		{L"raise", TokenClass::KeywordDefault},
+		{L"True", TokenClass::KeywordSpecial},
+		{L"class", TokenClass::KeywordSpecial},
+		{L"finally", TokenClass::KeywordDefault},
+		{L"is", TokenClass::KeywordSpecial},
+		{L"return", TokenClass::KeywordDefault},
+		{L"and", TokenClass::KeywordSpecial},
+		{L"continue", TokenClass::KeywordDefault},
+		{L"for", TokenClass::KeywordDefault},
+		{L"lambda", TokenClass::KeywordSpecial},
+		{L"try", TokenClass::KeywordDefault},
+		{L"as", TokenClass::KeywordDefault},
+		{L"def", TokenClass::KeywordDefault},
+		{L"from", TokenClass::KeywordDefault},
+		{L"nonlocal", TokenClass::KeywordDefault},
+		{L"while", TokenClass::KeywordDefault},
+		{L"assert", TokenClass::KeywordDefault},
+		{L"del", TokenClass::KeywordDefault},
+		{L"global", TokenClass::KeywordDefault},
+		{L"not", TokenClass::KeywordSpecial},
+		{L"with", TokenClass::KeywordDefault},
+		{L"async", TokenClass::KeywordDefault},
+		{L"elif", TokenClass::KeywordDefault},
+		{L"if", TokenClass::KeywordDefault},
+		{L"or", TokenClass::KeywordSpecial},
+		{L"yield", TokenClass::KeywordDefault},
 	};
 #elif TARGET_LANG == TARGET_LANG_TYPE_JAVASCRIPT
-	vec4 m_NumberLiteralColor = hex2rgba(0xb5cea8);
-	vec4 m_CommentColor = hex2rgba(0x57a64a);
-	vec4 m_StringLiteralColor = hex2rgba(0xce9178);
-	vec4 m_KeywordDefaultColor = hex2rgba(0xd8a0df);
-	vec4 m_KeywordSpecialColor = hex2rgba(0x569cd6);
-	vec4 m_FunctionColor = hex2rgba(0xd4b964);
-	vec4 m_DatatypeColor = hex2rgba(0x4ec9b0);
-	std::map<std::wstring, vec4> m_Keywords = {
-		{L"Any", m_DatatypeColor},
-		{L"ArrayBuffer", m_DatatypeColor},
-		{L"Array", m_DatatypeColor},
-		{L"Boolean", m_DatatypeColor},
-		{L"Constant", m_DatatypeColor},
-		{L"Float", m_DatatypeColor},
-		{L"Function", m_DatatypeColor},
-		{L"HTMLElement", m_DatatypeColor},
-		{L"Integer", m_DatatypeColor},
-		{L"null", m_DatatypeColor},
-		{L"Object", m_DatatypeColor},
-		{L"String", m_DatatypeColor},
-		{L"Float32Array", m_DatatypeColor},
-		{L"Uint8Array", m_DatatypeColor},
-		{L"Int8Array", m_DatatypeColor},
-		{L"Uint16Array", m_DatatypeColor},
-		{L"Int16Array", m_DatatypeColor},
-		{L"Uint32Array", m_DatatypeColor},
-		{L"Int32Array", m_DatatypeColor},
-		{L"undefined", m_DatatypeColor},
-		{L"void", m_DatatypeColor},
-		{L"never", m_DatatypeColor},
-		{L"while", m_KeywordSpecialColor},
-		{L"case", m_KeywordSpecialColor},
-		{L"await", m_KeywordSpecialColor},
-		{L"class", m_KeywordDefaultColor},
-		{L"void", m_KeywordDefaultColor},
-		{L"function", m_KeywordDefaultColor},
-		{L"instanceof", m_KeywordDefaultColor},
-		{L"throw", m_KeywordSpecialColor},
-		{L"export", m_KeywordDefaultColor},
-		{L"delete", m_KeywordDefaultColor},
-		{L"catch", m_KeywordSpecialColor},
-		{L"private", m_KeywordDefaultColor},
-		{L"package", m_KeywordDefaultColor},
-		{L"true", m_KeywordDefaultColor},
-		{L"debugger", m_KeywordDefaultColor},
-		{L"extends", m_KeywordDefaultColor},
-		{L"default", m_KeywordSpecialColor},
-		{L"interface", m_KeywordDefaultColor},
-		{L"super", m_KeywordDefaultColor},
-		{L"with", m_KeywordDefaultColor},
-		{L"enum", m_KeywordDefaultColor},
-		{L"if", m_KeywordSpecialColor},
-		{L"return", m_KeywordSpecialColor},
-		{L"switch", m_KeywordSpecialColor},
-		{L"try", m_KeywordSpecialColor},
-		{L"let", m_KeywordDefaultColor},
-		{L"yield", m_KeywordSpecialColor},
-		{L"typeof", m_KeywordDefaultColor},
-		{L"public", m_KeywordDefaultColor},
-		{L"for", m_KeywordSpecialColor},
-		{L"static", m_KeywordDefaultColor},
-		{L"new", m_KeywordDefaultColor},
-		{L"else", m_KeywordSpecialColor},
-		{L"finally", m_KeywordDefaultColor},
-		{L"false", m_KeywordDefaultColor},
-		{L"import", m_KeywordDefaultColor},
-		{L"var", m_KeywordDefaultColor},
-		{L"do", m_KeywordSpecialColor},
-		{L"protected", m_KeywordDefaultColor},
-		{L"in", m_KeywordDefaultColor},
-		{L"implements", m_KeywordDefaultColor},
-		{L"this", m_KeywordDefaultColor},
-		{L"const", m_KeywordDefaultColor},
-		{L"continue", m_KeywordSpecialColor},
-		{L"break", m_KeywordSpecialColor},
+	std::map<std::wstring, TokenClass> m_Keywords = {
+		{L"Any", TokenClass::Datatype},
+		{L"ArrayBuffer", TokenClass::Datatype},
+		{L"Array", TokenClass::Datatype},
+		{L"Boolean", TokenClass::Datatype},
+		{L"Constant", TokenClass::Datatype},
+		{L"Float", TokenClass::Datatype},
+		{L"Function", TokenClass::Datatype},
+		{L"HTMLElement", TokenClass::Datatype},
+		{L"Integer", TokenClass::Datatype},
+		{L"null", TokenClass::Datatype},
+		{L"Object", TokenClass::Datatype},
+		{L"String", TokenClass::Datatype},
+		{L"Float32Array", TokenClass::Datatype},
+		{L"Uint8Array", TokenClass::Datatype},
+		{L"Int8Array", TokenClass::Datatype},
+		{L"Uint16Array", TokenClass::Datatype},
+		{L"Int16Array", TokenClass::Datatype},
+		{L"Uint32Array", TokenClass::Datatype},
+		{L"Int32Array", TokenClass::Datatype},
+		{L"undefined", TokenClass::Datatype},
+		{L"void", TokenClass::Datatype},
+		{L"never", TokenClass::Datatype},
+		{L"while", TokenClass::KeywordSpecial},
+		{L"case", TokenClass::KeywordSpecial},
+		{L"await", TokenClass::KeywordSpecial},
+		{L"class", TokenClass::KeywordDefault},
+		{L"void", TokenClass::KeywordDefault},
+		{L"function", TokenClass::KeywordDefault},
+		{L"instanceof", TokenClass::KeywordDefault},
+		{L"throw", TokenClass::KeywordSpecial},
+		{L"export", TokenClass::KeywordDefault},
+		{L"delete", TokenClass::KeywordDefault},
+		{L"catch", TokenClass::KeywordSpecial},
+		{L"private", TokenClass::KeywordDefault},
+		{L"package", TokenClass::KeywordDefault},
+		{L"true", TokenClass::KeywordDefault},
+		{L"debugger", TokenClass::KeywordDefault},
+		{L"extends", TokenClass::KeywordDefault},
+		{L"default", TokenClass::KeywordSpecial},
+		{L"interface", TokenClass::KeywordDefault},
+		{L"super", TokenClass::KeywordDefault},
+		{L"with", TokenClass::KeywordDefault},
+		{L"enum", TokenClass::KeywordDefault},
+		{L"if", TokenClass::KeywordSpecial},
+		{L"return", TokenClass::KeywordSpecial},
+		{L"switch", TokenClass::KeywordSpecial},
+		{L"try", TokenClass::KeywordSpecial},
+		{L"let", TokenClass::KeywordDefault},
+		{L"yield", TokenClass::KeywordSpecial},
+		{L"typeof", TokenClass::KeywordDefault},
+		{L"public", TokenClass::KeywordDefault},
+		{L"for", TokenClass::KeywordSpecial},
+		{L"static", TokenClass::KeywordDefault},
+		{L"new", TokenClass::KeywordDefault},
+		{L"else", TokenClass::KeywordSpecial},
+		{L"finally", TokenClass::KeywordDefault},
+		{L"false", TokenClass::KeywordDefault},
+		{L"import", TokenClass::KeywordDefault},
+		{L"var", TokenClass::KeywordDefault},
+		{L"do", TokenClass::KeywordSpecial},
+		{L"protected", TokenClass::KeywordDefault},
+		{L"in", TokenClass::KeywordDefault},
+		{L"implements", TokenClass::KeywordDefault},
+		{L"this", TokenClass::KeywordDefault},
+		{L"const", TokenClass::KeywordDefault},
+		{L"continue", TokenClass::KeywordSpecial},
+		{L"break", TokenClass::KeywordSpecial},
 	};
 #endif
 private:
 	class Shader* m_shader = nullptr;
 	class Camera* m_camera = nullptr;
-	std::vector<std::optional<class GlyphTexture*>> m_glyphTextures{};
-	std::map<wchar_t, class GlyphTexture*> m_glyphTextureMap{};
-	unsigned int m_VAO, m_VBO;
+	// glyphs are looked up from the character when drawn, unsupported characters fall back to '?'
+	class GlyphTexture* m_glyphTextures[128]{};
+	unsigned int m_VAO;
+	class GpuTextLayout* m_gpuTextLayout = nullptr;
+	bool m_useGpuTextLayout = false;
+	// where each line near the viewport sits in the glyph pool, and the columns and revision it was built for
+	mutable std::unordered_map<size_t, GpuLine> m_gpuLineCache{};
+	mutable std::vector<unsigned int> m_gpuCodepoints{};
+	mutable std::vector<int> m_gpuAdvances{};
+	mutable std::vector<int> m_gpuLines{};
+	mutable size_t m_gpuInstanceCount = 0;
 private:
 	bool m_enableRainbow = false;
-	std::vector<SyntaxHighlight> m_higilightList{};
+	size_t m_themeIndex = 0;
+	// the gap sits where highlighting last restarted, the starts after it are still owed m_highlightShift
+	GapBuffer<SyntaxHighlight> m_higilightList{};
+	long long m_highlightShift = 0;
 	vec2 m_position = vec2();
-	vec4 m_color = vec4(1, 1, 1, 1);
+	RenderLayer m_layer = RenderLayer::Text;
+	TextEditListener m_editListener{};
 	vec4 m_selectionColor = vec4(0.45, 0.45, 0.45, 0.6);
 	vec2 m_size = vec2(0, 0);
-	std::wstring m_text;
+	Utf8Text m_text{};
 	size_t m_escapeSequenceCount = 0;
-	std::vector<std::pair<int, int>> m_blockList{};
+	// the gap sits after the last edited line, the offsets after it are still owed m_lineShift
+	GapBuffer<LineLayout> m_lines{};
+	int m_lineShift = 0;
+	int m_fixedAdvance = 0;
+	bool m_fixedPitchGlyphs[128]{};
+	// both trees are over the physical slots of m_lines, a slot in the gap is INT_MIN wide and zero rows high
+	MaxSegmentTree m_lineWidthTree{};
+	bool m_softWrap = false;
+	int m_wrapWidth = 0;
+	// rows per line, rebuilt on the next lookup after the wrap layout was reset or the gap grew
+	mutable FenwickTree m_wrapRows{};
+	mutable bool m_wrapRowsDirty = false;
+	size_t m_reflowCursor = 0;
+	bool m_wrapLayoutChanged = false;
+	long long m_prefetchRows = 0;
+	size_t m_usedSelectionRects = 0;
+	size_t m_selectionFrom = 0;
+	size_t m_selectionTo = 0;
+	std::vector<std::pair<size_t, size_t>> m_extraSelections{};
+	bool m_selectionDirty = true;
+	size_t m_selectionFirstLine = 0;
+	size_t m_selectionLastLine = 0;
 	std::vector<class ColorRect*> m_selectionList{};
+	unsigned long long m_revision = 0;
 private:
-	void updateHighlight();
-	void updateBlockList();
+	void updateHighlight(const size_t& from = 0);
+	void updateHighlightAround(const size_t& at, const size_t& erased, const size_t& inserted);
+	void tokenize(const size_t& from, const size_t& resyncFrom, const size_t& covered);
+	SyntaxHighlight getHighlight(const size_t& index) const;
+	void moveHighlightGap(const size_t& index);
+	void updateBlockList(const size_t& fromLine = 0);
+	void measureLine(LineLayout& layout, const size_t& lineStart, const size_t& lineEnd) const;
+	void fillFixedChunks(std::vector<AdvanceChunk>& chunks, const size_t& columns) const;
+	void patchLine(const size_t& line, const size_t& column, const int& delta, const int& advance);
+	void splitLine(const size_t& line, const size_t& column);
+	void joinLine(const size_t& line);
+	int getLineStart(const size_t& line) const;
+	int getLineEnd(const size_t& line) const;
+	void moveLineGap(const size_t& line);
+	void shiftLinesAfter(const size_t& line, const int& delta);
+	void insertLine(const size_t& line, LineLayout layout);
+	void eraseLine(const size_t& line);
+	void rebuildLineTrees();
+	void resetWrappedLines();
+	void syncWrappedLines(const size_t& line, const size_t& column, const int& delta);
+	void reflowLine(const size_t& line, const size_t& column = 0, const int& delta = 0);
+	void reflowLines(const size_t& firstLine, const size_t& lastLine);
+	const FenwickTree& getWrapRows() const;
+	long long getRowsBefore(const size_t& line) const;
+	size_t findLineByRow(const long long& row) const;
+	size_t getRowOf(const size_t& line, const size_t& column) const;
+	int getRowStartColumn(const size_t& line, const size_t& row) const;
+	void rebuildSelection(const size_t& firstVisibleLine, const size_t& lastVisibleLine);
+	void selectRange(size_t& used, const size_t& from, const size_t& to, const size_t& firstVisibleLine, const size_t& lastVisibleLine);
+	void selectColumns(size_t& used, const size_t& line, const size_t& fromColumn, const size_t& toColumn);
+	void setSelectionRect(size_t& used, const size_t& row, const int& x, const int& width);
+	size_t findHighlight(const size_t& index) const;
+	size_t findHighlightStart(const size_t& index) const;
+	size_t findTokenStart(const size_t& index) const;
+	void pushHighlight(const size_t& start, const size_t& end, const TokenClass& token);
+	TokenClass nextGlyphToken(const size_t& index, size_t& highlightIndex, SyntaxHighlight& currentHighlight) const;
+	void applyTheme();
+	class GlyphTexture* findGlyphTexture(const wchar_t& ch) const;
+	bool isFixedPitch(const wchar_t& ch) const;
+	int getGlyphAdvance(const size_t& index) const;
+	size_t getColumnAt(const size_t& line, const float& x) const;
+	void getVisibleRowRange(long long& top, long long& bottom) const;
+	void getVisibleColumnRange(const size_t& line, size_t& fromColumn, size_t& toColumn) const;
+	void drawLineColumns(const size_t& line, const size_t& fromColumn, const size_t& toColumn) const;
+	void drawGpuTextLayout(const size_t& firstLine, const size_t& lastLine) const;
 public:
-	Label(class Camera* _cam, std::wstring _text);
+	Label(class Camera* _cam, Utf8Text _text);
 	~Label();
 	void update();
 	void draw() const;
 public:
 	void setPosition(const vec2& _pos);
+	void setLayer(const RenderLayer& _layer);
+	void setEditListener(TextEditListener _listener);
 	const vec2& getPosition();
 	const vec2& getSize();
-	const std::vector<std::optional<class GlyphTexture*>>& getGlyphTextures();
 	const size_t& getEscapeSequenceCount();
-	int getBelongBlock(const int& at);
-	int getLongestBlock();
-	const std::vector<std::pair<int, int>>& getBlockList();
-	const std::wstring& getText();
+	int getBelongBlock(const int& at) const;
+	int getCaretAdvance(const size_t& offset) const;
+	int getCaretAdvance(const size_t& line, const size_t& column) const;
+	TextLayoutPosition getLayoutPosition(const size_t& offset) const;
+	size_t getOffsetAt(const vec2& world) const;
+	void getWordAt(const size_t& offset, size_t& start, size_t& end) const;
+	int getLongestBlock() const;
+	int getLongestBlockWidth() const;
+	std::pair<int, int> getBlock(const size_t& index) const;
+	size_t getBlockCount() const;
+	void getVisibleLineRange(size_t& firstLine, size_t& lastLine) const;
+	long long getFirstVisibleRow() const;
+	size_t getRowCount() const;
+	void prefetch(const long long& rows);
+	const Utf8Text& getText();
+	const unsigned long long& getRevision() const;
+	void resetChangeTracking();
+	void limitUnchanged(const size_t& prefix, const size_t& suffix);
 	void updateSelection(const size_t& from, const size_t& to);
+	void setExtraSelections(const std::vector<std::pair<size_t, size_t>>& ranges);
 	void addSelectionSection();
 	void eraseSelectionSection(const int& at);
 	void toggleRainbow();
+	void toggleGpuTextLayout();
+	void cycleTheme();
+	void toggleSoftWrap();
+	const bool& isSoftWrap() const;
+	void setWrapWidth(const int& width);
+	bool consumeWrapLayoutChanged();
+	const Theme& getTheme() const;
 public:
+	void setText(Utf8Text _text);
 	void push_back(const wchar_t& ch);
 	void insert(const size_t& at, const wchar_t& ch);
 	void pop_back();
 	void erase(const size_t& at);
+	void applyEdits(const std::vector<TextEdit>& edits);
+	void appendText(const std::string& utf8);
 };
 
 
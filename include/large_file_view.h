@@ -0,0 +1,56 @@
+#ifndef LARGE_FILE_VIEW_H
+#define LARGE_FILE_VIEW_H
+
+#include <string>
+#include <vector>
+#include <mutex>
+#include <thread>
+#include <atomic>
+#include <cstddef>
+#include "platform.h"
+
+/*
+ * Read-only access to a file too large to load, by line number.
+ * The file is read with positional reads rather than mapped, so a log truncated under the view gives short reads
+ * instead of faults, and a 32-bit build never needs the whole file in its address space.
+ * A worker thread records the byte offset of every LARGE_FILE_VIEW_INDEX_STRIDE-th line,
+ * and getLines() reads just the lines asked for, so memory stays at the index plus one window of text.
+ * refresh() reopens the file after it changed size and indexes only the new bytes.
+ */
+class LargeFileView final {
+private:
+	std::string m_path;
+	FileReader* m_file = nullptr;
+	std::thread m_thread{};
+	mutable std::mutex m_mutex{};
+	std::vector<unsigned long long> m_checkpoints{ 0 };
+	std::atomic<size_t> m_lineCount{ 1 };
+	std::atomic<unsigned long long> m_scannedBytes{ 0 };
+	std::atomic<unsigned long long> m_fileSize{ 0 };
+	std::atomic<bool> m_finished{ false };
+	std::atomic<bool> m_cancelled{ false };
+private:
+	void work();
+	unsigned long long findLineStart(const size_t& _line) const;
+	unsigned long long skipLines(unsigned long long _offset, size_t _count) const;
+public:
+	LargeFileView(const std::string& _path);
+	~LargeFileView();
+	LargeFileView(const LargeFileView&) = delete;
+	LargeFileView& operator=(const LargeFileView&) = delete;
+public:
+	const bool& isOpen() const;
+	bool isIndexed() const;
+	float getProgress() const;
+	size_t getLineCount() const;
+	bool refresh();
+	std::string getLines(const size_t& _first, const size_t& _count, size_t& _loadedLines) const;
+};
+
+
+
+
+
+
+
+#endif
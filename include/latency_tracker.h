@@ -0,0 +1,52 @@
+#ifndef LATENCY_TRACKER_H
+#define LATENCY_TRACKER_H
+
+#include <vector>
+#include <string>
+#include <cstddef>
+
+struct LatencySample {
+	double InputTime;
+	double SubmitTime;
+	double CompleteTime; // negative when the frame was not waited on
+};
+
+struct LatencyStats {
+	size_t Count = 0;
+	double Min = 0.0;
+	double Median = 0.0;
+	double P99 = 0.0;
+	double Max = 0.0;
+};
+
+/*
+ * Input-to-photon latency, measured from the GLFW callback timestamp of an input event
+ * to the glfwSwapBuffers() of the first frame that shows its result,
+ * and optionally to the moment the GPU finished that frame.
+ * Keeps the last LATENCY_SAMPLE_COUNT samples in a ring.
+ */
+class LatencyTracker final {
+private:
+	std::vector<double> m_pendingInputs{};
+	std::vector<LatencySample> m_samples{};
+	size_t m_nextSample = 0;
+	unsigned long long m_totalSamples = 0;
+private:
+	static LatencyStats computeStats(std::vector<double>& _values);
+public:
+	void markInput(const double& _time);
+	bool hasPendingInput() const;
+	void endFrame(const double& _submitTime, const double& _completeTime);
+	LatencyStats getSubmitStats() const;
+	LatencyStats getCompleteStats() const;
+	std::wstring getSummary() const;
+	bool dumpReport(const std::string& _path) const;
+};
+
+
+
+
+
+
+
+#endif
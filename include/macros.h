@@ -14,6 +14,8 @@
 #define TAB_SIZE                              4
 // #define BACKGROUND_TEXTURE_PATH               "res/my_background.png" // YOU CAN ACTIVATE THIS LINE
 #define BACKGROUND_TEXTURE_MODULATE_RGB       0.25f
+#define LARGE_FILE_VIEWER_THRESHOLD           (256ULL << 20) // files this large open read-only without being loaded whole
+// #define LATENCY_WAIT_FOR_GPU                  // YOU CAN ACTIVATE THIS LINE, waits on a fence after each input frame to also record GPU completion
 
 
 /* Macros */
@@ -21,9 +23,31 @@
 #define PUSH_ERROR(msg) fprintf(stderr, "Error: %s, in file %s, at line %d\n", msg, __FILE__, __LINE__)
 #define GLYPH_VERTEX_SHADER_PATH "res/glyph_vert.glsl"
 #define GLYPH_FRAGMENT_SHADER_PATH "res/glyph_frag.glsl"
+#define GLYPH_GPU_VERTEX_SHADER_PATH "res/glyph_gpu_vert.glsl"
+#define GLYPH_GPU_FRAGMENT_SHADER_PATH "res/glyph_gpu_frag.glsl"
 #define COLOR_RECT_VERTEX_SHADER_PATH "res/color_rect_vert.glsl"
 #define COLOR_RECT_FRAGMENT_SHADER_PATH "res/color_rect_frag.glsl"
 #define SPRITE_VERTEX_SHADER_PATH "res/sprite_vert.glsl"
 #define SPRITE_FRAGMENT_SHADER_PATH "res/sprite_frag.glsl"
+#define RENDER_QUEUE_STREAM_BUFFER_SIZE (1 << 20)
+#define AUTO_FIT_ZOOM_MARGIN (FONT_SIZE * 2)
+#define SOFT_WRAP_REFLOW_BUDGET 0.002
+#define SOFT_WRAP_REFLOW_BATCH 64
+#define DOUBLE_CLICK_INTERVAL 0.3
+#define CURSOR_BLINK_PERIOD 1.0
+#define SCROLL_LINES_PER_NOTCH 3
+#define SCROLL_INERTIA_DURATION 0.35
+#define SCROLL_PREFETCH_MAX_LINES 256
+#define LATENCY_SAMPLE_COUNT 4096
+#define LATENCY_OVERLAY_INTERVAL 0.5
+#define LATENCY_OVERLAY_SCALE 0.5f
+#define LATENCY_FENCE_TIMEOUT 100000000
+#define LATENCY_REPORT_PATH "latency_report.csv"
+#define FILE_LOADER_FRAME_BUDGET 0.004
+#define LARGE_FILE_VIEW_WINDOW_LINES 1024
+#define EDIT_JOURNAL_SUFFIX ".journal"
+#define EDIT_JOURNAL_FLUSH_INTERVAL 0.25
+#define EDIT_JOURNAL_COMPACT_RECORDS 4096
+#define CONTENT_HASH_CHUNK_SIZE 4096
 
 #endif
\ No newline at end of file
@@ -0,0 +1,30 @@
+#ifndef MAX_SEGMENT_TREE_H
+#define MAX_SEGMENT_TREE_H
+
+#include <vector>
+#include <cstddef>
+
+/*
+ * Bottom-up segment tree answering "largest value and where" over a list of ints.
+ * Point updates and the argmax lookup are O(log n), the maximum itself is O(1).
+ */
+class MaxSegmentTree final {
+private:
+	std::vector<int> m_nodes{};
+	size_t m_leafCount = 0;
+	size_t m_size = 0;
+public:
+	void build(const std::vector<int>& _values);
+	void update(const size_t& _index, const int& _value);
+	int getMax() const;
+	size_t getMaxIndex() const;
+	const size_t& size() const;
+};
+
+
+
+
+
+
+
+#endif
@@ -0,0 +1,103 @@
+#ifndef PLATFORM_H
+#define PLATFORM_H
+
+#include <string>
+#include <vector>
+#include <cstddef>
+
+/*
+ * Read-only view of a whole file, mapped into memory instead of copied.
+ * Paths are narrow strings as they come from the command line.
+ * platform_win32.cpp or platform_posix.cpp provides the implementation, CMake compiles one of them.
+ */
+class MappedFile final {
+private:
+	const unsigned char* m_data = nullptr;
+	size_t m_size = 0;
+	bool m_open = false;
+	// Win32 only, the POSIX layer closes its descriptor as soon as the mapping exists
+	void* m_fileHandle = nullptr;
+	void* m_mappingHandle = nullptr;
+public:
+	MappedFile(const std::string& _path);
+	~MappedFile();
+	MappedFile(const MappedFile&) = delete;
+	MappedFile& operator=(const MappedFile&) = delete;
+public:
+	const bool& isOpen() const;
+	const unsigned char* getData() const;
+	const size_t& getSize() const;
+};
+
+/*
+ * Positional reads from a file that stays open, for files that may shrink while they are read
+ * or that would not fit in the address space of a 32-bit build, where a mapping would fault or fail.
+ * readAt() returns how many bytes it read, fewer than asked only at the current end of the file.
+ */
+class FileReader final {
+private:
+	bool m_open = false;
+	// POSIX only
+	int m_descriptor = -1;
+	// Win32 only
+	void* m_handle = nullptr;
+public:
+	FileReader(const std::string& _path);
+	~FileReader();
+	FileReader(const FileReader&) = delete;
+	FileReader& operator=(const FileReader&) = delete;
+public:
+	const bool& isOpen() const;
+	unsigned long long getSize() const;
+	size_t readAt(const unsigned long long& _offset, void* _buffer, const size_t& _size) const;
+};
+
+/*
+ * Tells, without blocking, whether a file has been written to since the last call.
+ * Linux uses inotify, other POSIX systems compare the size and modification time on every call,
+ * Win32 waits on a change notification for the directory of the file.
+ */
+class FileWatcher final {
+private:
+	std::string m_path;
+	bool m_open = false;
+	// inotify instance, Linux only
+	int m_descriptor = -1;
+	// last seen size and modification time, used where inotify is not available
+	long long m_lastSize = -1;
+	long long m_lastModified = -1;
+	// Win32 only, the change notification handle
+	void* m_handle = nullptr;
+public:
+	FileWatcher(const std::string& _path);
+	~FileWatcher();
+	FileWatcher(const FileWatcher&) = delete;
+	FileWatcher& operator=(const FileWatcher&) = delete;
+public:
+	const bool& isOpen() const;
+	bool consumeChange();
+};
+
+// one part of a file being written, either bytes in memory or, when Data is null, a range of the source file
+struct FilePiece {
+	const char* Data = nullptr;
+	size_t Size = 0;
+	size_t SourceOffset = 0;
+};
+
+// writes the pieces to a temporary file next to _path, flushes it to disk and renames it over _path,
+// so a crash leaves either the old or the new content but never a truncated file.
+// Ranges of _sourcePath are copied by the kernel where it can (copy_file_range) instead of through user space
+bool writeFileAtomically(const std::string& _path, const std::vector<FilePiece>& _pieces, const std::string& _sourcePath = "");
+// appends to the end of _path, creating it if needed, and returns once the bytes are on disk
+bool appendFileDurably(const std::string& _path, const std::string& _bytes);
+
+std::string getExecutableDirectory();
+
+
+
+
+
+
+
+#endif
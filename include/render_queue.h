@@ -0,0 +1,66 @@
+#ifndef RENDER_QUEUE_H
+#define RENDER_QUEUE_H
+
+#include <vector>
+#include <functional>
+#include <glad/glad.h>
+
+enum class RenderLayer : unsigned char {
+	Background, Text, Selection, Highlight, Cursor, Overlay
+};
+
+struct RenderCommand {
+	unsigned long long SortKey = 0;
+	class Shader* Program = nullptr;
+	unsigned int Texture = 0;
+	unsigned int VertexArray = 0;
+	const float* ViewMatrix = nullptr;
+	size_t Stride = 0;
+	size_t VertexOffset = 0;
+	size_t VertexBytes = 0;
+	std::function<void(class Shader*)> Custom{};
+};
+
+struct RenderQueueStats {
+	unsigned long long submitted = 0;
+	unsigned long long drawCalls = 0;
+	unsigned long long merged = 0;
+};
+
+/*
+ * Collects the draws of one frame and issues them in (layer, program, texture) order.
+ * Vertices are kept on the CPU until flush(), where consecutive commands sharing the same state
+ * are written next to each other into the stream buffer and drawn with a single call.
+ * Commands with a Custom callback draw themselves and are never merged.
+ */
+class RenderQueue final {
+private:
+	class StreamBuffer* m_vertexStream = nullptr;
+	std::vector<RenderCommand> m_commands{};
+	std::vector<size_t> m_order{};
+	std::vector<unsigned char> m_vertexArena{};
+	RenderQueueStats m_stats{};
+private:
+	static unsigned long long makeSortKey(RenderLayer _layer, unsigned int _program, unsigned int _texture);
+	static bool canMerge(const RenderCommand& _a, const RenderCommand& _b);
+public:
+	RenderQueue();
+	~RenderQueue();
+public:
+	void submit(RenderLayer _layer, class Shader* _program, unsigned int _texture, unsigned int _vertexArray,
+		const float* _viewMatrix, const void* _vertices, size_t _vertexBytes, size_t _stride);
+	void submitCustom(RenderLayer _layer, class Shader* _program, unsigned int _texture, unsigned int _vertexArray,
+		const std::function<void(class Shader*)>& _custom);
+	void flush(const float* _projectionMatrix);
+public:
+	const unsigned int& getVertexBufferID() const;
+	const RenderQueueStats& getStats() const;
+};
+
+
+
+
+
+
+
+#endif
\ No newline at end of file
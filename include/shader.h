@@ -2,8 +2,9 @@
 #define SHADER_H
 
 #include "math_utils.h"
+#include "gl_state.h"
 
-#include <GLAD/glad.h>
+#include <glad/glad.h>
 
 #include <string>
 #include <iostream>
@@ -32,13 +33,14 @@ public:
         glDeleteShader(fragment);
     }
     ~Shader() {
+        GLStateCache::get().forgetProgram(ID);
         glDeleteProgram(ID);
     }
     void use() {
-        glUseProgram(ID);
+        GLStateCache::get().useProgram(ID);
     }
     void unuse() {
-        glUseProgram(0);
+        GLStateCache::get().useProgram(0);
     }
     void setBool(const std::string& name, bool value) const {
         glUniform1i(glGetUniformLocation(ID, name.c_str()), (int)value);
@@ -55,6 +57,9 @@ public:
     void setVec4(const std::string& name, const vec4& value) const {
         glUniform4f(glGetUniformLocation(ID, name.c_str()), value.x, value.y, value.z, value.w);
     }
+    void setVec4Array(const std::string& name, const vec4* values, int count) const {
+        glUniform4fv(glGetUniformLocation(ID, name.c_str()), count, &values[0].x);
+    }
     void setMat4(const std::string& name, const float* mat) const {
         glUniformMatrix4fv(glGetUniformLocation(ID, name.c_str()), 1, GL_FALSE, mat);
     }
@@ -0,0 +1,41 @@
+#ifndef STREAM_BUFFER_H
+#define STREAM_BUFFER_H
+
+#include <glad/glad.h>
+#include <cstddef>
+
+/*
+ * Ring buffer for per-frame vertex data.
+ * Writes go to fresh space through unsynchronized mappings, so they never wait on draws still reading older data.
+ * When the ring is full, the storage is orphaned and writing restarts at the front.
+ */
+class StreamBuffer final {
+private:
+	unsigned int m_VBO = 0;
+	size_t m_capacity = 0;
+	size_t m_head = 0;
+	size_t m_mappedOffset = 0;
+	bool m_mapped = false;
+	unsigned long long m_orphanCount = 0;
+private:
+	void orphan(size_t _capacity);
+public:
+	StreamBuffer(size_t _capacity);
+	~StreamBuffer();
+public:
+	void* map(size_t _size, size_t _alignment, size_t& _offset);
+	void unmap();
+	size_t push(const void* _data, size_t _size, size_t _alignment);
+public:
+	const unsigned int& getID() const;
+	const size_t& getCapacity() const;
+	const unsigned long long& getOrphanCount() const;
+};
+
+
+
+
+
+
+
+#endif
\ No newline at end of file
@@ -0,0 +1,42 @@
+#ifndef TEXT_CODEC_H
+#define TEXT_CODEC_H
+
+#include <string>
+#include <cstddef>
+
+enum class LineEnding {
+	LF, CRLF
+};
+
+#ifdef _WIN32
+	#define TEXT_CODEC_NATIVE_LINE_ENDING LineEnding::CRLF
+#else
+	#define TEXT_CODEC_NATIVE_LINE_ENDING LineEnding::LF
+#endif
+
+// what decodeUtf8 found in the bytes, so encodeUtf8 can write them back the same way
+struct TextFormat {
+	bool HasBom = false;
+	LineEnding Ending = TEXT_CODEC_NATIVE_LINE_ENDING;
+	bool Valid = true;
+};
+
+/*
+ * UTF-8 <-> wchar_t text (UTF-16 where wchar_t is 16 bits wide, UTF-32 elsewhere).
+ * Decoding skips a byte order mark, turns CRLF into LF and replaces malformed bytes with U+FFFD.
+ * Runs of 16 ASCII characters are converted with SSE2 when it is available and one codepoint at a time otherwise.
+ */
+TextFormat decodeUtf8(const unsigned char* _data, size_t _size, std::wstring& _out);
+// same clean up as decodeUtf8 but the result stays UTF-8, pieces after the first of a file pass _detectBom = false
+TextFormat normalizeUtf8(const unsigned char* _data, size_t _size, std::string& _out, bool _detectBom = true);
+std::string encodeUtf8(const std::wstring& _text, const TextFormat& _format = TextFormat{ false, LineEnding::LF, true });
+// appends UTF-8 text that uses '\n' line breaks to _out, with every line break written as _ending
+void appendWithLineEnding(const char* _data, size_t _size, LineEnding _ending, std::string& _out);
+
+
+
+
+
+
+
+#endif
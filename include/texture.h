@@ -2,7 +2,7 @@
 #define TEXTURE_H
 
 #include <string>
-#include <GLAD/glad.h>
+#include <glad/glad.h>
 #include "math_utils.h"
 
 class Texture {
@@ -0,0 +1,109 @@
+#ifndef THEME_H
+#define THEME_H
+
+#include <vector>
+#include "math_utils.h"
+#include "utils.h"
+#include "macros.h"
+
+#define PALETTE_SIZE 16
+
+enum class TokenClass : unsigned char {
+	Default,
+	NumberLiteral,
+	Comment,
+	StringLiteral,
+	Preprocessor,
+	KeywordDefault,
+	KeywordSpecial,
+	Function,
+	Macro,
+	MagicMethod,
+	BuiltinFunction,
+	Datatype,
+	Count
+};
+
+struct Theme {
+	const char* Name;
+	vec4 Background;
+	vec4 Cursor;
+	vec4 Palette[PALETTE_SIZE];
+};
+
+static Theme makeTheme(const char* _name, int _background, int _cursor, const std::vector<std::pair<TokenClass, int>>& _colors) {
+	Theme theme;
+	theme.Name = _name;
+	theme.Background = hex2rgba(_background);
+	theme.Cursor = hex2rgba(_cursor);
+	for (int i = 0; i < PALETTE_SIZE; i++) {
+		theme.Palette[i] = hex2rgba(0xffffff);
+	}
+	for (const auto& c : _colors) {
+		theme.Palette[(int)c.first] = hex2rgba(c.second);
+	}
+	return theme;
+}
+
+static const std::vector<Theme>& getThemes() {
+	static const std::vector<Theme> themes = {
+#if TARGET_LANG == TARGET_LANG_TYPE_CPP
+		makeTheme("Dark", 0x000000, 0xffffff, {
+			{TokenClass::Default, 0xffffff},
+			{TokenClass::NumberLiteral, 0xb5cea8},
+			{TokenClass::Comment, 0x57a64a},
+			{TokenClass::StringLiteral, 0xd69d85},
+			{TokenClass::Preprocessor, 0x9b9b9b},
+			{TokenClass::KeywordDefault, 0x569cd6},
+			{TokenClass::KeywordSpecial, 0xd8a0df},
+			{TokenClass::Function, 0xd4b964},
+			{TokenClass::Macro, 0xbeb7ff},
+		}),
+#elif TARGET_LANG == TARGET_LANG_TYPE_PYTHON
+		makeTheme("Dark", 0x000000, 0xffffff, {
+			{TokenClass::Default, 0xffffff},
+			{TokenClass::NumberLiteral, 0xb5cea8},
+			{TokenClass::Comment, 0x57a64a},
+			{TokenClass::StringLiteral, 0xce9178},
+			{TokenClass::KeywordDefault, 0xd8a0df},
+			{TokenClass::KeywordSpecial, 0x569cd6},
+			{TokenClass::MagicMethod, 0xff0000},
+			{TokenClass::BuiltinFunction, 0xff00ff},
+		}),
+#elif TARGET_LANG == TARGET_LANG_TYPE_JAVASCRIPT
+		makeTheme("Dark", 0x000000, 0xffffff, {
+			{TokenClass::Default, 0xffffff},
+			{TokenClass::NumberLiteral, 0xb5cea8},
+			{TokenClass::Comment, 0x57a64a},
+			{TokenClass::StringLiteral, 0xce9178},
+			{TokenClass::KeywordDefault, 0xd8a0df},
+			{TokenClass::KeywordSpecial, 0x569cd6},
+			{TokenClass::Function, 0xd4b964},
+			{TokenClass::Datatype, 0x4ec9b0},
+		}),
+#endif
+		makeTheme("Light", 0xffffff, 0x000000, {
+			{TokenClass::Default, 0x000000},
+			{TokenClass::NumberLiteral, 0x098658},
+			{TokenClass::Comment, 0x008000},
+			{TokenClass::StringLiteral, 0xa31515},
+			{TokenClass::Preprocessor, 0x808080},
+			{TokenClass::KeywordDefault, 0x0000ff},
+			{TokenClass::KeywordSpecial, 0x8f08c4},
+			{TokenClass::Function, 0x74531f},
+			{TokenClass::Macro, 0x6f008a},
+			{TokenClass::MagicMethod, 0xc00000},
+			{TokenClass::BuiltinFunction, 0x795e26},
+			{TokenClass::Datatype, 0x2b91af},
+		}),
+	};
+	return themes;
+}
+
+
+
+
+
+
+
+#endif
\ No newline at end of file
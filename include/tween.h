@@ -42,6 +42,7 @@ class Tween final{
 private:
 	std::vector<TweenInfo> m_currentList{};
 	bool m_isPlaying = false;
+	double m_lastUpdateTime = 0.0;
 public:
 	Tween();
 	~Tween();
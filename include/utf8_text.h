@@ -0,0 +1,108 @@
+#ifndef UTF8_TEXT_H
+#define UTF8_TEXT_H
+
+#include <string>
+#include <vector>
+#include <memory>
+#include <cstddef>
+#include "text_codec.h"
+
+// replaces EraseCount characters at Offset with Text, Offset is in the text before the batch is applied
+struct TextEdit {
+	size_t Offset = 0;
+	size_t EraseCount = 0;
+	std::wstring Text{};
+};
+
+/*
+ * Text stored as UTF-8 but addressed by codepoint index, like the std::wstring it replaces.
+ * A sparse index keeps the byte offset of roughly every UTF8_TEXT_INDEX_STRIDE-th codepoint,
+ * so a lookup is a binary search plus a short walk, and no walk at all inside an all-ASCII chunk.
+ * The last position looked up is cached, which makes front-to-back scans O(1) per character.
+ * Edits shift the entries after the edited chunk and split a chunk once it grows past twice the stride.
+ * A batch of edits is spliced in one pass that moves each byte at most once.
+ * It also remembers how many bytes at the front and back no edit has touched since resetChangeTracking(),
+ * which is what lets a save copy those parts straight from the old file.
+ * Copies share the bytes until one of them is edited, so handing a snapshot to another thread costs nothing.
+ */
+class Utf8Text final {
+private:
+	struct IndexEntry {
+		size_t Codepoint;
+		size_t Byte;
+	};
+private:
+	std::shared_ptr<std::string> m_bytes = std::make_shared<std::string>();
+	size_t m_size = 0;
+	std::vector<IndexEntry> m_index{ IndexEntry{ 0, 0 } };
+	// chunk of the last lookup, plus where the walk inside it stopped
+	mutable size_t m_cacheEntry = 0;
+	mutable size_t m_cacheChunkStart = 0;
+	mutable size_t m_cacheChunkEnd = 0;
+	mutable size_t m_cacheChunkByte = 0;
+	mutable bool m_cacheAscii = false;
+	mutable size_t m_cacheCodepoint = 0;
+	mutable size_t m_cacheByte = 0;
+	size_t m_unchangedPrefix = 0;
+	size_t m_unchangedSuffix = 0;
+private:
+	wchar_t lookup(const size_t& _index) const;
+	void indexFrom(const size_t& _entry);
+	size_t indexBetween(const size_t& _entry, const size_t& _byteEnd);
+	size_t findEntry(const size_t& _index) const;
+	size_t findEntryByByte(const size_t& _byte) const;
+	size_t getEntryEnd(const size_t& _entry, size_t& _byteEnd) const;
+	void shiftEntries(const size_t& _entry, const long long& _codepoints, const long long& _bytes);
+	void resetCache() const;
+	void noteEdit(const size_t& _byte, const size_t& _erasedBytes);
+	std::string& mutableBytes();
+public:
+	static constexpr size_t npos = size_t(-1);
+public:
+	Utf8Text() = default;
+	Utf8Text(const Utf8Text&) = default;
+	Utf8Text& operator=(const Utf8Text&) = default;
+	// a moved-from text is left empty rather than without bytes
+	Utf8Text(Utf8Text&& _other) noexcept;
+	Utf8Text& operator=(Utf8Text&& _other) noexcept;
+	Utf8Text(const std::wstring& _text);
+	static Utf8Text fromUtf8(std::string _bytes);
+public:
+	const size_t& size() const;
+	bool empty() const;
+	inline wchar_t operator[](const size_t& _index) const {
+		if (m_cacheAscii && _index >= m_cacheChunkStart && _index < m_cacheChunkEnd) {
+			return wchar_t((unsigned char)(*m_bytes)[m_cacheChunkByte + (_index - m_cacheChunkStart)]);
+		}
+		return lookup(_index);
+	}
+	size_t getByteOffset(const size_t& _index) const;
+	size_t getCodepointIndex(const size_t& _byte) const;
+	std::wstring substr(const size_t& _from, const size_t& _count) const;
+	size_t find(const std::wstring& _needle, const size_t& _from) const;
+	const std::string& getBytes() const;
+	std::shared_ptr<const std::string> shareBytes() const;
+	std::string encode(const TextFormat& _format) const;
+	const size_t& getUnchangedPrefix() const;
+	const size_t& getUnchangedSuffix() const;
+public:
+	void reserve(const size_t& _bytes);
+	void insert(const size_t& _at, const wchar_t& _ch);
+	void erase(const size_t& _at);
+	void pop_back();
+	void append(const Utf8Text& _other, const size_t& _from, const size_t& _count);
+	void append(const std::wstring& _text);
+	void appendUtf8(const std::string& _bytes);
+	void swap(Utf8Text& _other);
+	void resetChangeTracking();
+	void limitUnchanged(const size_t& _prefix, const size_t& _suffix);
+	void applyEdits(const std::vector<TextEdit>& _edits);
+};
+
+
+
+
+
+
+
+#endif
@@ -3,7 +3,6 @@
 #define _CRT_SECURE_NO_WARNINGS
 
 #include <algorithm>
-#include <Windows.h>
 #include <string>
 #include <locale>
 #include <map>
@@ -24,13 +23,17 @@
 #include <utility>
 
 #include "math_utils.h"
+#include "gl_state.h"
+#include "platform.h"
+#include "text_codec.h"
 
-static std::string multibyte2utf8(std::wstring str) {
-    int utf8_num = WideCharToMultiByte(CP_UTF8, 0, str.c_str(), -1, NULL, 0, NULL, NULL);
-    char* utf8_str = new char[utf8_num];
-    WideCharToMultiByte(CP_UTF8, 0, str.c_str(), -1, utf8_str, utf8_num, NULL, NULL);
-    std::string result = utf8_str;
-    delete[] utf8_str;
+static std::string multibyte2utf8(const std::wstring& str) {
+    return encodeUtf8(str, TextFormat{});
+}
+
+static std::wstring utf82multibyte(const std::string& str) {
+    std::wstring result = L"";
+    decodeUtf8(reinterpret_cast<const unsigned char*>(str.data()), str.size(), result);
     return result;
 }
 static std::string replaceAll(std::string str, const std::string& from, const std::string& to) {
@@ -74,17 +77,15 @@ enum class GLRenderMode {
 };
 
 static void glSetRenderMode(GLRenderMode mode) {
+    GLStateCache& state = GLStateCache::get();
     if (mode == GLRenderMode::GL2D) {
-        glDisable(GL_DEPTH_TEST);
-
-        glEnable(GL_BLEND);
-        glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
+        state.setDepthTest(false);
+        state.setBlend(true, GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
     }
     else if (mode == GLRenderMode::GL3D) {
-        glEnable(GL_DEPTH_TEST);
-        glEnable(GL_MULTISAMPLE);
-
-        glDisable(GL_BLEND);
+        state.setDepthTest(true);
+        state.setMultisample(true);
+        state.setBlend(false);
     }
 }
 
@@ -92,14 +93,6 @@ static std::wstring s2ws(const std::string& str) {
     return std::wstring(str.begin(), str.end());
 }
 
-static void writeFile(const std::wstring& filePath, const std::wstring& content) {
-    std::wofstream writeFile(filePath);
-    if (writeFile.is_open()) {
-        writeFile << content;
-        writeFile.close();
-    }
-}
-
 static std::string readFile(const std::string& filePath) {
     std::ifstream openFile(filePath.data());
     std::string content = "";
@@ -113,43 +106,12 @@ static std::string readFile(const std::string& filePath) {
     return content;
 }
 
-static size_t getSizeOfFile(const std::wstring& path) {
-    struct _stat fileinfo;
-    _wstat(path.c_str(), &fileinfo);
-    return fileinfo.st_size;
-}
-
-
-static std::wstring readFileW(const std::wstring& filename) {
-    std::wstring buffer = L"";
-    FILE* f;
-    _wfopen_s(&f, filename.c_str(), L"rtS, ccs=UTF-8");
-    if (f == NULL) {
-        return buffer;
-    }
-    size_t filesize = getSizeOfFile(filename);
-    if (filesize > 0) {
-        buffer.resize(filesize);
-        size_t wchars_read = fread(&(buffer.front()), sizeof(wchar_t), filesize, f);
-        buffer.resize(wchars_read);
-        buffer.shrink_to_fit();
-    }
-    fclose(f);
-    return buffer;
-}
-
 static std::string getCurrentPath() {
-    char buffer[MAX_PATH];
-    GetModuleFileNameA(NULL, buffer, MAX_PATH);
-    std::string::size_type pos = std::string(buffer).find_last_of("\\/");
-    return std::string(buffer).substr(0, pos);
+    return getExecutableDirectory();
 }
 
 static std::wstring getCurrentPathW() {
-    char buffer[MAX_PATH];
-    GetModuleFileNameA(NULL, buffer, MAX_PATH);
-    std::string::size_type pos = std::string(buffer).find_last_of("\\/");
-    std::string temp = std::string(std::string(buffer).substr(0, pos));
+    std::string temp = getExecutableDirectory();
     return std::wstring(temp.begin(), temp.end());
 }
 
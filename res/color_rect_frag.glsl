@@ -1,7 +1,7 @@
 #version 330
+in vec4 Color;
 out vec4 outColor;
-uniform vec4 color;
 
 void main() {
-	outColor = color;
+	outColor = Color;
 }
\ No newline at end of file
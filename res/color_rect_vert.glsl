@@ -1,10 +1,11 @@
 #version 330
-in vec3 aPos;
-uniform mat4 WorldMatrix;
+layout(location = 0) in vec2 aPos;
+layout(location = 1) in vec4 aColor;
+out vec4 Color;
 uniform mat4 ViewMatrix;
 uniform mat4 ProjectionMatrix;
 
 void main() {
-	vec4 pos = vec4(aPos, 1.0);
-	gl_Position = pos * WorldMatrix * ViewMatrix * ProjectionMatrix;
+	Color = aColor;
+	gl_Position = vec4(aPos, 0.0, 1.0) * ViewMatrix * ProjectionMatrix;
 }
\ No newline at end of file
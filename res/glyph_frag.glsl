@@ -1,10 +1,10 @@
 #version 330 core
 in vec2 TexCoord;
+in vec4 Color;
 out vec4 color;
 
 uniform float Time;
 uniform sampler2D text;
-uniform vec4 textColor;
 uniform bool Rainbow_Enabled;
 
 void main() {    
@@ -15,10 +15,10 @@ void main() {
             abs(sin(Time + 4.0))
         );
         vec4 sampled = vec4(rainbowColor, texture(text, TexCoord).r);
-        color = textColor * sampled;
+        color = Color * sampled;
     }
     else{
         vec4 sampled = vec4(1.0, 1.0, 1.0, texture(text, TexCoord).r);
-        color = textColor * sampled;
+        color = Color * sampled;
     }
 }
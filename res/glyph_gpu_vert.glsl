@@ -0,0 +1,57 @@
+#version 330 core
+out vec2 TexCoord;
+out vec4 Color;
+
+uniform mat4 ViewMatrix;
+uniform mat4 ProjectionMatrix;
+uniform vec2 Origin;
+uniform float LineHeight;
+uniform int LineCount;
+uniform bool Rainbow_Enabled;
+uniform vec4 Palette[16];
+
+// 3 texels per codepoint : (bearing.x, bearing.y, width, height), (u0, v0, u1, v1), (advance, 0, 0, 0)
+uniform samplerBuffer Metrics;
+// pooled glyphs : codepoint in the low 24 bits, token class in the high 8 bits
+uniform usamplerBuffer Codepoints;
+// x of each pooled glyph from the start of its line
+uniform isamplerBuffer Advances;
+// (first instance, first pooled glyph) of each visible line
+uniform isamplerBuffer Lines;
+
+const vec2 CORNERS[6] = vec2[6](
+        vec2(0.0, 1.0), vec2(0.0, 0.0), vec2(1.0, 0.0),
+        vec2(0.0, 1.0), vec2(1.0, 0.0), vec2(1.0, 1.0)
+);
+
+int findLine(int instance) {
+        int lo = 0;
+        int hi = LineCount - 1;
+        while (lo < hi) {
+                int mid = (lo + hi + 1) / 2;
+                if (texelFetch(Lines, mid).r <= instance) {
+                        lo = mid;
+                }
+                else {
+                        hi = mid - 1;
+                }
+        }
+        return lo;
+}
+
+void main() {
+        int line = findLine(gl_InstanceID);
+        ivec2 lineInfo = texelFetch(Lines, line).rg;
+        int glyph = lineInfo.y + gl_InstanceID - lineInfo.x;
+        uint packed = texelFetch(Codepoints, glyph).r;
+        int codepoint = int(packed & 0xFFFFFFu);
+        vec4 box = texelFetch(Metrics, codepoint * 3);
+        vec4 uv = texelFetch(Metrics, codepoint * 3 + 1);
+        vec2 corner = CORNERS[gl_VertexID];
+        float xpos = Origin.x + float(texelFetch(Advances, glyph).r) + box.x;
+        float ypos = Origin.y - float(line) * LineHeight - (box.w - box.y);
+        vec2 pos = vec2(xpos + corner.x * box.z, ypos + corner.y * box.w);
+        gl_Position = vec4(pos, 0.0, 1.0) * ViewMatrix * ProjectionMatrix;
+        TexCoord = vec2(mix(uv.x, uv.z, corner.x), mix(uv.w, uv.y, corner.y));
+        Color = Rainbow_Enabled ? vec4(1.0) : Palette[int(packed >> 24)];
+}
\ No newline at end of file
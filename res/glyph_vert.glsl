@@ -1,14 +1,18 @@
 #version 330 core
 layout (location = 0) in vec4 aPos;
+layout (location = 1) in float aToken;
 out vec2 TexCoord;
+out vec4 Color;
 
 uniform mat4 ViewMatrix;
 uniform mat4 ProjectionMatrix;
 
 uniform float Time;
 uniform bool Rainbow_Enabled;
+uniform vec4 Palette[16];
 
 void main() {
         gl_Position = vec4(aPos.xy, 0.0, 1.0) * ViewMatrix * ProjectionMatrix;
         TexCoord = aPos.zw;
+        Color = Rainbow_Enabled ? vec4(1.0) : Palette[int(aToken)];
 }
\ No newline at end of file
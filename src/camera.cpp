@@ -2,6 +2,7 @@
 #include <algorithm>
 
 Camera::Camera(int _screenWidth, int _screenHeight) {
+	m_screenSize = vec2(float(_screenWidth), float(_screenHeight));
 	m_projectionMatrix[0] = 2.0f / _screenWidth;
 	m_projectionMatrix[5] = 2.0f / _screenHeight;
 }
@@ -9,6 +10,7 @@ Camera::~Camera() {
 
 }
 void Camera::setWindowSize(int _width, int _height) {
+	m_screenSize = vec2(float(_width), float(_height));
 	m_projectionMatrix[0] = 2.0f / _width;
 	m_projectionMatrix[5] = 2.0f / _height;
 }
@@ -20,6 +22,28 @@ const std::vector<float>& Camera::getProjectionMatrix() const{
 	return m_projectionMatrix;
 }
 
+const vec2& Camera::getScreenSize() const {
+	return m_screenSize;
+}
+
+vec2 Camera::screenToWorld(const vec2& _screen) const {
+	float ndcX = 2.0f * _screen.x / m_screenSize.x - 1.0f;
+	float ndcY = 1.0f - 2.0f * _screen.y / m_screenSize.y;
+	return vec2(
+		(ndcX / m_projectionMatrix[0] - m_viewMatrix[3]) / m_viewMatrix[0],
+		(ndcY / m_projectionMatrix[5] - m_viewMatrix[7]) / m_viewMatrix[5]
+	);
+}
+
+vec2 Camera::worldToScreen(const vec2& _world) const {
+	float ndcX = (_world.x * m_viewMatrix[0] + m_viewMatrix[3]) * m_projectionMatrix[0];
+	float ndcY = (_world.y * m_viewMatrix[5] + m_viewMatrix[7]) * m_projectionMatrix[5];
+	return vec2(
+		(ndcX + 1.0f) * 0.5f * m_screenSize.x,
+		(1.0f - ndcY) * 0.5f * m_screenSize.y
+	);
+}
+
 void Camera::setZoom(const vec2& _zoom) {
 	m_zoom = _zoom;
 	m_zoom.x = std::clamp(m_zoom.x, 0.65f, 1.0f);
@@ -3,68 +3,54 @@
 #include "macros.h"
 #include "shader.h"
 #include "camera.h"
+#include "gl_state.h"
+#include "render_queue.h"
+#include "editor.h"
+
+extern Editor* myEditor;
+
+static const float IDENTITY_MATRIX[16] = {
+	1.0f, 0.0f, 0.0f, 0.0f,
+	0.0f, 1.0f, 0.0f, 0.0f,
+	0.0f, 0.0f, 1.0f, 0.0f,
+	0.0f, 0.0f, 0.0f, 1.0f
+};
 
 ColorRect::ColorRect(Camera* _cam) : m_camera(_cam) {
 	if (Singleton4ColorRect::get().m_VAO == 0) {
-		float vertexBuffer[] = {
-			-0.5f,  0.5f, 0.0f,
-			0.5f,  0.5f, 0.0f,
-			0.5f, -0.5f, 0.0f,
-			-0.5f, -0.5f, 0.0f,
-		};
-		unsigned int indexBuffer[] = {
-			0, 1, 2,
-			2, 3, 0
-		};
 		glGenVertexArrays(1, &Singleton4ColorRect::get().m_VAO);
-		glBindVertexArray(Singleton4ColorRect::get().m_VAO);
-		glGenBuffers(1, &Singleton4ColorRect::get().m_VBO);
-		glBindBuffer(GL_ARRAY_BUFFER, Singleton4ColorRect::get().m_VBO);
-		glBufferData(GL_ARRAY_BUFFER, 4 * 3 * sizeof(float), vertexBuffer, GL_STATIC_DRAW);
-		glGenBuffers(1, &Singleton4ColorRect::get().m_EBO);
-		glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, Singleton4ColorRect::get().m_EBO);
-		glBufferData(GL_ELEMENT_ARRAY_BUFFER, 6 * sizeof(unsigned int), indexBuffer, GL_STATIC_DRAW);
-
+		GLStateCache::get().bindVertexArray(Singleton4ColorRect::get().m_VAO);
+		GLStateCache::get().bindArrayBuffer(myEditor->renderQueue->getVertexBufferID());
 		glEnableVertexAttribArray(0);
-		glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, sizeof(float) * 3, 0);
+		glVertexAttribPointer(0, 2, GL_FLOAT, GL_FALSE, sizeof(float) * 6, 0);
+		glEnableVertexAttribArray(1);
+		glVertexAttribPointer(1, 4, GL_FLOAT, GL_FALSE, sizeof(float) * 6, reinterpret_cast<void*>(sizeof(float) * 2));
+		Singleton4ColorRect::get().m_shader = new Shader(readFile(COLOR_RECT_VERTEX_SHADER_PATH).c_str(), readFile(COLOR_RECT_FRAGMENT_SHADER_PATH).c_str());
 	}
-	m_shader = new Shader(readFile(COLOR_RECT_VERTEX_SHADER_PATH).c_str(), readFile(COLOR_RECT_FRAGMENT_SHADER_PATH).c_str());
+	m_shader = Singleton4ColorRect::get().m_shader;
 }
 ColorRect::~ColorRect() {
 
 }
 void ColorRect::draw() const {
 	if (!m_visible) return;
-	glSetRenderMode(GLRenderMode::GL2D);
-	m_shader->use();
+	if (m_size.x == 0 || m_size.y == 0) return;
+	const float left = m_position.x - m_size.x / 2.0f;
+	const float right = m_position.x + m_size.x / 2.0f;
+	const float top = -m_position.y + m_size.y / 2.0f;
+	const float bottom = -m_position.y - m_size.y / 2.0f;
+	const vec4& c = m_color;
+	float vertices[6][6] = {
+		{ left,  top,    c.r, c.g, c.b, c.a },
+		{ right, top,    c.r, c.g, c.b, c.a },
+		{ right, bottom, c.r, c.g, c.b, c.a },
 
-	glBindVertexArray(Singleton4ColorRect::get().m_VAO);
-
-	std::vector<float> worldMatrix = {
-		float(m_size.x), 0.0f, 0.0f, m_position.x,
-		0.0f, float(m_size.y), 0.0f, -m_position.y,
-		0.0f, 0.0f, 1.0f, 0.0f,
-		0.0f, 0.0f, 0.0f, 1.0f
+		{ right, bottom, c.r, c.g, c.b, c.a },
+		{ left,  bottom, c.r, c.g, c.b, c.a },
+		{ left,  top,    c.r, c.g, c.b, c.a }
 	};
-	m_shader->setMat4("WorldMatrix", worldMatrix.data());
-	if (m_ignoreViewMatrix) {
-		std::vector<float> temp = {
-			1.0f, 0.0f, 0.0f, 0.0f,
-			0.0f, 1.0f, 0.0f, 0.0f,
-			0.0f, 0.0f, 1.0f, 0.0f,
-			0.0f, 0.0f, 0.0f, 1.0f
-		};
-		m_shader->setMat4("ViewMatrix", temp.data());
-	}
-	else {
-		m_shader->setMat4("ViewMatrix", m_camera->getViewMatrix().data());
-	}
-	m_shader->setMat4("ProjectionMatrix", m_camera->getProjectionMatrix().data());
-	m_shader->setVec4("color", m_color);
-
-	glDrawElements(GL_TRIANGLES, 6, GL_UNSIGNED_INT, nullptr);
-	m_shader->unuse();
-	glBindVertexArray(0);
+	const float* viewMatrix = m_ignoreViewMatrix ? IDENTITY_MATRIX : m_camera->getViewMatrix().data();
+	myEditor->renderQueue->submit(m_layer, m_shader, 0, Singleton4ColorRect::get().m_VAO, viewMatrix, vertices, sizeof(vertices), sizeof(float) * 6);
 }
 
 void ColorRect::setPosition(const vec2& _pos){
@@ -92,4 +78,8 @@ void ColorRect::setVisible(const bool& flag) {
 
 void ColorRect::setIgnoreViewMatrix(const bool& flag) {
 	m_ignoreViewMatrix = flag;
+}
+
+void ColorRect::setLayer(const RenderLayer& _layer) {
+	m_layer = _layer;
 }
\ No newline at end of file
@@ -0,0 +1,205 @@
+#include "content_hash.h"
+#include "macros.h"
+
+#include <algorithm>
+
+#if defined(_MSC_VER) && defined(_M_X64)
+	#include <intrin.h>
+#endif
+
+// arithmetic is modulo the Mersenne prime 2^61 - 1, which reduces with a shift and an add
+#define CONTENT_HASH_MODULUS ((1ULL << 61) - 1)
+#define CONTENT_HASH_BASE 1099511628211ULL
+
+static unsigned long long mulMod(unsigned long long _a, unsigned long long _b) {
+#if defined(__SIZEOF_INT128__)
+	const unsigned __int128 product = (unsigned __int128)_a * _b;
+	const unsigned long long low = (unsigned long long)product;
+	const unsigned long long high = (unsigned long long)(product >> 64);
+#elif defined(_MSC_VER) && defined(_M_X64)
+	unsigned long long high;
+	const unsigned long long low = _umul128(_a, _b, &high);
+#else
+	const unsigned long long a0 = _a & 0xFFFFFFFF, a1 = _a >> 32, b0 = _b & 0xFFFFFFFF, b1 = _b >> 32;
+	const unsigned long long p00 = a0 * b0, p01 = a0 * b1, p10 = a1 * b0;
+	const unsigned long long middle = (p00 >> 32) + (p01 & 0xFFFFFFFF) + (p10 & 0xFFFFFFFF);
+	const unsigned long long low = (middle << 32) | (p00 & 0xFFFFFFFF);
+	const unsigned long long high = a1 * b1 + (p01 >> 32) + (p10 >> 32) + (middle >> 32);
+#endif
+	unsigned long long r = (low & CONTENT_HASH_MODULUS) + ((low >> 61) | (high << 3));
+	if (r >= CONTENT_HASH_MODULUS) {
+		r -= CONTENT_HASH_MODULUS;
+	}
+	return r;
+}
+
+static unsigned long long addMod(unsigned long long _a, unsigned long long _b) {
+	unsigned long long r = _a + _b;
+	if (r >= CONTENT_HASH_MODULUS) {
+		r -= CONTENT_HASH_MODULUS;
+	}
+	return r;
+}
+
+bool ContentDigest::operator==(const ContentDigest& _other) const {
+	return Hash == _other.Hash && Length == _other.Length;
+}
+
+ContentDigest ContentHash::digest(const char* _data, const size_t& _size) {
+	static const unsigned long long base2 = mulMod(CONTENT_HASH_BASE, CONTENT_HASH_BASE);
+	static const unsigned long long base3 = mulMod(base2, CONTENT_HASH_BASE);
+	static const unsigned long long base4 = mulMod(base3, CONTENT_HASH_BASE);
+	const unsigned char* bytes = reinterpret_cast<const unsigned char*>(_data);
+	unsigned long long hash = 0;
+	unsigned long long power = 1;
+	size_t i = 0;
+	// four bytes per step keep only one multiplication on the dependency chain
+	for (; i + 4 <= _size; i += 4) {
+		const unsigned long long block = addMod(addMod(mulMod(bytes[i], base3), mulMod(bytes[i + 1], base2)),
+			addMod(mulMod(bytes[i + 2], CONTENT_HASH_BASE), bytes[i + 3]));
+		hash = addMod(mulMod(hash, base4), block);
+		power = mulMod(power, base4);
+	}
+	for (; i < _size; i++) {
+		hash = addMod(mulMod(hash, CONTENT_HASH_BASE), bytes[i]);
+		power = mulMod(power, CONTENT_HASH_BASE);
+	}
+	return ContentDigest{ hash, power, _size };
+}
+
+ContentDigest ContentHash::concat(const ContentDigest& _left, const ContentDigest& _right) {
+	return ContentDigest{ addMod(mulMod(_left.Hash, _right.Power), _right.Hash), mulMod(_left.Power, _right.Power), _left.Length + _right.Length };
+}
+
+void ContentHash::assign(const std::vector<ContentDigest>& _chunks) {
+	// there is always a chunk for edits at the end of the text to land in, even when it is empty
+	m_chunkCount = std::max(_chunks.size(), size_t(1));
+	m_leafCount = 1;
+	while (m_leafCount < m_chunkCount) {
+		m_leafCount <<= 1;
+	}
+	m_nodes.assign(m_leafCount * 2, ContentDigest{});
+	std::copy(_chunks.begin(), _chunks.end(), m_nodes.begin() + m_leafCount);
+	for (size_t i = m_leafCount - 1; i > 0; i--) {
+		m_nodes[i] = concat(m_nodes[i * 2], m_nodes[i * 2 + 1]);
+	}
+	m_dirty.clear();
+	m_resplit = false;
+}
+
+void ContentHash::setChunk(const size_t& _index, const ContentDigest& _digest) {
+	size_t i = _index + m_leafCount;
+	m_nodes[i] = _digest;
+	for (i >>= 1; i > 0; i >>= 1) {
+		m_nodes[i] = concat(m_nodes[i * 2], m_nodes[i * 2 + 1]);
+	}
+}
+
+// the chunk holding _byte, or the last one when _byte is the end of the text
+size_t ContentHash::locate(size_t _byte) const {
+	if (_byte >= m_nodes[1].Length) {
+		return m_chunkCount - 1;
+	}
+	size_t i = 1;
+	while (i < m_leafCount) {
+		if (_byte < m_nodes[i * 2].Length) {
+			i = i * 2;
+		}
+		else {
+			_byte -= m_nodes[i * 2].Length;
+			i = i * 2 + 1;
+		}
+	}
+	return i - m_leafCount;
+}
+
+size_t ContentHash::getChunkStart(const size_t& _index) const {
+	size_t start = 0;
+	for (size_t i = _index + m_leafCount; i > 1; i >>= 1) {
+		if (i & 1) {
+			start += m_nodes[i - 1].Length;
+		}
+	}
+	return start;
+}
+
+void ContentHash::resplit(const std::string& _bytes) {
+	// chunks the edits left alone keep their digests, the edited ones are cut back to size and emptied ones dropped
+	std::vector<ContentDigest> chunks;
+	size_t start = 0;
+	size_t next = 0;
+	for (size_t i = 0; i < m_chunkCount; i++) {
+		const ContentDigest& chunk = m_nodes[m_leafCount + i];
+		const bool dirty = next < m_dirty.size() && m_dirty[next] == i;
+		next += dirty;
+		if (chunk.Length == 0) {
+			continue;
+		}
+		if (!dirty) {
+			chunks.push_back(chunk);
+		}
+		else {
+			for (size_t offset = 0; offset < chunk.Length; offset += CONTENT_HASH_CHUNK_SIZE) {
+				chunks.push_back(digest(_bytes.data() + start + offset, std::min(size_t(chunk.Length) - offset, size_t(CONTENT_HASH_CHUNK_SIZE))));
+			}
+		}
+		start += chunk.Length;
+	}
+	assign(chunks);
+}
+
+void ContentHash::build(const std::string& _bytes) {
+	std::vector<ContentDigest> chunks;
+	chunks.reserve(_bytes.size() / CONTENT_HASH_CHUNK_SIZE + 1);
+	for (size_t offset = 0; offset < _bytes.size(); offset += CONTENT_HASH_CHUNK_SIZE) {
+		chunks.push_back(digest(_bytes.data() + offset, std::min(_bytes.size() - offset, size_t(CONTENT_HASH_CHUNK_SIZE))));
+	}
+	assign(chunks);
+}
+
+void ContentHash::noteEdit(const size_t& _byte, const size_t& _erasedBytes, const size_t& _insertedBytes) {
+	if (m_nodes.empty()) {
+		assign({});
+	}
+	// the whole edit goes to the first chunk it touches, the others it erased through are left empty
+	const size_t first = locate(_byte);
+	const size_t last = (_erasedBytes > 0 ? locate(_byte + _erasedBytes - 1) : first);
+	size_t length = 0;
+	for (size_t i = first; i <= last; i++) {
+		length += m_nodes[m_leafCount + i].Length;
+		if (i > first) {
+			setChunk(i, ContentDigest{});
+		}
+	}
+	// only the length is right until update(), which is all locate() needs for the next edit
+	ContentDigest chunk = m_nodes[m_leafCount + first];
+	chunk.Length = length - _erasedBytes + _insertedBytes;
+	setChunk(first, chunk);
+	m_dirty.push_back(first);
+	if (chunk.Length > CONTENT_HASH_CHUNK_SIZE * 2) {
+		m_resplit = true;
+	}
+}
+
+const ContentDigest& ContentHash::update(const std::string& _bytes) {
+	std::sort(m_dirty.begin(), m_dirty.end());
+	m_dirty.erase(std::unique(m_dirty.begin(), m_dirty.end()), m_dirty.end());
+	if (m_nodes.empty() || m_nodes[1].Length != _bytes.size()) {
+		build(_bytes);
+	}
+	else if (m_resplit) {
+		resplit(_bytes);
+	}
+	else {
+		for (const size_t& i : m_dirty) {
+			const size_t start = getChunkStart(i);
+			setChunk(i, digest(_bytes.data() + start, size_t(m_nodes[m_leafCount + i].Length)));
+		}
+		m_dirty.clear();
+	}
+	return m_nodes[1];
+}
+
+bool ContentHash::hasPendingEdits() const {
+	return !m_dirty.empty();
+}
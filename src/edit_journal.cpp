@@ -0,0 +1,361 @@
+#include "edit_journal.h"
+#include "platform.h"
+#include "macros.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <sstream>
+
+#define EDIT_JOURNAL_MAGIC "EDJOURN1"
+// the offset of a record that carries a new header instead of an edit
+#define EDIT_JOURNAL_HEADER_RECORD (~0ULL)
+
+static void appendNumber(std::string& _out, unsigned long long _value) {
+	char bytes[8];
+	memcpy(bytes, &_value, 8);
+	_out.append(bytes, 8);
+}
+
+static bool readNumber(const std::string& _in, size_t& _pos, unsigned long long& _value) {
+	if (_in.size() - _pos < 8) {
+		return false;
+	}
+	memcpy(&_value, _in.data() + _pos, 8);
+	_pos += 8;
+	return true;
+}
+
+EditJournal::EditJournal(const std::string& _filePath, const JournalHeader& _header) : m_path(_filePath + EDIT_JOURNAL_SUFFIX), m_header(_header) {
+	m_thread = std::thread(&EditJournal::work, this);
+}
+
+EditJournal::~EditJournal() {
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+		m_stopping = true;
+	}
+	m_wake.notify_one();
+	// whatever was queued is still written before the thread ends
+	if (m_thread.joinable()) {
+		m_thread.join();
+	}
+}
+
+void EditJournal::work() {
+	std::unique_lock<std::mutex> lock(m_mutex);
+	// what the file holds since it was last written whole, and how many records that took
+	JournalHeader header;
+	std::vector<JournalRecord> folded;
+	size_t written = 0;
+	while (true) {
+		m_wake.wait(lock, [this] { return m_stopping || m_rewritePending || m_removePending || (m_started && !m_pending.empty()); });
+		// give a burst of typing the time to join the same batch, so it costs one flush instead of one per key
+		if (!m_stopping && !m_rewritePending && !m_removePending) {
+			m_wake.wait_for(lock, std::chrono::duration<double>(EDIT_JOURNAL_FLUSH_INTERVAL), [this] {
+				return m_stopping || m_rewritePending || m_removePending;
+			});
+		}
+		const bool stopping = m_stopping;
+		const bool remove = m_removePending;
+		const bool rewrite = m_rewritePending;
+		std::vector<JournalRecord> rewriteRecords;
+		rewriteRecords.swap(m_rewriteRecords);
+		if (rewrite) {
+			header = m_rewriteHeader;
+		}
+		std::vector<JournalRecord> batch;
+		if (m_started) {
+			batch.swap(m_pending);
+		}
+		m_rewritePending = false;
+		m_removePending = false;
+		lock.unlock();
+		if (remove) {
+			std::remove(m_path.c_str());
+			folded.clear();
+			written = 0;
+		}
+		if (rewrite) {
+			std::string contents(EDIT_JOURNAL_MAGIC);
+			appendHeader(contents, header);
+			folded.clear();
+			for (const JournalRecord& r : rewriteRecords) {
+				appendRecord(contents, r);
+				fold(folded, r);
+			}
+			written = rewriteRecords.size();
+			writeFileAtomically(m_path, { FilePiece{ contents.data(), contents.size(), 0 } });
+		}
+		if (!batch.empty()) {
+			std::vector<JournalRecord> merged;
+			for (JournalRecord& r : batch) {
+				if (merged.empty() || !merge(merged.back(), r)) {
+					merged.push_back(std::move(r));
+				}
+			}
+			for (const JournalRecord& r : merged) {
+				if (r.Offset == EDIT_JOURNAL_HEADER_RECORD) {
+					size_t headerPos = 0;
+					readHeader(r.Inserted, headerPos, header);
+				}
+				else {
+					fold(folded, r);
+				}
+			}
+			written += merged.size();
+			if (written >= std::max(size_t(EDIT_JOURNAL_COMPACT_RECORDS), folded.size() * 2)) {
+				// folded edits are disjoint, so applied back to front each offset is still one of the header's text
+				std::string contents(EDIT_JOURNAL_MAGIC);
+				appendHeader(contents, header);
+				for (auto it = folded.rbegin(); it != folded.rend(); ++it) {
+					appendRecord(contents, *it);
+				}
+				written = folded.size();
+				if (!writeFileAtomically(m_path, { FilePiece{ contents.data(), contents.size(), 0 } })) {
+					PUSH_ERROR("Cannot Compact Journal");
+				}
+			}
+			else {
+				std::string bytes;
+				for (const JournalRecord& r : merged) {
+					appendRecord(bytes, r);
+				}
+				if (!appendFileDurably(m_path, bytes)) {
+					PUSH_ERROR("Cannot Write Journal");
+				}
+			}
+		}
+		lock.lock();
+		if (stopping) {
+			return;
+		}
+	}
+}
+
+void EditJournal::appendRecord(std::string& _out, const JournalRecord& _record) {
+	appendNumber(_out, _record.Offset);
+	appendNumber(_out, _record.Erased);
+	appendNumber(_out, _record.Inserted.size());
+	_out.append(_record.Inserted);
+}
+
+void EditJournal::appendHeader(std::string& _out, const JournalHeader& _header) {
+	appendNumber(_out, _header.FileSize);
+	appendNumber(_out, (unsigned long long)_header.FileTime);
+	appendNumber(_out, _header.TextSize);
+}
+
+bool EditJournal::readHeader(const std::string& _in, size_t& _pos, JournalHeader& _header) {
+	unsigned long long fileTime = 0;
+	if (!readNumber(_in, _pos, _header.FileSize) || !readNumber(_in, _pos, fileTime) || !readNumber(_in, _pos, _header.TextSize)) {
+		return false;
+	}
+	_header.FileTime = (long long)fileTime;
+	return true;
+}
+
+// folds _next into _into when the two are one run of typing or erasing, or two headers of which the last one counts
+bool EditJournal::merge(JournalRecord& _into, const JournalRecord& _next) {
+	if (_into.Offset == EDIT_JOURNAL_HEADER_RECORD || _next.Offset == EDIT_JOURNAL_HEADER_RECORD) {
+		if (_into.Offset != _next.Offset) {
+			return false;
+		}
+		_into.Inserted = _next.Inserted;
+		return true;
+	}
+	const unsigned long long insertedEnd = _into.Offset + _into.Inserted.size();
+	if (_next.Erased == 0 && _next.Offset == insertedEnd) {
+		_into.Inserted.append(_next.Inserted);
+		return true;
+	}
+	if (!_next.Inserted.empty()) {
+		return false;
+	}
+	if (_next.Offset + _next.Erased == insertedEnd && _next.Erased <= _into.Inserted.size()) {
+		_into.Inserted.resize(_into.Inserted.size() - _next.Erased);
+		return true;
+	}
+	if (_into.Inserted.empty() && _next.Offset + _next.Erased == _into.Offset) {
+		_into.Offset = _next.Offset;
+		_into.Erased += _next.Erased;
+		return true;
+	}
+	if (_into.Inserted.empty() && _next.Offset == _into.Offset) {
+		_into.Erased += _next.Erased;
+		return true;
+	}
+	return false;
+}
+
+// _folded holds sorted, disjoint edits of the header's text, _edit is an edit of the text after all of them
+void EditJournal::fold(std::vector<JournalRecord>& _folded, const JournalRecord& _edit) {
+	const unsigned long long start = _edit.Offset;
+	const unsigned long long end = _edit.Offset + _edit.Erased;
+	// how much the folded edits before the one looked at grew the text, which maps a current offset back to the header's text
+	long long shift = 0;
+	size_t first = 0;
+	while (first < _folded.size() && _folded[first].Offset + shift + _folded[first].Inserted.size() < start) {
+		shift += (long long)_folded[first].Inserted.size() - (long long)_folded[first].Erased;
+		first++;
+	}
+	// every folded edit that overlaps or touches the new one is merged with it
+	size_t last = first;
+	long long lastShift = shift;
+	long long tailShift = shift;
+	while (last < _folded.size() && _folded[last].Offset + lastShift <= end) {
+		tailShift = lastShift;
+		lastShift += (long long)_folded[last].Inserted.size() - (long long)_folded[last].Erased;
+		last++;
+	}
+	if (first == last) {
+		_folded.insert(_folded.begin() + first, JournalRecord{ start - shift, _edit.Erased, _edit.Inserted });
+		return;
+	}
+	JournalRecord& into = _folded[first];
+	const JournalRecord& tail = _folded[last - 1];
+	const unsigned long long intoStart = into.Offset + shift;
+	const unsigned long long tailStart = tail.Offset + tailShift;
+	const unsigned long long tailEnd = tailStart + tail.Inserted.size();
+	const unsigned long long from = start < intoStart ? start - shift : into.Offset;
+	const unsigned long long to = end > tailEnd ? end - lastShift : tail.Offset + tail.Erased;
+	const size_t keep = size_t(start > intoStart ? start - intoStart : 0);
+	if (last - first == 1) {
+		const size_t cut = size_t(end < tailEnd ? end - intoStart : into.Inserted.size());
+		into.Inserted.replace(keep, cut - keep, _edit.Inserted);
+	}
+	else {
+		std::string suffix = end < tailEnd ? tail.Inserted.substr(size_t(end - tailStart)) : std::string();
+		into.Inserted.resize(keep);
+		into.Inserted.append(_edit.Inserted);
+		into.Inserted.append(suffix);
+	}
+	into.Offset = from;
+	into.Erased = to - from;
+	_folded.erase(_folded.begin() + first + 1, _folded.begin() + last);
+	if (into.Erased == 0 && into.Inserted.empty()) {
+		_folded.erase(_folded.begin() + first);
+	}
+}
+
+void EditJournal::reset(const JournalHeader& _header, const std::vector<JournalRecord>& _records) {
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+		// the new contents already hold everything that was still waiting
+		m_pending.clear();
+		m_rewriteHeader = _header;
+		m_rewriteRecords = _records;
+		m_rewritePending = true;
+		m_removePending = false;
+		m_started = true;
+	}
+	m_wake.notify_one();
+	m_header = _header;
+}
+
+// the edits queued so far were made on top of the text _header describes, so they follow it into the new journal
+void EditJournal::start(const JournalHeader& _header) {
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+		m_rewriteHeader = _header;
+		m_rewriteRecords.clear();
+		m_rewritePending = true;
+		m_removePending = false;
+		m_started = true;
+	}
+	m_wake.notify_one();
+	m_header = _header;
+}
+
+void EditJournal::record(const size_t& _offset, const size_t& _erased, const std::string& _inserted) {
+	if (_erased == 0 && _inserted.empty()) {
+		return;
+	}
+	bool first = false;
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+		m_pending.push_back(JournalRecord{ _offset, _erased, _inserted });
+		first = m_pending.size() == 1;
+	}
+	if (first) {
+		m_wake.notify_one();
+	}
+}
+
+void EditJournal::updateHeader(const JournalHeader& _header) {
+	std::string header;
+	appendHeader(header, _header);
+	bool first = false;
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+		m_pending.push_back(JournalRecord{ EDIT_JOURNAL_HEADER_RECORD, 0, std::move(header) });
+		first = m_pending.size() == 1;
+	}
+	if (first) {
+		m_wake.notify_one();
+	}
+	m_header = _header;
+}
+
+void EditJournal::remove() {
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+		m_pending.clear();
+		m_rewriteRecords.clear();
+		m_rewritePending = false;
+		m_removePending = true;
+	}
+	m_wake.notify_one();
+}
+
+const JournalHeader& EditJournal::getHeader() const {
+	return m_header;
+}
+
+JournalHeader EditJournal::identify(const std::string& _filePath, const size_t& _textSize) {
+	JournalHeader header;
+	std::error_code error;
+	header.FileSize = std::filesystem::file_size(_filePath, error);
+	header.FileTime = (long long)std::filesystem::last_write_time(_filePath, error).time_since_epoch().count();
+	header.TextSize = _textSize;
+	return header;
+}
+
+bool EditJournal::read(const std::string& _filePath, JournalHeader& _header, std::vector<JournalRecord>& _records) {
+	std::ifstream file(_filePath + EDIT_JOURNAL_SUFFIX, std::ios::binary);
+	if (!file.is_open()) {
+		return false;
+	}
+	std::stringstream stream;
+	stream << file.rdbuf();
+	const std::string contents = stream.str();
+	const size_t magicLength = strlen(EDIT_JOURNAL_MAGIC);
+	if (contents.compare(0, magicLength, EDIT_JOURNAL_MAGIC) != 0) {
+		return false;
+	}
+	size_t pos = magicLength;
+	if (!readHeader(contents, pos, _header)) {
+		return false;
+	}
+	_records.clear();
+	// a record cut short by a crash in the middle of an append is dropped
+	while (true) {
+		JournalRecord r;
+		unsigned long long length = 0;
+		if (!readNumber(contents, pos, r.Offset) || !readNumber(contents, pos, r.Erased) || !readNumber(contents, pos, length) || contents.size() - pos < length) {
+			break;
+		}
+		r.Inserted = contents.substr(pos, size_t(length));
+		pos += size_t(length);
+		if (r.Offset == EDIT_JOURNAL_HEADER_RECORD) {
+			size_t headerPos = 0;
+			readHeader(r.Inserted, headerPos, _header);
+			continue;
+		}
+		_records.push_back(std::move(r));
+	}
+	return true;
+}
@@ -6,25 +6,42 @@
 #include "color_rect.h"
 #include "glyph_texture.h"
 #include "shader.h"
+#include "gl_state.h"
+#include "render_queue.h"
+#include "latency_tracker.h"
+#include "file_loader.h"
+#include "large_file_view.h"
+#include "file_follower.h"
+#include "file_saver.h"
+#include "edit_journal.h"
 #include <cassert>
+#include <cmath>
 #include <utility>
+#include <filesystem>
 
 extern Editor* myEditor;
 
 static void bufferSizeCallback(GLFWwindow* window, int width, int height) {
-    glViewport(0, 0, width, height);
-    myEditor->windowSize.x = width;
-    myEditor->windowSize.y = height;
-    myEditor->camera->setWindowSize(width, height);
+    myEditor->resizeCallback(width, height);
 }
 
 static void keyCallback(GLFWwindow* window, int key, int scancode, int action, int mods) {
-    myEditor->currentFrameEvent.justKeys[key] = { scancode, action, mods };
+    if (key < 0 || key >= FRAME_EVENT_KEY_COUNT) {
+        return;
+    }
+    myEditor->currentFrameEvent.pressedKeys[key] = (action != GLFW_RELEASE);
+    InputEvent event{ InputEventType::Key, glfwGetTime() };
+    event.code = key;
+    event.action = action;
+    event.mods = mods;
+    myEditor->currentFrameEvent.events.push_back(event);
 }
 
 static void mouseScrollCallback(GLFWwindow* window, double xoffset, double yoffset) {
-    myEditor->currentFrameEvent.mouse.scroll.xOffset = xoffset;
-    myEditor->currentFrameEvent.mouse.scroll.yOffset = yoffset;
+    InputEvent event{ InputEventType::Scroll, glfwGetTime() };
+    event.xOffset = xoffset;
+    event.yOffset = yoffset;
+    myEditor->currentFrameEvent.events.push_back(event);
 }
 
 static void mousePosCallback(GLFWwindow* window, double xposIn, double yposIn) {
@@ -33,7 +50,18 @@ static void mousePosCallback(GLFWwindow* window, double xposIn, double yposIn) {
 }
 
 static void mouseButtonCallback(GLFWwindow* window, int button, int action, int mods) {
-    myEditor->currentFrameEvent.mouse.buttons[button] = { action, mods };
+    InputEvent event{ InputEventType::MouseButton, glfwGetTime() };
+    event.code = button;
+    event.action = action;
+    event.mods = mods;
+    myEditor->currentFrameEvent.events.push_back(event);
+}
+
+static bool isModifierKey(int key) {
+    return key == GLFW_KEY_LEFT_SHIFT || key == GLFW_KEY_RIGHT_SHIFT ||
+        key == GLFW_KEY_LEFT_CONTROL || key == GLFW_KEY_RIGHT_CONTROL ||
+        key == GLFW_KEY_LEFT_ALT || key == GLFW_KEY_RIGHT_ALT ||
+        key == GLFW_KEY_LEFT_SUPER || key == GLFW_KEY_RIGHT_SUPER;
 }
 
 static void windowCloseCallback(GLFWwindow* window) {
@@ -41,7 +69,9 @@ static void windowCloseCallback(GLFWwindow* window) {
 }
 
 static void setCharCallback(GLFWwindow* window, unsigned int codepoint) {
-    myEditor->charCallback(codepoint);
+    InputEvent event{ InputEventType::Char, glfwGetTime() };
+    event.codepoint = codepoint;
+    myEditor->currentFrameEvent.events.push_back(event);
 }
 
 
@@ -49,7 +79,7 @@ Editor::Editor(const char* _filePath) : m_filePath(_filePath) {
     if (!glfwInit()) {
         return;
     }
-    glfwWindowHint(GLFW_RESIZABLE, GLFW_FALSE);
+    glfwWindowHint(GLFW_RESIZABLE, GLFW_TRUE);
     glfwWindowHint(GLFW_CONTEXT_VERSION_MAJOR, 3);
     glfwWindowHint(GLFW_CONTEXT_VERSION_MINOR, 3);
 
@@ -77,20 +107,36 @@ Editor::Editor(const char* _filePath) : m_filePath(_filePath) {
     glfwSetWindowCloseCallback(m_window, windowCloseCallback);
     glfwSetCharCallback(m_window, setCharCallback);
     currentFrameEvent.clear();
+    renderQueue = new RenderQueue();
     camera = new Camera(windowSize.x, windowSize.y);
     camera->setPosition(vec2(-(windowSize.x / 4), (windowSize.y / 4)));
-    m_label = new Label(camera, (m_filePath != "" ? readFileW(s2ws(m_filePath)) : L""));
+    m_label = new Label(camera, Utf8Text());
+    if (m_filePath != "") {
+        std::error_code error;
+        const unsigned long long fileSize = std::filesystem::file_size(m_filePath, error);
+        if (!error && fileSize >= LARGE_FILE_VIEWER_THRESHOLD) {
+            m_largeFile = new LargeFileView(m_filePath);
+        }
+        else {
+            m_fileLoader = new FileLoader(m_filePath);
+        }
+    }
     m_posTween = new Tween();
     m_zoomTween = new Tween();
+    m_scrollTween = new Tween();
+    m_latency = new LatencyTracker();
     m_cursor = new ColorRect(camera);
     m_cursor->setSize(vec2i(2, FONT_SIZE));
+    m_cursor->setLayer(RenderLayer::Cursor);
     m_cursorPosition = 0;
+    applyTheme();
+    fitZoomToText();
     if (m_filePath != "") {
         m_stateVisual = new ColorRect(camera);
         m_stateVisual->setIgnoreViewMatrix(true);
-        m_stateVisual->setPosition(vec2(0.0f, m_windowSizeOrigin.y / 2 - 5));
-        m_stateVisual->setSize(vec2i(m_windowSizeOrigin.x, 10));
-        m_stateVisual->setColor(m_normalStateColor);
+        m_stateVisual->setLayer(RenderLayer::Overlay);
+        m_stateVisual->setColor(m_loadingStateColor);
+        layoutStateVisual();
     }
     updateCursorPos();
 #ifdef BACKGROUND_TEXTURE_PATH
@@ -115,9 +161,9 @@ Editor::Editor(const char* _filePath) : m_filePath(_filePath) {
         2, 3, 0
     };
     glGenVertexArrays(1, &m_backgroundVAO);
-    glBindVertexArray(m_backgroundVAO);
+    GLStateCache::get().bindVertexArray(m_backgroundVAO);
     glGenBuffers(1, &m_backgroundVBO);
-    glBindBuffer(GL_ARRAY_BUFFER, m_backgroundVBO);
+    GLStateCache::get().bindArrayBuffer(m_backgroundVBO);
     glBufferData(GL_ARRAY_BUFFER, 4 * 5 * sizeof(float), vertices, GL_STATIC_DRAW);
     glGenBuffers(1, &m_backgroundEBO);
     glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, m_backgroundEBO);
@@ -136,487 +182,480 @@ Editor::~Editor() {
     glDeleteVertexArrays(1, &m_backgroundVAO);
     delete m_backgroundTexture;
 #endif
-    delete m_label, camera, m_posTween, m_zoomTween;
+    delete m_fileLoader;
+    delete m_largeFile;
+    delete m_follower;
+    delete m_fileSaver;
+    // a journal is only left behind for edits that never reached the file
+    if (m_journal != nullptr && m_state == EditorState::Normal && !m_recoveryOffered) {
+        m_journal->remove();
+    }
+    delete m_journal;
+    delete m_contentHash;
+    delete m_label;
+    delete m_posTween;
+    delete m_zoomTween;
+    delete m_scrollTween;
+    delete m_latency;
+    delete m_cursor;
+    for (auto& rect : m_extraCursorRects) {
+        delete rect;
+    }
+    delete m_latencyOverlay;
+    delete m_overlayCamera;
+    delete m_recoveryPrompt;
+    delete m_recoveryCamera;
+    delete renderQueue;
     if (m_stateVisual != nullptr) {
         delete m_stateVisual;
     }
+    delete camera;
 }
 
 void Editor::run() {
-    bool backspaceStarted = false;
-    bool enterStarted = false;
-    int backspaceCount = 0;
-    int enterCount = 0;
-    const int MAX_COUNT = 32;
-    enum class CursorPos{
-        Left, Right, Up, Down
-    };
-    bool cursorStarted[4] = { false, false, false, false };
-    int cursorCount[4] = { 0, 0, 0, 0 };
-    int cursorFlashCount = 0;
-    int KEYS[4] = { GLFW_KEY_LEFT, GLFW_KEY_RIGHT, GLFW_KEY_UP, GLFW_KEY_DOWN };
-    bool CONDITIONS[4] = {false, false, false, false};
     while (!glfwWindowShouldClose(m_window)) {
-        for (int i = 0; i < 349; i++) { currentFrameEvent.pressedKeys[i] = glfwGetKey(m_window, i); }
-        if (currentFrameEvent.justKeys[GLFW_KEY_F11].action == GLFW_PRESS) {
-            setWindowFullscreen(!m_fullscreen);
-        }
-#pragma region lazy_key_input
-        CONDITIONS[(int)CursorPos::Right] = m_label->getGlyphTextures().size() >= m_cursorPosition + 1;
-        CONDITIONS[(int)CursorPos::Left] = 0 != m_cursorPosition;
-        CONDITIONS[(int)CursorPos::Up] = true;
-        CONDITIONS[(int)CursorPos::Down] = true;
-
-        for (int i = 0; i < 4; i++) {
-            int CUR_KEY = KEYS[i];
-            if (currentFrameEvent.justKeys[CUR_KEY].action == GLFW_PRESS) {
-                cursorFlashCount = 0;
-                m_waitingForEnter = false;
-                m_cursor->setVisible(true);
-                if (cursorStarted[i] == false) {
-                    if (currentFrameEvent.pressedKeys[GLFW_KEY_LEFT_SHIFT] ||
-                        currentFrameEvent.pressedKeys[GLFW_KEY_RIGHT_SHIFT]
-                        ) {
-                            switch (CursorPos(i)) {
-                            case (CursorPos::Right):
-                                m_cursorSelectionPosition++;
-                                break;
-                            case (CursorPos::Left):
-                                if (m_cursorSelectionPosition != 0) {
-                                    m_cursorSelectionPosition--;
-                                }
-                                break;
-                            case (CursorPos::Up):
-                                tryToPushUpCursorSelection();
-                                break;
-                            case (CursorPos::Down):
-                                tryToPushDownCursorSelection();
-                                break;
-                            }
-                            updateCursorSelectionPos();
+#pragma region input_events
+        for (const InputEvent& event : currentFrameEvent.events) {
+            switch (event.type) {
+            case InputEventType::Key:
+                if (event.action != GLFW_RELEASE) {
+                    m_cursorBlinkTime = event.time;
+                    if (!isModifierKey(event.code)) {
+                        m_latency->markInput(event.time);
                     }
-                    else {
-                    if (CONDITIONS[i]) {
-                        switch (CursorPos(i)) {
-                        case (CursorPos::Right):
-                            m_cursorPosition++;
-                            break;
-                        case (CursorPos::Left):
-                            m_cursorPosition--;
-                            break;
-                        case (CursorPos::Up):
-                            tryToPushUpCursor();
-                            break;
-                        case (CursorPos::Down):
-                            tryToPushDownCursor();
-                            break;
-                        }
-                        m_cursorSelectionPosition = m_cursorPosition;
-                        m_cursorSelectionEndPosition = m_cursorSelectionPosition;
-                        updateCursorSelectionPos();
-                        updateCursorPos();
-                    }
-                    }
-                    cursorStarted[i] = true;
+                    keyPress(event.code, event.mods, event.action == GLFW_REPEAT);
                 }
-            }
-            if (currentFrameEvent.pressedKeys[CUR_KEY] == GLFW_RELEASE) {
-                if (cursorStarted[i]) {
-                    cursorStarted[i] = false;
-                    cursorCount[i] = 0;
+                break;
+            case InputEventType::Char:
+                m_cursorBlinkTime = event.time;
+                m_latency->markInput(event.time);
+                insertCharacter(event.codepoint);
+                break;
+            case InputEventType::MouseButton:
+                if (event.code != GLFW_MOUSE_BUTTON_LEFT) {
+                    break;
                 }
-            }
-            if (currentFrameEvent.pressedKeys[CUR_KEY] == GLFW_PRESS) {
-                m_waitingForEnter = false;
-                if (cursorCount[i] == MAX_COUNT) {
-                    if (currentFrameEvent.pressedKeys[GLFW_KEY_LEFT_SHIFT] ||
-                        currentFrameEvent.pressedKeys[GLFW_KEY_RIGHT_SHIFT]
-                        ) {
-                            switch (CursorPos(i)) {
-                            case (CursorPos::Right): {
-                                m_cursorSelectionPosition++;
-                                break;
-                            }
-                            case (CursorPos::Left):
-                                if (m_cursorSelectionPosition != 0) {
-                                    m_cursorSelectionPosition--;
-                                }
-                                break;
-                            case (CursorPos::Up):
-                                tryToPushUpCursorSelection();
-                                break;
-                            case (CursorPos::Down):
-                                tryToPushDownCursorSelection();
-                                break;
-                            }
-                            updateCursorSelectionPos();
-                    }
-                    else {
-                    if (CONDITIONS[i]) {
-                        switch (CursorPos(i)) {
-                        case (CursorPos::Right):
-                            m_cursorPosition++;
-                            break;
-                        case (CursorPos::Left):
-                            m_cursorPosition--;
-                            break;
-                        case (CursorPos::Up):
-                            tryToPushUpCursor();
-                            break;
-                        case (CursorPos::Down):
-                            tryToPushDownCursor();
-                            break;
-                        }
-                        m_cursorSelectionPosition = m_cursorPosition;
-                        m_cursorSelectionEndPosition = m_cursorSelectionPosition;
-                        updateCursorSelectionPos();
-                        updateCursorPos();
-                    }
-                    }
+                if (event.action == GLFW_PRESS) {
+                    m_waitingForEnter = false;
+                    m_cursorBlinkTime = event.time;
+                    mousePress(event.mods, event.time);
                 }
-                else {
-                    if (cursorCount[i] + 1 <= MAX_COUNT) {
-                        cursorCount[i]++;
-                    }
+                else if (event.action == GLFW_RELEASE) {
+                    m_mouseSelecting = false;
+                }
+                break;
+            case InputEventType::Scroll: {
+                const float step = float(FONT_SIZE * SCROLL_LINES_PER_NOTCH);
+                vec2 amount = vec2(float(event.xOffset) * step, -float(event.yOffset) * step);
+                if (currentFrameEvent.pressedKeys[GLFW_KEY_LEFT_SHIFT] || currentFrameEvent.pressedKeys[GLFW_KEY_RIGHT_SHIFT]) {
+                    amount = vec2(-amount.y, 0.0f);
                 }
+                scrollCamera(amount);
+                break;
+            }
             }
         }
 #pragma endregion
-        if (currentFrameEvent.justKeys[GLFW_KEY_BACKSPACE].action == GLFW_PRESS) {
-            if (backspaceStarted == false) {
-                if (m_cursorSelectionPosition != m_cursorSelectionEndPosition) {
-                    size_t targetCount = (m_cursorSelectionPosition < m_cursorSelectionEndPosition ? m_cursorSelectionEndPosition - m_cursorSelectionPosition : m_cursorSelectionPosition - m_cursorSelectionEndPosition);
-                    size_t start = (m_cursorSelectionPosition < m_cursorSelectionEndPosition ? m_cursorSelectionPosition : m_cursorSelectionEndPosition);
-                    for (size_t i = 0; i < targetCount; i++) {
-                        m_label->erase(start);
-                    }
-                    m_cursorPosition = start;
-                    m_cursorSelectionPosition = m_cursorPosition;
-                    m_cursorSelectionEndPosition = m_cursorSelectionPosition;
-                    updateCursorPos();
-                    updateCursorSelectionPos();
-                }
-                else {
-                    if (m_cursorPosition > 0 && m_cursorPosition <= m_label->getGlyphTextures().size()) {
-                        if (m_filePath != "") {
-                            m_state = EditorState::NeedToSaved;
-                            m_stateVisual->setColor(m_needToSavedStateColor);
-                        }
-                        int blockSizeYBefore = m_label->getBlockList().size();
-                        m_cursorPosition--;
-                        m_cursorSelectionPosition = m_cursorPosition;
-                        m_cursorSelectionEndPosition = m_cursorSelectionPosition;
-                        if (m_label->getBelongBlock(m_cursorPosition) == m_label->getLongestBlock()) {
-                            camera->addZoom(vec2(0.01f));
-                        }
-                        m_label->erase(m_cursorPosition);
-                        updateCursorPos();
-                        updateCursorSelectionPos();
-                        int blockSizeYAfter = m_label->getBlockList().size();
-                        if (blockSizeYBefore != blockSizeYAfter) {
-                            m_label->eraseSelectionSection(m_label->getBelongBlock(m_cursorPosition));
-                        }
-                    }
-                }
-                backspaceStarted = true;
-            }
+        if (m_mouseSelecting) {
+            mouseDrag();
         }
-        if (currentFrameEvent.pressedKeys[GLFW_KEY_BACKSPACE] == GLFW_RELEASE) {
-            if (backspaceStarted) {
-                backspaceStarted = false;
-                backspaceCount = 0;
-            }
+        const bool holdingKey =
+            currentFrameEvent.pressedKeys[GLFW_KEY_LEFT] ||
+            currentFrameEvent.pressedKeys[GLFW_KEY_RIGHT] ||
+            currentFrameEvent.pressedKeys[GLFW_KEY_UP] ||
+            currentFrameEvent.pressedKeys[GLFW_KEY_DOWN] ||
+            currentFrameEvent.pressedKeys[GLFW_KEY_BACKSPACE];
+        const bool cursorVisible = holdingKey || std::fmod(glfwGetTime() - m_cursorBlinkTime, CURSOR_BLINK_PERIOD) < CURSOR_BLINK_PERIOD / 2;
+        m_cursor->setVisible(cursorVisible && m_largeFile == nullptr);
+        pollFileLoader();
+        pollFileSaver();
+        pollJournal();
+        pollContentHash();
+        pollFollower();
+        updateLargeFileView();
+        m_zoomTween->update();
+        m_posTween->update();
+        m_scrollTween->update();
+        m_label->update();
+        if (m_label->consumeWrapLayoutChanged()) {
+            updateCursorPos(!m_scrolled);
+            updateCursorSelectionPos();
         }
-        if (currentFrameEvent.pressedKeys[GLFW_KEY_BACKSPACE] == GLFW_PRESS && backspaceStarted) {
-            if (backspaceCount == MAX_COUNT) {
-                if (m_cursorSelectionPosition != m_cursorSelectionEndPosition) {
-                    size_t targetCount = (m_cursorSelectionPosition < m_cursorSelectionEndPosition ? m_cursorSelectionEndPosition - m_cursorSelectionPosition : m_cursorSelectionPosition - m_cursorSelectionEndPosition);
-                    size_t start = (m_cursorSelectionPosition < m_cursorSelectionEndPosition ? m_cursorSelectionPosition : m_cursorSelectionEndPosition);
-                    for (size_t i = 0; i < targetCount; i++) {
-                        m_label->erase(start);
-                    }
-                    m_cursorPosition = start;
-                    m_cursorSelectionPosition = m_cursorPosition;
-                    m_cursorSelectionEndPosition = m_cursorSelectionPosition;
-                    updateCursorPos();
-                    updateCursorSelectionPos();
-                }
-                else {
-                    if (m_cursorPosition > 0 && m_cursorPosition <= m_label->getGlyphTextures().size()) {
-                        if (m_filePath != "") {
-                            m_state = EditorState::NeedToSaved;
-                            m_stateVisual->setColor(m_needToSavedStateColor);
-                        }
-                        int blockSizeYBefore = m_label->getBlockList().size();
-                        m_cursorPosition--;
-                        m_cursorSelectionPosition = m_cursorPosition;
-                        m_cursorSelectionEndPosition = m_cursorSelectionPosition;
-                        if (m_label->getBelongBlock(m_cursorPosition) == m_label->getLongestBlock()) {
-                            camera->addZoom(vec2(0.01f));
-                        }
-                        m_label->erase(m_cursorPosition);
-                        updateCursorPos();
-                        updateCursorSelectionPos();
-                        int blockSizeYAfter = m_label->getBlockList().size();
-                        if (blockSizeYBefore != blockSizeYAfter) {
-                            m_label->eraseSelectionSection(m_label->getBelongBlock(m_cursorPosition));
-                        }
-                    }
-                }
-            }
-            else {
-                if (backspaceCount + 1 <= MAX_COUNT) {
-                    backspaceCount++;
-                }
-            }
+        fitZoomToText();
+        GLStateCache::get().beginFrame();
+        glClearColor(m_backgroundColor.r, m_backgroundColor.g, m_backgroundColor.b, m_backgroundColor.a);
+        glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+#ifdef BACKGROUND_TEXTURE_PATH
+        renderQueue->submitCustom(RenderLayer::Background, m_backgroundShader, m_backgroundTexture->getID(), m_backgroundVAO, [this](Shader* shader) {
+            shader->setVec4("Modulate", vec4(BACKGROUND_TEXTURE_MODULATE_RGB, BACKGROUND_TEXTURE_MODULATE_RGB, BACKGROUND_TEXTURE_MODULATE_RGB, 1.0f));
+            shader->setVec2("TexSize", vec2(windowSize.x, windowSize.y));
+            glDrawElements(GL_TRIANGLES, 6, GL_UNSIGNED_INT, nullptr);
+        });
+#endif
+        m_label->draw();
+        for (const auto& cl : m_highlights) {
+            cl->draw();
         }
-        if (currentFrameEvent.justKeys[GLFW_KEY_ENTER].action == GLFW_PRESS) {
-            if (enterStarted == false) {
-                if (m_filePath != "") {
-                    m_state = EditorState::NeedToSaved;
-                    m_stateVisual->setColor(m_needToSavedStateColor);
-                }
-                float before = m_label->getSize().y;
-                if (m_waitingForEnter) {
-                    m_waitingForEnter = false;
-                    m_label->insert(m_cursorPosition, L'\n');
-                    m_label->addSelectionSection();
-                }
-                m_label->insert(m_cursorPosition, L'\n');
-                if (m_cursorPosition + 1 <= m_label->getGlyphTextures().size()) {
-                    m_cursorPosition++;
-                }
-                m_cursorSelectionPosition = m_cursorPosition;
-                m_cursorSelectionEndPosition = m_cursorSelectionPosition;
-                float after = m_label->getSize().y;
-                updateCursorPos();
-                updateCursorSelectionPos();
-                m_label->addSelectionSection();
-                enterStarted = true;
+        m_cursor->draw();
+        drawExtraCursors(cursorVisible);
+        if (m_stateVisual != nullptr) {
+            m_stateVisual->draw();
+        }
+        if (m_latencyOverlay != nullptr) {
+            if (glfwGetTime() - m_latencyOverlayTime >= LATENCY_OVERLAY_INTERVAL) {
+                m_latencyOverlay->setText(m_latency->getSummary());
+                m_latencyOverlayTime = glfwGetTime();
             }
+            m_latencyOverlay->draw();
+        }
+        if (m_recoveryPrompt != nullptr) {
+            m_recoveryPrompt->draw();
+        }
+        renderQueue->flush(camera->getProjectionMatrix().data());
+        currentFrameEvent.clear();
+#ifdef LATENCY_WAIT_FOR_GPU
+        GLsync frameFence = m_latency->hasPendingInput() ? glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0) : nullptr;
+#endif
+        glfwSwapBuffers(m_window);
+        const double submitTime = glfwGetTime();
+        double completeTime = -1.0;
+#ifdef LATENCY_WAIT_FOR_GPU
+        if (frameFence != nullptr) {
+            glClientWaitSync(frameFence, GL_SYNC_FLUSH_COMMANDS_BIT, LATENCY_FENCE_TIMEOUT);
+            completeTime = glfwGetTime();
+            glDeleteSync(frameFence);
+        }
+#endif
+        m_latency->endFrame(submitTime, completeTime);
+        glfwPollEvents();
+    }
+}
+
+void Editor::keyPress(const int& key, const int& mods, const bool& repeat) {
+    const bool shift = (mods & GLFW_MOD_SHIFT) != 0;
+    const bool control = (mods & GLFW_MOD_CONTROL) != 0;
+    const bool alt = (mods & GLFW_MOD_ALT) != 0;
+    if (m_largeFile != nullptr && viewerKeyPress(key, mods)) {
+        return;
+    }
+    switch (key) {
+    case GLFW_KEY_LEFT:
+    case GLFW_KEY_RIGHT:
+    case GLFW_KEY_UP:
+    case GLFW_KEY_DOWN:
+        m_waitingForEnter = false;
+        if (control && alt && (key == GLFW_KEY_UP || key == GLFW_KEY_DOWN)) {
+            addCursorVertical(key == GLFW_KEY_UP ? -1 : 1);
+            return;
+        }
+        moveCursor(key, shift);
+        moveExtraCursors(key, shift);
+        return;
+    case GLFW_KEY_BACKSPACE:
+        eraseBackward();
+        return;
+    case GLFW_KEY_ENTER:
+        insertNewLine();
+        return;
+    }
+    // everything below fires once per physical press and ignores the OS key repeat
+    if (repeat) {
+        return;
+    }
+    switch (key) {
+    case GLFW_KEY_F11:
+        setWindowFullscreen(!m_fullscreen);
+        break;
+    case GLFW_KEY_ESCAPE:
+        clearExtraCursors();
+        break;
+    case GLFW_KEY_PERIOD:
+        if (shift && alt) {
+            addNextOccurrence();
         }
-        if (currentFrameEvent.pressedKeys[GLFW_KEY_ENTER] == GLFW_RELEASE) {
-            if (enterStarted) {
-                enterStarted = false;
-                enterCount = 0;
+        break;
+    case GLFW_KEY_TAB:
+        if (!m_extraCursors.empty()) {
+            replaceAtCursors(std::wstring(TAB_SIZE, L' '), false);
+            break;
+        }
+        if (m_filePath != "") {
+            m_state = EditorState::NeedToSaved;
+            m_stateVisual->setColor(m_needToSavedStateColor);
+        }
+        for (int i = 0; i < TAB_SIZE; i++) {
+            m_label->insert(m_cursorPosition, L' ');
+            if (m_cursorPosition + 1 <= m_label->getText().size()) {
+                m_cursorPosition++;
+                m_cursorSelectionPosition++;
             }
         }
-        if (currentFrameEvent.pressedKeys[GLFW_KEY_ENTER] == GLFW_PRESS && enterStarted) {
-            if (enterCount == MAX_COUNT) {
-                if (m_filePath != "") {
-                    m_state = EditorState::NeedToSaved;
-                    m_stateVisual->setColor(m_needToSavedStateColor);
-                }
-                float before = m_label->getSize().y;
-                if (m_waitingForEnter) {
-                    m_waitingForEnter = false;
-                    m_label->insert(m_cursorPosition, L'\n');
-                    m_label->addSelectionSection();
-                }
-                m_label->insert(m_cursorPosition, L'\n');
-                if (m_cursorPosition + 1 <= m_label->getGlyphTextures().size()) {
-                    m_cursorPosition++;
+        updateCursorPos();
+        break;
+    case GLFW_KEY_MINUS:
+    case GLFW_KEY_EQUAL:
+        if (control) {
+            tweenCameraZoomOffset(vec2(key == GLFW_KEY_MINUS ? -0.1 : 0.1));
+        }
+        break;
+    case GLFW_KEY_S:
+        if (control && m_state == EditorState::NeedToSaved && m_fileLoader == nullptr) {
+            if (m_filePath != "") {
+                if (m_fileSaver != nullptr) {
+                    m_saveAgain = true;
                 }
-                m_cursorSelectionPosition = m_cursorPosition;
-                m_cursorSelectionEndPosition = m_cursorSelectionPosition;
-                float after = m_label->getSize().y;
-                updateCursorPos();
-                updateCursorSelectionPos();
-                m_label->addSelectionSection();
-            }
-            else {
-                if (enterCount + 1 <= MAX_COUNT) {
-                    enterCount++;
+                else {
+                    startSave();
                 }
             }
         }
-        if (currentFrameEvent.justKeys[GLFW_KEY_TAB].action == GLFW_PRESS) {
+        break;
+    case GLFW_KEY_X:
+        if (control && m_cursorSelectionPosition != m_cursorSelectionEndPosition) {
+            clearExtraCursors();
             if (m_filePath != "") {
                 m_state = EditorState::NeedToSaved;
                 m_stateVisual->setColor(m_needToSavedStateColor);
             }
-            for (int i = 0; i < TAB_SIZE; i++) {
-                m_label->insert(m_cursorPosition, L' ');
-                if (m_cursorPosition + 1 <= m_label->getGlyphTextures().size()) {
-                    m_cursorPosition++;
-                    m_cursorSelectionPosition++;
+            size_t start = (m_cursorSelectionPosition < m_cursorSelectionEndPosition ? m_cursorSelectionPosition : m_cursorSelectionEndPosition);
+            size_t end = (m_cursorSelectionPosition < m_cursorSelectionEndPosition ? m_cursorSelectionEndPosition : m_cursorSelectionPosition);
+            for (size_t i = start; i < end ; i++) {
+                m_label->erase(start);
+                if (m_cursorPosition != 0 && m_cursorPosition != start) {
+                    m_cursorPosition--;
                 }
             }
+            m_cursorPosition = std::clamp((size_t)m_cursorPosition, size_t(0), m_label->getText().size());
+            m_cursorSelectionPosition = std::clamp((size_t)m_cursorSelectionPosition, size_t(0), m_label->getText().size());
+            m_cursorSelectionEndPosition = std::clamp((size_t)m_cursorSelectionEndPosition, size_t(0), m_label->getText().size());
             updateCursorPos();
+            updateCursorSelectionPos();
         }
-        if (currentFrameEvent.justKeys[GLFW_KEY_MINUS].action == GLFW_PRESS || currentFrameEvent.justKeys[GLFW_KEY_EQUAL].action == GLFW_PRESS) {
-            if (currentFrameEvent.pressedKeys[GLFW_KEY_LEFT_CONTROL] ||
-                currentFrameEvent.pressedKeys[GLFW_KEY_RIGHT_CONTROL]
-                ) {
-                if (currentFrameEvent.justKeys[GLFW_KEY_MINUS].action == GLFW_PRESS) {
-                    tweenCameraZoomOffset(vec2(-0.1));
-                }
-                else {
-                    tweenCameraZoomOffset(vec2(0.1));
-                }
-            }
+        break;
+    case GLFW_KEY_C:
+        if (control && m_cursorSelectionPosition != m_cursorSelectionEndPosition) {
+            size_t start = (m_cursorSelectionPosition < m_cursorSelectionEndPosition ? m_cursorSelectionPosition : m_cursorSelectionEndPosition);
+            size_t end = (m_cursorSelectionPosition < m_cursorSelectionEndPosition ? m_cursorSelectionEndPosition : m_cursorSelectionPosition);
+            std::wstring selection = m_label->getText().substr(start, end - start);
+            glfwSetClipboardString(m_window, multibyte2utf8(selection).c_str());
         }
-        if (currentFrameEvent.justKeys[GLFW_KEY_S].action == GLFW_PRESS) {
-            if (currentFrameEvent.pressedKeys[GLFW_KEY_LEFT_CONTROL] || currentFrameEvent.pressedKeys[GLFW_KEY_RIGHT_CONTROL]) {
-                if (m_state == EditorState::NeedToSaved) {
-                    if (m_filePath != "") {
-                        writeFile(s2ws(m_filePath), m_label->getText());
-                        m_state = EditorState::Normal;
-                        m_stateVisual->setColor(m_normalStateColor);
-                    }
-                }
+        break;
+    case GLFW_KEY_V:
+        if (control) {
+            if (m_filePath != "") {
+                m_state = EditorState::NeedToSaved;
+                m_stateVisual->setColor(m_needToSavedStateColor);
             }
-        }
-        if (currentFrameEvent.justKeys[GLFW_KEY_X].action == GLFW_PRESS) {
-            if (currentFrameEvent.pressedKeys[GLFW_KEY_LEFT_CONTROL] || currentFrameEvent.pressedKeys[GLFW_KEY_RIGHT_CONTROL]) {
-                if (m_cursorSelectionPosition != m_cursorSelectionEndPosition) {
-                    if (m_filePath != "") {
-                        m_state = EditorState::NeedToSaved;
-                        m_stateVisual->setColor(m_needToSavedStateColor);
-                    }
-                    size_t start = (m_cursorSelectionPosition < m_cursorSelectionEndPosition ? m_cursorSelectionPosition : m_cursorSelectionEndPosition);
-                    size_t end = (m_cursorSelectionPosition < m_cursorSelectionEndPosition ? m_cursorSelectionEndPosition : m_cursorSelectionPosition);
-                    for (size_t i = start; i < end ; i++) {
-                        m_label->erase(start);
-                        if (m_cursorPosition != 0 && m_cursorPosition != start) {
-                            m_cursorPosition--;
-                        }
-                    }
-                    m_cursorPosition = std::clamp((size_t)m_cursorPosition, size_t(0), m_label->getText().size());
-                    m_cursorSelectionPosition = std::clamp((size_t)m_cursorSelectionPosition, size_t(0), m_label->getText().size());
-                    m_cursorSelectionEndPosition = std::clamp((size_t)m_cursorSelectionEndPosition, size_t(0), m_label->getText().size());
-                    updateCursorPos();
-                    updateCursorSelectionPos();
-                }
+            const char* clipboard = glfwGetClipboardString(m_window);
+            if (clipboard == nullptr) {
+                break;
             }
-        }
-        if (currentFrameEvent.justKeys[GLFW_KEY_C].action == GLFW_PRESS) {
-            if (currentFrameEvent.pressedKeys[GLFW_KEY_LEFT_CONTROL] || currentFrameEvent.pressedKeys[GLFW_KEY_RIGHT_CONTROL]) {
-                if (m_cursorSelectionPosition != m_cursorSelectionEndPosition) {
-                    std::wstring selection = L"";
-                    size_t start = (m_cursorSelectionPosition < m_cursorSelectionEndPosition ? m_cursorSelectionPosition : m_cursorSelectionEndPosition);
-                    size_t end = (m_cursorSelectionPosition < m_cursorSelectionEndPosition ? m_cursorSelectionEndPosition : m_cursorSelectionPosition);
-                    for (size_t i = start; i < end; i++) {
-                        selection += m_label->getText()[i];
-                    }
-                    glfwSetClipboardString(m_window, multibyte2utf8(selection).c_str());
-                }
+            std::wstring last = utf82multibyte(clipboard);
+            if (!m_extraCursors.empty()) {
+                replaceAtCursors(last, false);
+                break;
             }
+            m_label->applyEdits({ TextEdit{ size_t(m_cursorPosition), 0, last } });
+            m_cursorPosition += last.size();
+            m_cursorSelectionPosition = m_cursorPosition;
+            m_cursorSelectionEndPosition = m_cursorSelectionPosition;
+            updateCursorPos();
+            updateCursorSelectionPos();
         }
-        if (currentFrameEvent.justKeys[GLFW_KEY_V].action == GLFW_PRESS) {
-            if (currentFrameEvent.pressedKeys[GLFW_KEY_LEFT_CONTROL] || currentFrameEvent.pressedKeys[GLFW_KEY_RIGHT_CONTROL]) {
-                if (m_filePath != "") {
-                    m_state = EditorState::NeedToSaved;
-                    m_stateVisual->setColor(m_needToSavedStateColor);
-                }
-                std::string last = glfwGetClipboardString(m_window);
-                last = replaceAll(last, "\r", "");
-                for (size_t i = 0; i < last.size(); i++) {
-                    m_label->insert(m_cursorPosition + i, last[i]);
-                }
-                m_cursorPosition += last.size();
-                m_cursorSelectionPosition = m_cursorPosition;
-                m_cursorSelectionEndPosition = m_cursorSelectionPosition;
-                updateCursorPos();
-                updateCursorSelectionPos();
-            }
+        break;
+    case GLFW_KEY_A:
+        if (control && m_label->getText().size() > 0) {
+            clearExtraCursors();
+            m_cursorPosition = m_label->getText().size();
+            m_cursorSelectionPosition = 0;
+            m_cursorSelectionEndPosition = m_cursorPosition;
+            updateCursorPos();
+            updateCursorSelectionPos();
         }
-        if (currentFrameEvent.justKeys[GLFW_KEY_A].action == GLFW_PRESS) {
-            if (currentFrameEvent.pressedKeys[GLFW_KEY_LEFT_CONTROL] || currentFrameEvent.pressedKeys[GLFW_KEY_RIGHT_CONTROL]) {
-                if (m_label->getText().size() > 0) {
-                    m_cursorPosition = m_label->getText().size();
-                    m_cursorSelectionPosition = 0;
-                    m_cursorSelectionEndPosition = m_cursorPosition;
-                    updateCursorPos();
-                    updateCursorSelectionPos();
-                }
+        break;
+    case GLFW_KEY_D:
+        if (control && m_label->getText().size() > 0) {
+            clearExtraCursors();
+            if (m_filePath != "") {
+                m_state = EditorState::NeedToSaved;
+                m_stateVisual->setColor(m_needToSavedStateColor);
             }
-        }
-        if (currentFrameEvent.justKeys[GLFW_KEY_D].action == GLFW_PRESS) {
-            if (currentFrameEvent.pressedKeys[GLFW_KEY_LEFT_CONTROL] || currentFrameEvent.pressedKeys[GLFW_KEY_RIGHT_CONTROL]) {
-                if (m_label->getText().size() > 0) {
-                    if (m_filePath != "") {
-                        m_state = EditorState::NeedToSaved;
-                        m_stateVisual->setColor(m_needToSavedStateColor);
-                    }
-                    std::wstring curLine = L"";
-                    size_t curLineStart = m_label->getBlockList()[m_label->getBelongBlock(m_cursorPosition)].first;
-                    size_t curLineEnd = m_label->getBlockList()[m_label->getBelongBlock(m_cursorPosition)].second;
-                    for (size_t i = curLineStart; i < curLineEnd; i++) {
-                        curLine += m_label->getText()[i];
-                    }
-                    m_label->insert(curLineEnd, L'\n');
-                    m_label->addSelectionSection();
-                    curLineEnd++;
+            std::wstring curLine = L"";
+            size_t curLineStart = m_label->getBlock(m_label->getBelongBlock(m_cursorPosition)).first;
+            size_t curLineEnd = m_label->getBlock(m_label->getBelongBlock(m_cursorPosition)).second;
+            for (size_t i = curLineStart; i < curLineEnd; i++) {
+                curLine += m_label->getText()[i];
+            }
+            m_label->insert(curLineEnd, L'\n');
+            m_label->addSelectionSection();
+            curLineEnd++;
+            m_cursorPosition++;
+            if (curLineStart + 1 < curLineEnd) {
+                for (size_t i = curLine.size() - 1; i > 0; i--) {
+                    m_label->insert(curLineEnd, curLine[i]);
                     m_cursorPosition++;
-                    if (curLineStart + 1 < curLineEnd) {
-                        for (size_t i = curLine.size() - 1; i > 0; i--) {
-                            m_label->insert(curLineEnd, curLine[i]);
-                            m_cursorPosition++;
-                        }
-                        m_label->insert(curLineEnd, curLine[0]);
-                        m_cursorPosition++;
-                    }
-                    m_cursorSelectionPosition = m_cursorPosition;
-                    m_cursorSelectionEndPosition = m_cursorSelectionPosition;
-                    updateCursorPos();
-                    updateCursorSelectionPos();
                 }
+                m_label->insert(curLineEnd, curLine[0]);
+                m_cursorPosition++;
             }
+            m_cursorSelectionPosition = m_cursorPosition;
+            m_cursorSelectionEndPosition = m_cursorSelectionPosition;
+            updateCursorPos();
+            updateCursorSelectionPos();
         }
-        if (currentFrameEvent.justKeys[GLFW_KEY_F1].action == GLFW_PRESS) {
-            m_label->toggleRainbow();
-        }
-        if (0 <= cursorFlashCount && cursorFlashCount < 30) {
-            m_cursor->setVisible(true);
+        break;
+    case GLFW_KEY_F1:
+        m_label->toggleRainbow();
+        break;
+    case GLFW_KEY_F2:
+        m_label->toggleGpuTextLayout();
+        break;
+    case GLFW_KEY_F3:
+        m_label->cycleTheme();
+        applyTheme();
+        break;
+    case GLFW_KEY_F5:
+        toggleLatencyOverlay();
+        break;
+    case GLFW_KEY_F6:
+        m_latency->dumpReport(LATENCY_REPORT_PATH);
+        break;
+    case GLFW_KEY_F7:
+        toggleFollow();
+        break;
+    case GLFW_KEY_F8:
+        restoreJournal();
+        break;
+    case GLFW_KEY_F4:
+        m_label->toggleSoftWrap();
+        m_fittedLineWidth = -1;
+        if (m_label->isSoftWrap()) {
+            camera->setZoom(vec2(1.0f));
         }
-        else if (30 <= cursorFlashCount && cursorFlashCount < 60) {
-            if (!backspaceStarted &&
-                !cursorStarted[0] &&
-                !cursorStarted[1] &&
-                !cursorStarted[2] &&
-                !cursorStarted[3]
-                ) {
-                m_cursor->setVisible(false);
+        updateWrapWidth();
+        updateCursorPos();
+        updateCursorSelectionPos();
+        break;
+    }
+}
+
+void Editor::moveCursor(const int& key, const bool& select) {
+    if (select) {
+        switch (key) {
+        case GLFW_KEY_RIGHT:
+            m_cursorSelectionPosition++;
+            break;
+        case GLFW_KEY_LEFT:
+            if (m_cursorSelectionPosition != 0) {
+                m_cursorSelectionPosition--;
             }
+            break;
+        case GLFW_KEY_UP:
+            tryToPushUpCursorSelection();
+            break;
+        case GLFW_KEY_DOWN:
+            tryToPushDownCursorSelection();
+            break;
         }
-        else {
-            cursorFlashCount = 0;
+        updateCursorSelectionPos();
+        return;
+    }
+    switch (key) {
+    case GLFW_KEY_RIGHT:
+        if (m_label->getText().size() < m_cursorPosition + 1) {
+            return;
         }
-        m_zoomTween->update();
-        m_posTween->update();
-        m_label->update();
-        cursorFlashCount++;
-        glClearColor(m_backgroundColor.r, m_backgroundColor.g, m_backgroundColor.b, m_backgroundColor.a);
-        glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
-#ifdef BACKGROUND_TEXTURE_PATH
-        {
-            glBindVertexArray(m_backgroundVAO);
-            m_backgroundShader->use();
-            m_backgroundTexture->bind();
-            m_backgroundShader->setMat4("ProjectionMatrix", camera->getProjectionMatrix().data());
-            m_backgroundShader->setVec4("Modulate", vec4(BACKGROUND_TEXTURE_MODULATE_RGB, BACKGROUND_TEXTURE_MODULATE_RGB, BACKGROUND_TEXTURE_MODULATE_RGB, 1.0f));
-            m_backgroundShader->setVec2("TexSize", vec2(windowSize.x, windowSize.y));
-            glDrawElements(GL_TRIANGLES, 6, GL_UNSIGNED_INT, nullptr);
-            m_backgroundShader->unuse();
-            glBindVertexArray(0);
+        m_cursorPosition++;
+        break;
+    case GLFW_KEY_LEFT:
+        if (m_cursorPosition == 0) {
+            return;
         }
-#endif
-        m_label->draw();
-        for (const auto& cl : m_highlights) {
-            cl->draw();
+        m_cursorPosition--;
+        break;
+    case GLFW_KEY_UP:
+        tryToPushUpCursor();
+        break;
+    case GLFW_KEY_DOWN:
+        tryToPushDownCursor();
+        break;
+    }
+    m_cursorSelectionPosition = m_cursorPosition;
+    m_cursorSelectionEndPosition = m_cursorSelectionPosition;
+    updateCursorSelectionPos();
+    updateCursorPos();
+}
+
+void Editor::eraseBackward() {
+    if (!m_extraCursors.empty()) {
+        replaceAtCursors(L"", true);
+        return;
+    }
+    if (m_cursorSelectionPosition != m_cursorSelectionEndPosition) {
+        size_t targetCount = (m_cursorSelectionPosition < m_cursorSelectionEndPosition ? m_cursorSelectionEndPosition - m_cursorSelectionPosition : m_cursorSelectionPosition - m_cursorSelectionEndPosition);
+        size_t start = (m_cursorSelectionPosition < m_cursorSelectionEndPosition ? m_cursorSelectionPosition : m_cursorSelectionEndPosition);
+        for (size_t i = 0; i < targetCount; i++) {
+            m_label->erase(start);
         }
-        m_cursor->draw();
-        if (m_stateVisual != nullptr) {
-            m_stateVisual->draw();
+        m_cursorPosition = start;
+        m_cursorSelectionPosition = m_cursorPosition;
+        m_cursorSelectionEndPosition = m_cursorSelectionPosition;
+        updateCursorPos();
+        updateCursorSelectionPos();
+        return;
+    }
+    if (m_cursorPosition > 0 && m_cursorPosition <= m_label->getText().size()) {
+        if (m_filePath != "") {
+            m_state = EditorState::NeedToSaved;
+            m_stateVisual->setColor(m_needToSavedStateColor);
+        }
+        int blockSizeYBefore = m_label->getBlockCount();
+        m_cursorPosition--;
+        m_cursorSelectionPosition = m_cursorPosition;
+        m_cursorSelectionEndPosition = m_cursorSelectionPosition;
+        m_label->erase(m_cursorPosition);
+        updateCursorPos();
+        updateCursorSelectionPos();
+        int blockSizeYAfter = m_label->getBlockCount();
+        if (blockSizeYBefore != blockSizeYAfter) {
+            m_label->eraseSelectionSection(m_label->getBelongBlock(m_cursorPosition));
         }
-        currentFrameEvent.clear();
-        glfwSwapBuffers(m_window);
-        glfwPollEvents();
     }
 }
 
-void Editor::charCallback(unsigned int codepoint) {
+void Editor::insertNewLine() {
+    if (!m_extraCursors.empty()) {
+        replaceAtCursors(L"\n", false);
+        return;
+    }
+    if (m_filePath != "") {
+        m_state = EditorState::NeedToSaved;
+        m_stateVisual->setColor(m_needToSavedStateColor);
+    }
+    if (m_waitingForEnter) {
+        m_waitingForEnter = false;
+        m_label->insert(m_cursorPosition, L'\n');
+        m_label->addSelectionSection();
+    }
+    m_label->insert(m_cursorPosition, L'\n');
+    if (m_cursorPosition + 1 <= m_label->getText().size()) {
+        m_cursorPosition++;
+    }
+    m_cursorSelectionPosition = m_cursorPosition;
+    m_cursorSelectionEndPosition = m_cursorSelectionPosition;
+    updateCursorPos();
+    updateCursorSelectionPos();
+    m_label->addSelectionSection();
+}
+
+void Editor::insertCharacter(const unsigned int& codepoint) {
+    if (m_largeFile != nullptr) {
+        return;
+    }
+    if (!m_extraCursors.empty()) {
+        replaceAtCursors(std::wstring(1, wchar_t(codepoint)), false);
+        return;
+    }
     if (m_filePath != "") {
         m_state = EditorState::NeedToSaved;
         m_stateVisual->setColor(m_needToSavedStateColor);
@@ -624,7 +663,7 @@ void Editor::charCallback(unsigned int codepoint) {
     if (wchar_t(codepoint) == L'{') {
         m_waitingForEnter = true;
         m_label->insert(m_cursorPosition, codepoint);
-        if (m_cursorPosition + 1 <= m_label->getGlyphTextures().size()) {
+        if (m_cursorPosition + 1 <= m_label->getText().size()) {
             m_cursorPosition++;
             m_cursorSelectionPosition = m_cursorPosition;
             m_cursorSelectionEndPosition = m_cursorSelectionPosition;
@@ -636,16 +675,28 @@ void Editor::charCallback(unsigned int codepoint) {
     float before = m_label->getSize().x;
     m_label->insert(m_cursorPosition, codepoint);
     float after = m_label->getSize().x;
-    if (m_cursorPosition + 1 <= m_label->getGlyphTextures().size()) {
+    if (m_cursorPosition + 1 <= m_label->getText().size()) {
         m_cursorPosition++;
         m_cursorSelectionPosition = m_cursorPosition;
         m_cursorSelectionEndPosition = m_cursorSelectionPosition;
-        camera->addZoom(vec2(-0.01f));
     }
     updateCursorPos();
     updateCursorSelectionPos();
 }
 
+void Editor::resizeCallback(int width, int height) {
+    if (width <= 0 || height <= 0) {
+        return;
+    }
+    glViewport(0, 0, width, height);
+    windowSize.x = width;
+    windowSize.y = height;
+    camera->setWindowSize(width, height);
+    layoutStateVisual();
+    layoutLatencyOverlay();
+    updateWrapWidth();
+}
+
 void Editor::setWindowFullscreen(const bool& flag) {
     m_fullscreen = flag;
     GLFWmonitor* monitor = glfwGetPrimaryMonitor();
@@ -665,37 +716,28 @@ void Editor::setWindowFullscreen(const bool& flag) {
     glfwSwapInterval(1);
     glViewport(0, 0, windowSize.x, windowSize.y);
     myEditor->camera->setWindowSize(windowSize.x, windowSize.y);
-    if (m_stateVisual != nullptr) {
-        m_stateVisual->setPosition(vec2(0.0f, windowSize.y / 2 - 5));
-        m_stateVisual->setSize(vec2i(windowSize.x, 10));
-    }
+    layoutStateVisual();
+    layoutLatencyOverlay();
+    updateWrapWidth();
 }
 
-void Editor::updateCursorPos() {
-    vec2 pos = vec2();
-    if (m_cursorPosition == 0) {
-        pos.x = 0.0f;
-        pos.y = 10;
+void Editor::updateCursorPos(const bool& followCamera) {
+    const TextLayoutPosition layout = m_label->getLayoutPosition(m_cursorPosition);
+    vec2 pos = vec2(layout.X, 10 + FONT_SIZE * float(layout.Row));
+    vec2 factor = vec2(m_cursor->getPosition()) - pos;
+    m_cursor->setPosition(pos);
+    if (followCamera) {
+        // bring the view back from wherever the wheel left it before following the cursor again
+        m_scrollTween->clear();
+        if (m_scrolled) {
+            camera->setPosition(m_scrollOrigin);
+            m_scrolled = false;
+        }
+        camera->addPosition(vec2(factor.x, -factor.y));
     }
     else {
-        int escapeSequenceCount = 0;
-        for (unsigned long long i = 0; i < m_cursorPosition; i++) {
-            if (m_label->getGlyphTextures()[i].has_value() && m_label->getGlyphTextures()[i].value() != nullptr) {
-                pos.x += (m_label->getGlyphTextures()[i].value()->getAdvanceX() >> 6);
-            }
-            else {
-                escapeSequenceCount++;
-                pos.x = 0.0f;
-                pos.y = 10 + FONT_SIZE * escapeSequenceCount;
-            }
-        }
-        if (pos.y == 0.0f) {
-            pos.y = 10;
-        }
+        m_scrolled = false;
     }
-    vec2 factor = vec2(m_cursor->getPosition()) - pos;
-    m_cursor->setPosition(pos);
-    camera->addPosition(vec2(factor.x, -factor.y));
 }
 
 void Editor::updateCursorSelectionPos() {
@@ -718,28 +760,26 @@ void Editor::tryToPushUpCursor(){
         return;
     }
     int targetBlockIndex = belongBlockIndex - 1;
-    const std::vector<std::pair<int, int>>& blockList = m_label->getBlockList();
-    const std::pair<int, int>& belongBlock = blockList[belongBlockIndex];
-    const std::pair<int, int>& targetBlock = blockList[targetBlockIndex];
+    const std::pair<int, int> belongBlock = m_label->getBlock(belongBlockIndex);
+    const std::pair<int, int> targetBlock = m_label->getBlock(targetBlockIndex);
     const int currentLength = m_cursorPosition - belongBlock.first;
     m_cursorPosition = clamp(targetBlock.first + currentLength, targetBlock.first, targetBlock.second);
 }
 
 void Editor::tryToPushDownCursor() {
     int belongBlockIndex = m_label->getBelongBlock(m_cursorPosition);
-    if (belongBlockIndex >= m_label->getBlockList().size() + 1) {
+    if (belongBlockIndex >= m_label->getBlockCount() + 1) {
         return;
     }
     if (belongBlockIndex == -1) {
         belongBlockIndex = 0;
     }
     int targetBlockIndex = belongBlockIndex + 1;
-    if (targetBlockIndex >= m_label->getBlockList().size()) {
+    if (targetBlockIndex >= m_label->getBlockCount()) {
         return;
     }
-    const std::vector<std::pair<int, int>>& blockList = m_label->getBlockList();
-    const std::pair<int, int>& belongBlock = blockList[belongBlockIndex];
-    const std::pair<int, int>& targetBlock = blockList[targetBlockIndex];
+    const std::pair<int, int> belongBlock = m_label->getBlock(belongBlockIndex);
+    const std::pair<int, int> targetBlock = m_label->getBlock(targetBlockIndex);
     const int currentLength = m_cursorPosition - belongBlock.first;
     m_cursorPosition = clamp(targetBlock.first + currentLength, targetBlock.first, targetBlock.second);
 }
@@ -750,28 +790,26 @@ void Editor::tryToPushUpCursorSelection() {
         return;
     }
     int targetBlockIndex = belongBlockIndex - 1;
-    const std::vector<std::pair<int, int>>& blockList = m_label->getBlockList();
-    const std::pair<int, int>& belongBlock = blockList[belongBlockIndex];
-    const std::pair<int, int>& targetBlock = blockList[targetBlockIndex];
+    const std::pair<int, int> belongBlock = m_label->getBlock(belongBlockIndex);
+    const std::pair<int, int> targetBlock = m_label->getBlock(targetBlockIndex);
     const int currentLength = m_cursorSelectionPosition - belongBlock.first;
     m_cursorSelectionPosition = clamp(targetBlock.first + currentLength, targetBlock.first, targetBlock.second);
 }
 
 void Editor::tryToPushDownCursorSelection() {
     int belongBlockIndex = m_label->getBelongBlock(m_cursorSelectionPosition);
-    if (belongBlockIndex >= m_label->getBlockList().size() + 1) {
+    if (belongBlockIndex >= m_label->getBlockCount() + 1) {
         return;
     }
     if (belongBlockIndex == -1) {
         belongBlockIndex = 0;
     }
     int targetBlockIndex = belongBlockIndex + 1;
-    if (targetBlockIndex >= m_label->getBlockList().size()) {
+    if (targetBlockIndex >= m_label->getBlockCount()) {
         return;
     }
-    const std::vector<std::pair<int, int>>& blockList = m_label->getBlockList();
-    const std::pair<int, int>& belongBlock = blockList[belongBlockIndex];
-    const std::pair<int, int>& targetBlock = blockList[targetBlockIndex];
+    const std::pair<int, int> belongBlock = m_label->getBlock(belongBlockIndex);
+    const std::pair<int, int> targetBlock = m_label->getBlock(targetBlockIndex);
     const int currentLength = m_cursorSelectionPosition - belongBlock.first;
     m_cursorSelectionPosition = clamp(targetBlock.first + currentLength, targetBlock.first, targetBlock.second);
 }
@@ -815,4 +853,797 @@ void Editor::tweenCameraZoomOffset(const vec2& amount) {
     }
     m_zoomTween->interpolateProperty(info);
     m_zoomTween->start();
-}
\ No newline at end of file
+}
+
+void Editor::scrollCamera(const vec2& amount) {
+    const vec2 position = camera->getPosition();
+    if (!m_scrolled) {
+        m_scrollOrigin = position;
+        m_scrolled = true;
+    }
+    if (m_scrollTween->getIsEmpty()) {
+        m_scrollTarget = position;
+    }
+    // the viewer's label only holds a window of the file, so its rows are offset to absolute line numbers
+    const float firstRow = float(m_label->getFirstVisibleRow()) + (m_largeFile != nullptr ? float(m_largeFileFirstLine) : 0.0f);
+    const float lastRow = (m_largeFile != nullptr ? float(m_largeFile->getLineCount()) : float(m_label->getRowCount())) - 1.0f;
+    vec2 target = m_scrollTarget + amount;
+    target.y = std::clamp(target.y, position.y - firstRow * FONT_SIZE, std::max(position.y, position.y + (lastRow - firstRow) * FONT_SIZE));
+    target.x = std::clamp(target.x, std::min(position.x, -float(m_label->getLongestBlockWidth())), std::max(position.x, 0.0f));
+    m_scrollTarget = target;
+    m_label->prefetch((long long)std::ceil((target.y - position.y) / FONT_SIZE));
+    // every notch restarts a decelerating tween from where the camera is now, so quick flicks keep their momentum
+    m_scrollTween->clear();
+    TweenInfo info; {
+        info.Object = camera;
+        info.StartValue = position;
+        info.EndValue = target;
+        info.PropertyType = TweenablePropertyType::CameraPosition;
+        info.TransitionType = TweenTransitionType::TRANS_SINE;
+        info.Duration = SCROLL_INERTIA_DURATION;
+    }
+    m_scrollTween->interpolateProperty(info);
+    m_scrollTween->start();
+}
+
+void Editor::applyTheme() {
+    const Theme& theme = m_label->getTheme();
+    m_backgroundColor = theme.Background;
+    m_cursor->setColor(theme.Cursor);
+}
+
+void Editor::fitZoomToText() {
+    if (m_label->isSoftWrap()) {
+        return;
+    }
+    const int width = m_label->getLongestBlockWidth();
+    if (width == m_fittedLineWidth) {
+        return;
+    }
+    // every window of a large file has its own longest line, only zoom out so scrolling does not pump the zoom
+    if (m_largeFile != nullptr && width < m_fittedLineWidth) {
+        return;
+    }
+    m_fittedLineWidth = width;
+    camera->setZoom(vec2(float(windowSize.x) / float(width + AUTO_FIT_ZOOM_MARGIN)));
+}
+
+void Editor::updateWrapWidth() {
+    m_label->setWrapWidth(int(float(windowSize.x) / camera->getZoom().x) - AUTO_FIT_ZOOM_MARGIN);
+}
+
+unsigned long long Editor::hitTestMouse() {
+    int width = 0;
+    int height = 0;
+    glfwGetWindowSize(m_window, &width, &height);
+    vec2 screen = vec2(float(currentFrameEvent.mouse.pos.xPos), float(currentFrameEvent.mouse.pos.yPos));
+    if (width > 0 && height > 0) {
+        screen.x *= float(windowSize.x) / float(width);
+        screen.y *= float(windowSize.y) / float(height);
+    }
+    return m_label->getOffsetAt(camera->screenToWorld(screen));
+}
+
+void Editor::mousePress(const int& mods, const double& now) {
+    if (m_largeFile != nullptr) {
+        return;
+    }
+    const unsigned long long offset = hitTestMouse();
+    if (mods & GLFW_MOD_ALT) {
+        m_extraCursors.push_back(EditorCursor{ offset, offset });
+        normalizeExtraCursors();
+        return;
+    }
+    clearExtraCursors();
+    m_mouseSelecting = true;
+    if (mods & GLFW_MOD_SHIFT) {
+        m_cursorSelectionPosition = offset;
+        updateCursorSelectionPos();
+        return;
+    }
+    if (now - m_lastClickTime <= DOUBLE_CLICK_INTERVAL && offset == m_lastClickOffset) {
+        size_t start = 0;
+        size_t end = 0;
+        m_label->getWordAt(offset, start, end);
+        m_cursorPosition = start;
+        m_cursorSelectionPosition = end;
+        m_lastClickTime = -1.0;
+        m_mouseSelecting = false;
+        updateCursorPos(false);
+        updateCursorSelectionPos();
+        return;
+    }
+    m_lastClickTime = now;
+    m_lastClickOffset = offset;
+    m_cursorPosition = offset;
+    m_cursorSelectionPosition = offset;
+    m_cursorSelectionEndPosition = offset;
+    updateCursorPos(false);
+    updateCursorSelectionPos();
+}
+
+void Editor::mouseDrag() {
+    const unsigned long long offset = hitTestMouse();
+    if (offset == m_cursorSelectionPosition) {
+        return;
+    }
+    m_cursorSelectionPosition = offset;
+    updateCursorSelectionPos();
+}
+
+void Editor::toggleLatencyOverlay() {
+    if (m_latencyOverlay != nullptr) {
+        delete m_latencyOverlay;
+        delete m_overlayCamera;
+        m_latencyOverlay = nullptr;
+        m_overlayCamera = nullptr;
+        return;
+    }
+    m_overlayCamera = new Camera(windowSize.x, windowSize.y);
+    m_overlayCamera->addZoomOffset(vec2(LATENCY_OVERLAY_SCALE - 1.0f));
+    m_latencyOverlay = new Label(m_overlayCamera, m_latency->getSummary());
+    m_latencyOverlay->setLayer(RenderLayer::Overlay);
+    m_latencyOverlayTime = glfwGetTime();
+    layoutLatencyOverlay();
+}
+
+void Editor::layoutLatencyOverlay() {
+    // pin the first line to the top left corner of the window
+    for (Camera* overlay : { m_overlayCamera, m_recoveryCamera }) {
+        if (overlay == nullptr) {
+            continue;
+        }
+        overlay->setWindowSize(windowSize.x, windowSize.y);
+        overlay->setPosition(vec2(
+            -windowSize.x / 2.0f + FONT_SIZE * LATENCY_OVERLAY_SCALE,
+            windowSize.y / 2.0f - FONT_SIZE * LATENCY_OVERLAY_SCALE
+        ));
+    }
+    // the recovery prompt keeps the top line, the latency figures go below it
+    if (m_latencyOverlay != nullptr) {
+        const float promptRows = (m_recoveryPrompt != nullptr ? float(m_recoveryPrompt->getRowCount()) : 0.0f);
+        m_latencyOverlay->setPosition(vec2(0.0f, promptRows * FONT_SIZE));
+    }
+}
+
+void Editor::layoutStateVisual() {
+    if (m_stateVisual == nullptr) {
+        return;
+    }
+    // while the file is still being read the bar fills up from the left
+    float progress = 1.0f;
+    if (m_fileLoader != nullptr) {
+        progress = std::clamp(m_fileLoader->getProgress(), 0.0f, 1.0f);
+    }
+    else if (m_largeFile != nullptr) {
+        progress = std::clamp(m_largeFile->getProgress(), 0.0f, 1.0f);
+    }
+    const int width = int(float(windowSize.x) * progress);
+    m_stateVisual->setPosition(vec2(float(width - windowSize.x) / 2.0f, windowSize.y / 2 - 5));
+    m_stateVisual->setSize(vec2i(width, 10));
+}
+
+void Editor::pollFileLoader() {
+    if (m_fileLoader == nullptr) {
+        return;
+    }
+    // hand the pieces that are ready to the label, but only for as long as the frame can afford
+    const double deadline = glfwGetTime() + FILE_LOADER_FRAME_BUDGET;
+    std::string chunk;
+    while (m_fileLoader->takeChunk(chunk)) {
+        m_label->appendText(chunk);
+        if (glfwGetTime() >= deadline) {
+            break;
+        }
+    }
+    if (m_fileLoader->isFinished()) {
+        m_textFormat = m_fileLoader->getFormat();
+        m_loadedFileSize = m_fileLoader->getFileSize();
+        std::vector<SourceSpan> sourceMap = m_fileLoader->takeSourceMap();
+        const size_t textSize = (sourceMap.empty() ? 0 : sourceMap.back().Text + sourceMap.back().TextLength);
+        // text typed while the file was still loading is not in the file, so nothing can be copied from it
+        if (m_state == EditorState::Normal) {
+            m_sourceMap = std::move(sourceMap);
+            m_label->resetChangeTracking();
+        }
+        delete m_fileLoader;
+        m_fileLoader = nullptr;
+        m_contentHash = new ContentHash();
+        m_contentHash->build(m_label->getText().getBytes());
+        // text typed while the file was loading is already mixed in, so the file's digest is only known after a save
+        m_savedDigest = m_contentHash->update(m_label->getText().getBytes());
+        m_savedDigestKnown = (m_state == EditorState::Normal);
+        openJournal(textSize);
+        m_label->setEditListener([this](const size_t& byte, const size_t& erasedBytes, const std::string& inserted) {
+            m_contentHash->noteEdit(byte, erasedBytes, inserted.size());
+            if (m_readingFollowedFile) {
+                return;
+            }
+            m_journal->record(byte, erasedBytes, inserted);
+            m_journalEdited = true;
+        });
+        if (m_stateVisual != nullptr && m_state == EditorState::Normal) {
+            m_stateVisual->setColor(m_normalStateColor);
+        }
+    }
+    layoutStateVisual();
+}
+
+void Editor::updateLargeFileView() {
+    if (m_largeFile == nullptr) {
+        return;
+    }
+    if (m_stateVisual != nullptr) {
+        // the bar fills up while the line index is built, the view is usable the whole time
+        m_stateVisual->setColor(m_largeFile->isIndexed() ? m_normalStateColor : m_loadingStateColor);
+        layoutStateVisual();
+    }
+    const long long top = m_label->getFirstVisibleRow() - 1;
+    const long long bottom = top + (long long)std::ceil(float(windowSize.y) / camera->getZoom().y / FONT_SIZE) + 1;
+    const long long first = (long long)m_largeFileFirstLine;
+    const long long margin = LARGE_FILE_VIEW_WINDOW_LINES / 4;
+    const bool loaded = m_largeFileLoadedLines != 0;
+    const bool nearTop = first > 0 && top < margin;
+    const bool nearBottom = !m_largeFileAtEnd && bottom > (long long)m_largeFileLoadedLines - margin;
+    if (loaded && !nearTop && !nearBottom) {
+        return;
+    }
+    // recentre the window on the viewport and move the label so its lines keep their absolute positions
+    const long long lineCount = (long long)m_largeFile->getLineCount();
+    const long long center = first + (top + bottom) / 2;
+    const long long newFirst = std::clamp(center - LARGE_FILE_VIEW_WINDOW_LINES / 2, 0LL, std::max(lineCount - 1, 0LL));
+    // a full window that would not move has nothing new to show, a short one may have grown at the end of the file
+    if (loaded && newFirst == first && m_largeFileLoadedLines == LARGE_FILE_VIEW_WINDOW_LINES) {
+        return;
+    }
+    size_t loadedLines = 0;
+    m_label->setText(Utf8Text::fromUtf8(m_largeFile->getLines(size_t(newFirst), LARGE_FILE_VIEW_WINDOW_LINES, loadedLines)));
+    m_label->setPosition(vec2(m_label->getPosition().x, float(newFirst) * FONT_SIZE));
+    m_largeFileFirstLine = size_t(newFirst);
+    m_largeFileLoadedLines = loadedLines;
+    m_largeFileAtEnd = m_largeFile->isIndexed() && m_largeFileFirstLine + loadedLines >= m_largeFile->getLineCount();
+}
+
+bool Editor::viewerKeyPress(const int& key, const int& mods) {
+    const bool control = (mods & GLFW_MOD_CONTROL) != 0;
+    const float page = float(windowSize.y) / camera->getZoom().y;
+    switch (key) {
+    case GLFW_KEY_UP:
+        scrollCamera(vec2(0.0f, -float(FONT_SIZE)));
+        return true;
+    case GLFW_KEY_DOWN:
+        scrollCamera(vec2(0.0f, float(FONT_SIZE)));
+        return true;
+    case GLFW_KEY_LEFT:
+        scrollCamera(vec2(-float(FONT_SIZE), 0.0f));
+        return true;
+    case GLFW_KEY_RIGHT:
+        scrollCamera(vec2(float(FONT_SIZE), 0.0f));
+        return true;
+    case GLFW_KEY_PAGE_UP:
+        scrollCamera(vec2(0.0f, -page));
+        return true;
+    case GLFW_KEY_PAGE_DOWN:
+        scrollCamera(vec2(0.0f, page));
+        return true;
+    case GLFW_KEY_HOME:
+    case GLFW_KEY_END:
+        if (control) {
+            // the scroll clamps to the first and last line, so any distance past the file will do
+            const float lines = float(m_largeFile->getLineCount()) * FONT_SIZE;
+            scrollCamera(vec2(0.0f, key == GLFW_KEY_HOME ? -lines : lines));
+        }
+        return true;
+    case GLFW_KEY_F1:
+    case GLFW_KEY_F2:
+    case GLFW_KEY_F3:
+    case GLFW_KEY_F5:
+    case GLFW_KEY_F6:
+    case GLFW_KEY_F7:
+    case GLFW_KEY_F11:
+        return false;
+    case GLFW_KEY_MINUS:
+    case GLFW_KEY_EQUAL:
+        return !control;
+    }
+    // the viewer is read-only, nothing else may reach the editing keys
+    return true;
+}
+
+void Editor::startSave() {
+    // the snapshot shares the text's bytes, encoding and writing them happen on the saver's thread
+    const Utf8Text& text = m_label->getText();
+    m_savingRevision = m_label->getRevision();
+    m_savingPrefix = text.getUnchangedPrefix();
+    m_savingSuffix = text.getUnchangedSuffix();
+    m_savingTextSize = text.getBytes().size();
+    if (m_contentHash != nullptr) {
+        m_savingDigest = m_contentHash->update(text.getBytes());
+    }
+    m_fileSaver = new FileSaver(m_filePath, text.shareBytes(), m_savingPrefix, m_savingSuffix, m_textFormat, m_sourceMap, m_loadedFileSize);
+    // edits from now on are tracked against the snapshot, which is what the file will hold
+    m_label->resetChangeTracking();
+}
+
+void Editor::pollFileSaver() {
+    if (m_fileSaver == nullptr || !m_fileSaver->isFinished()) {
+        return;
+    }
+    if (m_fileSaver->hasSucceeded()) {
+        m_sourceMap = m_fileSaver->takeSourceMap();
+        // follow again from the end of what was just written
+        m_loadedFileSize = m_fileSaver->getWrittenBytes();
+        delete m_follower;
+        m_follower = nullptr;
+        // the journal starts over from the new file, keeping only what was typed during the save
+        if (m_journal != nullptr) {
+            rebaseJournal(m_savingTextSize);
+        }
+        m_savedDigest = m_savingDigest;
+        m_savedDigestKnown = true;
+    }
+    else {
+        // the file still holds the old content, so the edits in the snapshot count as changes again
+        m_label->limitUnchanged(m_savingPrefix, m_savingSuffix);
+    }
+    delete m_fileSaver;
+    m_fileSaver = nullptr;
+    // edits made while the snapshot was being written still need a save of their own, unless they were undone
+    if (m_contentHash != nullptr) {
+        updateModifiedState();
+    }
+    else if (m_label->getRevision() == m_savingRevision) {
+        m_state = EditorState::Normal;
+        m_stateVisual->setColor(m_normalStateColor);
+    }
+    if (m_saveAgain) {
+        m_saveAgain = false;
+        if (m_state == EditorState::NeedToSaved) {
+            startSave();
+        }
+    }
+}
+
+void Editor::openJournal(const size_t& textSize) {
+    const JournalHeader current = EditJournal::identify(m_filePath, textSize);
+    m_journal = new EditJournal(m_filePath, current);
+    JournalHeader header;
+    std::vector<JournalRecord> records;
+    if (m_state == EditorState::Normal && EditJournal::read(m_filePath, header, records) && !records.empty() &&
+        header.FileSize == current.FileSize && header.FileTime == current.FileTime && header.TextSize == current.TextSize) {
+        setRecoveryOffered(true);
+        m_stateVisual->setColor(m_recoveryStateColor);
+    }
+    else {
+        rebaseJournal(textSize);
+    }
+}
+
+void Editor::setRecoveryOffered(const bool& offered) {
+    m_recoveryOffered = offered;
+    delete m_recoveryPrompt;
+    delete m_recoveryCamera;
+    m_recoveryPrompt = nullptr;
+    m_recoveryCamera = nullptr;
+    if (offered) {
+        m_recoveryCamera = new Camera(windowSize.x, windowSize.y);
+        m_recoveryCamera->addZoomOffset(vec2(LATENCY_OVERLAY_SCALE - 1.0f));
+        m_recoveryPrompt = new Label(m_recoveryCamera, Utf8Text(L"Unsaved changes from a previous session were found. F8 restores them, editing discards them."));
+        m_recoveryPrompt->setLayer(RenderLayer::Overlay);
+    }
+    layoutLatencyOverlay();
+}
+
+void Editor::rebaseJournal(const size_t& baselineTextSize) {
+    // only for a new baseline, a load or a save: everything since it collapses into the one byte range the text tracks as changed
+    const Utf8Text& text = m_label->getText();
+    const std::string& bytes = text.getBytes();
+    const size_t common = std::min(bytes.size(), baselineTextSize);
+    const size_t prefix = std::min(text.getUnchangedPrefix(), common);
+    const size_t suffix = std::min(text.getUnchangedSuffix(), common - prefix);
+    std::vector<JournalRecord> records;
+    if (prefix + suffix < bytes.size() || prefix + suffix < baselineTextSize) {
+        records.push_back(JournalRecord{ prefix, baselineTextSize - prefix - suffix, bytes.substr(prefix, bytes.size() - prefix - suffix) });
+    }
+    m_journal->reset(EditJournal::identify(m_filePath, baselineTextSize), records);
+}
+
+void Editor::restoreJournal() {
+    if (!m_recoveryOffered) {
+        return;
+    }
+    setRecoveryOffered(false);
+    JournalHeader header;
+    std::vector<JournalRecord> records;
+    if (!EditJournal::read(m_filePath, header, records)) {
+        return;
+    }
+    std::string bytes = m_label->getText().getBytes();
+    size_t prefix = bytes.size();
+    size_t suffix = bytes.size();
+    for (size_t i = 0; i < records.size(); i++) {
+        const JournalRecord& r = records[i];
+        if (r.Offset > bytes.size() || r.Erased > bytes.size() - r.Offset) {
+            PUSH_ERROR("Cannot Restore Journal");
+            records.resize(i);
+            break;
+        }
+        prefix = std::min(prefix, size_t(r.Offset));
+        suffix = std::min(suffix, size_t(bytes.size() - r.Offset - r.Erased));
+        bytes.replace(size_t(r.Offset), size_t(r.Erased), r.Inserted);
+    }
+    clearExtraCursors();
+    m_label->setText(Utf8Text::fromUtf8(std::move(bytes)));
+    // the file itself is unchanged, so a save can still copy what the journal did not touch
+    m_label->resetChangeTracking();
+    m_label->limitUnchanged(prefix, suffix);
+    // the restored records stay the journal, nothing of the text between them is written again
+    m_journal->reset(header, records);
+    m_journalEdited = false;
+    const size_t size = m_label->getText().size();
+    m_cursorPosition = std::min(size_t(m_cursorPosition), size);
+    m_cursorSelectionPosition = m_cursorPosition;
+    m_cursorSelectionEndPosition = m_cursorPosition;
+    m_state = EditorState::NeedToSaved;
+    m_stateVisual->setColor(m_needToSavedStateColor);
+    updateCursorPos();
+    updateCursorSelectionPos();
+}
+
+void Editor::pollJournal() {
+    if (m_journal == nullptr || !m_journalEdited) {
+        return;
+    }
+    m_journalEdited = false;
+    if (m_recoveryOffered) {
+        // editing instead of restoring drops the old journal, the edits queued since loading start the new one
+        setRecoveryOffered(false);
+        m_journal->start(m_journal->getHeader());
+    }
+}
+
+void Editor::pollContentHash() {
+    if (m_contentHash == nullptr || !m_contentHash->hasPendingEdits()) {
+        return;
+    }
+    // a running save decides the state when it ends, the file is about to change under the comparison
+    if (m_fileSaver != nullptr) {
+        m_contentHash->update(m_label->getText().getBytes());
+        return;
+    }
+    updateModifiedState();
+}
+
+void Editor::updateModifiedState() {
+    const ContentDigest& digest = m_contentHash->update(m_label->getText().getBytes());
+    if (!m_savedDigestKnown || m_recoveryOffered) {
+        return;
+    }
+    // typing something and deleting it again leaves nothing to save
+    if (digest == m_savedDigest) {
+        m_state = EditorState::Normal;
+        m_stateVisual->setColor(m_normalStateColor);
+    }
+    else {
+        m_state = EditorState::NeedToSaved;
+        m_stateVisual->setColor(m_needToSavedStateColor);
+    }
+}
+
+void Editor::toggleFollow() {
+    if (m_filePath == "") {
+        return;
+    }
+    m_following = !m_following;
+    if (!m_following) {
+        delete m_follower;
+        m_follower = nullptr;
+    }
+}
+
+void Editor::pollFollower() {
+    if (!m_following || m_fileLoader != nullptr) {
+        return;
+    }
+    if (m_follower == nullptr) {
+        m_follower = new FileFollower(m_filePath, m_loadedFileSize);
+        m_tailing = getRowsBelowViewport() <= 1.0f;
+    }
+    if (m_largeFile != nullptr) {
+        // the viewer only extends its line index, the window picks the new lines up when it is reloaded
+        const size_t lineCount = m_largeFile->getLineCount();
+        if (m_largeFile->isIndexed() && m_follower->hasChanged() && m_largeFile->refresh()) {
+            m_largeFileAtEnd = false;
+            if (m_largeFile->getLineCount() < lineCount) {
+                m_largeFileLoadedLines = 0;
+            }
+        }
+    }
+    else if (m_follower->hasChanged()) {
+        const double deadline = glfwGetTime() + FILE_LOADER_FRAME_BUDGET;
+        std::string appended;
+        bool truncated = false;
+        bool restarted = false;
+        size_t appendedBytes = 0;
+        m_readingFollowedFile = true;
+        while (m_follower->readAppended(appended, truncated)) {
+            if (truncated) {
+                restarted = true;
+                appendedBytes = 0;
+                m_sourceMap.clear();
+                m_savedDigest = ContentDigest{};
+                clearExtraCursors();
+                m_label->setText(Utf8Text());
+                m_cursorPosition = 0;
+                m_cursorSelectionPosition = 0;
+                m_cursorSelectionEndPosition = 0;
+                updateCursorPos(false);
+                updateCursorSelectionPos();
+            }
+            m_label->appendText(appended);
+            // what is read from the file is part of what it holds, so it never counts as a modification
+            m_savedDigest = ContentHash::concat(m_savedDigest, ContentHash::digest(appended.data(), appended.size()));
+            appendedBytes += appended.size();
+            if (glfwGetTime() >= deadline) {
+                break;
+            }
+        }
+        m_readingFollowedFile = false;
+        m_loadedFileSize = m_follower->getOffset();
+        if (m_journal != nullptr && (restarted || appendedBytes > 0)) {
+            JournalHeader header = EditJournal::identify(m_filePath, 0);
+            header.FileSize = m_loadedFileSize;
+            if (restarted) {
+                // the text was replaced by the file's new content, so there is nothing left to recover
+                setRecoveryOffered(false);
+                m_label->resetChangeTracking();
+                header.TextSize = m_label->getText().getBytes().size();
+                m_journal->reset(header, {});
+            }
+            else {
+                header.TextSize = m_journal->getHeader().TextSize + appendedBytes;
+                m_journal->updateHeader(header);
+            }
+        }
+    }
+    // keep the last line in view while the user stays at the bottom, scrolling up stops it
+    if (m_tailing) {
+        const float below = getRowsBelowViewport();
+        if (below > 0.5f) {
+            scrollCamera(vec2(0.0f, below * FONT_SIZE));
+        }
+    }
+    m_tailing = getRowsBelowViewport() <= 1.0f;
+}
+
+float Editor::getRowsBelowViewport() {
+    const float rowCount = (m_largeFile != nullptr ? float(m_largeFile->getLineCount()) : float(m_label->getRowCount()));
+    float bottom = float(m_label->getFirstVisibleRow()) + float(windowSize.y) / camera->getZoom().y / FONT_SIZE - 1.0f;
+    if (m_largeFile != nullptr) {
+        bottom += float(m_largeFileFirstLine);
+    }
+    // measured from where a running scroll is heading, so a flick to the end already counts as being there
+    if (!m_scrollTween->getIsEmpty()) {
+        bottom += (m_scrollTarget.y - camera->getPosition().y) / FONT_SIZE;
+    }
+    return rowCount - 1.0f - bottom;
+}
+
+unsigned long long Editor::getVerticalTarget(const unsigned long long& position, const int& direction) {
+    const int belongBlockIndex = std::max(m_label->getBelongBlock(int(position)), 0);
+    const int targetBlockIndex = belongBlockIndex + direction;
+    if (targetBlockIndex < 0 || targetBlockIndex >= int(m_label->getBlockCount())) {
+        return position;
+    }
+    const int currentLength = int(position) - m_label->getBlock(belongBlockIndex).first;
+    const std::pair<int, int> targetBlock = m_label->getBlock(targetBlockIndex);
+    return clamp(targetBlock.first + currentLength, targetBlock.first, targetBlock.second);
+}
+
+void Editor::addCursorVertical(const int& direction) {
+    unsigned long long edge = m_cursorPosition;
+    for (const EditorCursor& c : m_extraCursors) {
+        edge = (direction < 0 ? std::min(edge, c.Position) : std::max(edge, c.Position));
+    }
+    const unsigned long long target = getVerticalTarget(edge, direction);
+    if (target == edge) {
+        return;
+    }
+    m_extraCursors.push_back(EditorCursor{ target, target });
+    normalizeExtraCursors();
+}
+
+void Editor::addNextOccurrence() {
+    const Utf8Text& text = m_label->getText();
+    if (m_cursorPosition == m_cursorSelectionPosition) {
+        size_t start = 0;
+        size_t end = 0;
+        m_label->getWordAt(m_cursorPosition, start, end);
+        if (start == end) {
+            return;
+        }
+        m_cursorPosition = start;
+        m_cursorSelectionPosition = end;
+        updateCursorPos(false);
+        updateCursorSelectionPos();
+        return;
+    }
+    const size_t needleStart = std::min(m_cursorPosition, m_cursorSelectionPosition);
+    const std::wstring needle = text.substr(needleStart, std::max(m_cursorPosition, m_cursorSelectionPosition) - needleStart);
+    auto hasCursorAt = [&](const size_t& at) {
+        if (needleStart == at) {
+            return true;
+        }
+        for (const EditorCursor& c : m_extraCursors) {
+            if (std::min(c.Position, c.SelectionPosition) == at) {
+                return true;
+            }
+        }
+        return false;
+    };
+    // search after the furthest selection and wrap around once
+    size_t from = std::max(m_cursorPosition, m_cursorSelectionPosition);
+    for (const EditorCursor& c : m_extraCursors) {
+        from = std::max(from, size_t(std::max(c.Position, c.SelectionPosition)));
+    }
+    size_t at = from;
+    bool wrapped = false;
+    while (true) {
+        const size_t found = text.find(needle, at);
+        if (found == Utf8Text::npos || (wrapped && found >= from)) {
+            if (wrapped) {
+                return;
+            }
+            wrapped = true;
+            at = 0;
+            continue;
+        }
+        if (!hasCursorAt(found)) {
+            m_extraCursors.push_back(EditorCursor{ found, found + needle.size() });
+            normalizeExtraCursors();
+            return;
+        }
+        at = found + 1;
+    }
+}
+
+void Editor::clearExtraCursors() {
+    if (m_extraCursors.empty()) {
+        return;
+    }
+    m_extraCursors.clear();
+    m_label->setExtraSelections({});
+}
+
+void Editor::normalizeExtraCursors() {
+    std::sort(m_extraCursors.begin(), m_extraCursors.end(), [](const EditorCursor& a, const EditorCursor& b) {
+        return a.Position < b.Position;
+    });
+    m_extraCursors.erase(std::unique(m_extraCursors.begin(), m_extraCursors.end(), [](const EditorCursor& a, const EditorCursor& b) {
+        return a.Position == b.Position;
+    }), m_extraCursors.end());
+    m_extraCursors.erase(std::remove_if(m_extraCursors.begin(), m_extraCursors.end(), [this](const EditorCursor& c) {
+        return c.Position == m_cursorPosition;
+    }), m_extraCursors.end());
+    std::vector<std::pair<size_t, size_t>> ranges;
+    for (const EditorCursor& c : m_extraCursors) {
+        if (c.Position != c.SelectionPosition) {
+            ranges.push_back({ std::min(c.Position, c.SelectionPosition), std::max(c.Position, c.SelectionPosition) });
+        }
+    }
+    std::sort(ranges.begin(), ranges.end());
+    m_label->setExtraSelections(ranges);
+}
+
+void Editor::moveExtraCursors(const int& key, const bool& select) {
+    if (m_extraCursors.empty()) {
+        return;
+    }
+    const unsigned long long textSize = m_label->getText().size();
+    for (EditorCursor& c : m_extraCursors) {
+        unsigned long long& target = (select ? c.SelectionPosition : c.Position);
+        switch (key) {
+        case GLFW_KEY_RIGHT:
+            target = std::min(target + 1, textSize);
+            break;
+        case GLFW_KEY_LEFT:
+            if (target != 0) {
+                target--;
+            }
+            break;
+        case GLFW_KEY_UP:
+            target = getVerticalTarget(target, -1);
+            break;
+        case GLFW_KEY_DOWN:
+            target = getVerticalTarget(target, 1);
+            break;
+        }
+        if (!select) {
+            c.SelectionPosition = c.Position;
+        }
+    }
+    normalizeExtraCursors();
+}
+
+void Editor::replaceAtCursors(const std::wstring& text, const bool& eraseBefore) {
+    std::vector<EditorCursor> cursors = m_extraCursors;
+    cursors.push_back(EditorCursor{ m_cursorPosition, m_cursorSelectionPosition });
+    const size_t primary = cursors.size() - 1;
+    std::vector<size_t> order(cursors.size());
+    for (size_t i = 0; i < order.size(); i++) {
+        order[i] = i;
+    }
+    std::sort(order.begin(), order.end(), [&cursors](const size_t& a, const size_t& b) {
+        return std::min(cursors[a].Position, cursors[a].SelectionPosition) < std::min(cursors[b].Position, cursors[b].SelectionPosition);
+    });
+    // every cursor becomes one edit of a single batch, positions are shifted by what the earlier edits added or removed
+    std::vector<TextEdit> edits;
+    edits.reserve(cursors.size());
+    std::vector<unsigned long long> results(cursors.size());
+    long long delta = 0;
+    size_t lastEnd = 0;
+    for (const size_t& i : order) {
+        size_t start = std::min(cursors[i].Position, cursors[i].SelectionPosition);
+        size_t end = std::max(cursors[i].Position, cursors[i].SelectionPosition);
+        if (start == end && eraseBefore && start > 0) {
+            start--;
+        }
+        start = std::max(start, lastEnd);
+        end = std::max(end, start);
+        if (end > start || !text.empty()) {
+            edits.push_back(TextEdit{ start, end - start, text });
+        }
+        results[i] = (unsigned long long)((long long)start + delta) + text.size();
+        delta += (long long)text.size() - (long long)(end - start);
+        lastEnd = end;
+    }
+    if (edits.empty()) {
+        return;
+    }
+    if (m_filePath != "") {
+        m_state = EditorState::NeedToSaved;
+        m_stateVisual->setColor(m_needToSavedStateColor);
+    }
+    m_label->applyEdits(edits);
+    m_extraCursors.clear();
+    for (size_t i = 0; i < results.size(); i++) {
+        if (i != primary) {
+            m_extraCursors.push_back(EditorCursor{ results[i], results[i] });
+        }
+    }
+    m_cursorPosition = results[primary];
+    m_cursorSelectionPosition = m_cursorPosition;
+    m_cursorSelectionEndPosition = m_cursorSelectionPosition;
+    updateCursorPos();
+    updateCursorSelectionPos();
+    normalizeExtraCursors();
+}
+
+void Editor::drawExtraCursors(const bool& visible) {
+    if (m_extraCursors.empty()) {
+        return;
+    }
+    size_t firstLine = 0;
+    size_t lastLine = 0;
+    m_label->getVisibleLineRange(firstLine, lastLine);
+    const unsigned long long visibleFrom = m_label->getBlock(firstLine).first;
+    const unsigned long long visibleTo = m_label->getBlock(lastLine).second;
+    auto it = std::partition_point(m_extraCursors.begin(), m_extraCursors.end(), [&visibleFrom](const EditorCursor& c) {
+        return c.Position < visibleFrom;
+    });
+    size_t used = 0;
+    for (; it != m_extraCursors.end() && it->Position <= visibleTo; it++) {
+        if (used >= m_extraCursorRects.size()) {
+            ColorRect* rect = new ColorRect(camera);
+            rect->setSize(vec2i(2, FONT_SIZE));
+            rect->setLayer(RenderLayer::Cursor);
+            m_extraCursorRects.push_back(rect);
+        }
+        ColorRect* rect = m_extraCursorRects[used++];
+        const TextLayoutPosition layout = m_label->getLayoutPosition(it->Position);
+        rect->setPosition(vec2(layout.X, 10 + FONT_SIZE * float(layout.Row)));
+        rect->setColor(m_label->getTheme().Cursor);
+        rect->setVisible(visible);
+        rect->draw();
+    }
+}
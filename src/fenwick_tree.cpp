@@ -0,0 +1,55 @@
+#include "fenwick_tree.h"
+
+void FenwickTree::build(const std::vector<int>& _values) {
+	m_size = _values.size();
+	m_nodes.assign(m_size + 1, 0);
+	for (size_t i = 1; i <= m_size; i++) {
+		m_nodes[i] += _values[i - 1];
+		size_t parent = i + (i & (~i + 1));
+		if (parent <= m_size) {
+			m_nodes[parent] += m_nodes[i];
+		}
+	}
+}
+
+void FenwickTree::add(const size_t& _index, const long long& _delta) {
+	for (size_t i = _index + 1; i <= m_size; i += (i & (~i + 1))) {
+		m_nodes[i] += _delta;
+	}
+}
+
+long long FenwickTree::prefixSum(const size_t& _count) const {
+	long long result = 0;
+	for (size_t i = (_count < m_size ? _count : m_size); i > 0; i -= (i & (~i + 1))) {
+		result += m_nodes[i];
+	}
+	return result;
+}
+
+long long FenwickTree::total() const {
+	return prefixSum(m_size);
+}
+
+// index of the element whose range [prefixSum(i), prefixSum(i + 1)) holds _value, clamped to the last element
+size_t FenwickTree::findByPrefix(const long long& _value) const {
+	if (m_size == 0) {
+		return 0;
+	}
+	size_t step = 1;
+	while (step * 2 <= m_size) {
+		step *= 2;
+	}
+	size_t position = 0;
+	long long remaining = _value;
+	for (; step > 0; step >>= 1) {
+		if (position + step <= m_size && m_nodes[position + step] <= remaining) {
+			position += step;
+			remaining -= m_nodes[position];
+		}
+	}
+	return position < m_size ? position : m_size - 1;
+}
+
+const size_t& FenwickTree::size() const {
+	return m_size;
+}
@@ -0,0 +1,72 @@
+#include "file_follower.h"
+#include "text_codec.h"
+
+#include <algorithm>
+
+#define FILE_FOLLOWER_MAX_READ (1 << 20)
+
+FileFollower::FileFollower(const std::string& _path, const size_t& _offset) : m_watcher(_path), m_offset(_offset) {
+	m_stream.open(_path, std::ios::binary);
+}
+
+const bool& FileFollower::isOpen() const {
+	return m_watcher.isOpen();
+}
+
+bool FileFollower::hasChanged() {
+	const bool changed = m_watcher.consumeChange() || m_pending;
+	m_pending = false;
+	return changed;
+}
+
+bool FileFollower::readAppended(std::string& _utf8, bool& _truncated) {
+	// every return leaves _utf8 holding this read's text only, a truncation alone reads nothing
+	_utf8.clear();
+	_truncated = false;
+	if (!m_stream.is_open()) {
+		return false;
+	}
+	m_stream.clear();
+	m_stream.seekg(0, std::ios::end);
+	const std::streamoff end = m_stream.tellg();
+	if (end < 0) {
+		return false;
+	}
+	const size_t size = size_t(end);
+	if (size < m_offset) {
+		// truncated or replaced, follow the new content from its start
+		m_offset = 0;
+		_truncated = true;
+	}
+	const size_t available = std::min(size - m_offset, size_t(FILE_FOLLOWER_MAX_READ));
+	if (available == 0) {
+		return _truncated;
+	}
+	m_buffer.resize(available);
+	m_stream.seekg(std::streamoff(m_offset));
+	m_stream.read(&m_buffer[0], std::streamsize(available));
+	const size_t read = size_t(m_stream.gcount());
+	size_t cut = read;
+	while (cut > 0 && m_buffer[cut - 1] != '\n') {
+		cut--;
+	}
+	if (cut == 0) {
+		if (read < FILE_FOLLOWER_MAX_READ) {
+			return _truncated;
+		}
+		// one very long line, cut before a lead byte and never between '\r' and '\n'
+		cut = read;
+		while (cut > 1 && ((static_cast<unsigned char>(m_buffer[cut]) & 0xC0) == 0x80 || m_buffer[cut - 1] == '\r')) {
+			cut--;
+		}
+	}
+	// a full read may have left more behind, come back next frame without waiting for another write
+	m_pending = (read == FILE_FOLLOWER_MAX_READ);
+	normalizeUtf8(reinterpret_cast<const unsigned char*>(m_buffer.data()), cut, _utf8, m_offset == 0);
+	m_offset += cut;
+	return true;
+}
+
+const size_t& FileFollower::getOffset() const {
+	return m_offset;
+}
@@ -0,0 +1,122 @@
+#include "file_loader.h"
+#include "platform.h"
+
+#include <algorithm>
+
+#define FILE_LOADER_FIRST_CHUNK_SIZE (64 << 10)
+#define FILE_LOADER_CHUNK_SIZE (1 << 20)
+
+FileLoader::FileLoader(const std::string& _path) {
+	m_thread = std::thread(&FileLoader::work, this, _path);
+}
+
+FileLoader::~FileLoader() {
+	m_cancelled = true;
+	if (m_thread.joinable()) {
+		m_thread.join();
+	}
+}
+
+void FileLoader::work(const std::string& _path) {
+	MappedFile file(_path);
+	if (!file.isOpen() || file.getSize() == 0) {
+		m_finished = true;
+		return;
+	}
+	const unsigned char* data = file.getData();
+	const size_t size = file.getSize();
+	m_totalBytes = size;
+	bool endingKnown = false;
+	size_t start = 0;
+	size_t textOffset = 0;
+	std::vector<SourceSpan> spans;
+	std::vector<size_t> newlines;
+	std::vector<bool> valid;
+	while (start < size && !m_cancelled) {
+		size_t end = std::min(size, start + (start == 0 ? FILE_LOADER_FIRST_CHUNK_SIZE : FILE_LOADER_CHUNK_SIZE));
+		if (end < size) {
+			size_t cut = end;
+			while (cut > start && data[cut - 1] != '\n') {
+				cut--;
+			}
+			if (cut > start) {
+				end = cut;
+			}
+			else {
+				// one very long line, cut before a lead byte and never between '\r' and '\n'
+				while (end > start + 1 && ((data[end] & 0xC0) == 0x80 || data[end - 1] == '\r')) {
+					end--;
+				}
+			}
+		}
+		std::string chunk;
+		const TextFormat format = normalizeUtf8(data + start, end - start, chunk, start == 0);
+		const size_t bom = (format.HasBom ? 3 : 0);
+		spans.push_back(SourceSpan{ textOffset, chunk.size(), start + bom, end - start - bom, false });
+		newlines.push_back(size_t(std::count(chunk.begin(), chunk.end(), '\n')));
+		valid.push_back(format.Valid);
+		textOffset += chunk.size();
+		{
+			std::lock_guard<std::mutex> lock(m_mutex);
+			if (start == 0) {
+				m_format.HasBom = format.HasBom;
+			}
+			// the first piece with a line break decides the line ending of the whole file
+			if (!endingKnown && chunk.find('\n') != std::string::npos) {
+				m_format.Ending = format.Ending;
+				endingKnown = true;
+			}
+			m_format.Valid = m_format.Valid && format.Valid;
+			m_chunks.push_back(std::move(chunk));
+		}
+		start = end;
+		m_loadedBytes = start;
+	}
+	{
+		// only now is the line ending of the whole file known, a piece is verbatim if it has no other line ending and no malformed bytes
+		std::lock_guard<std::mutex> lock(m_mutex);
+		for (size_t i = 0; i < spans.size(); i++) {
+			const size_t breaks = (m_format.Ending == LineEnding::CRLF ? newlines[i] : 0);
+			spans[i].Verbatim = valid[i] && spans[i].FileLength == spans[i].TextLength + breaks;
+		}
+		m_sourceMap = std::move(spans);
+	}
+	m_finished = true;
+}
+
+bool FileLoader::takeChunk(std::string& _out) {
+	std::lock_guard<std::mutex> lock(m_mutex);
+	if (m_chunks.empty()) {
+		return false;
+	}
+	_out = std::move(m_chunks.front());
+	m_chunks.pop_front();
+	return true;
+}
+
+bool FileLoader::isFinished() const {
+	std::lock_guard<std::mutex> lock(m_mutex);
+	return m_finished && m_chunks.empty();
+}
+
+float FileLoader::getProgress() const {
+	const size_t total = m_totalBytes;
+	if (total == 0) {
+		return m_finished ? 1.0f : 0.0f;
+	}
+	return float(double(m_loadedBytes) / double(total));
+}
+
+TextFormat FileLoader::getFormat() const {
+	std::lock_guard<std::mutex> lock(m_mutex);
+	return m_format;
+}
+
+size_t FileLoader::getFileSize() const {
+	return m_totalBytes;
+}
+
+std::vector<SourceSpan> FileLoader::takeSourceMap() {
+	std::lock_guard<std::mutex> lock(m_mutex);
+	return std::move(m_sourceMap);
+}
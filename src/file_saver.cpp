@@ -0,0 +1,119 @@
+#include "file_saver.h"
+#include "platform.h"
+
+#include <deque>
+#include <filesystem>
+
+#define FILE_SAVER_PIECE_SIZE (1 << 20)
+
+FileSaver::FileSaver(const std::string& _path, std::shared_ptr<const std::string> _snapshot, const size_t& _unchangedPrefix, const size_t& _unchangedSuffix,
+	const TextFormat& _format, std::vector<SourceSpan> _sourceMap, const size_t& _sourceSize) {
+	m_thread = std::thread(&FileSaver::work, this, _path, std::move(_snapshot), _unchangedPrefix, _unchangedSuffix, _format, std::move(_sourceMap), _sourceSize);
+}
+
+FileSaver::~FileSaver() {
+	// never cancelled, closing the editor in the middle of a save still finishes it
+	if (m_thread.joinable()) {
+		m_thread.join();
+	}
+}
+
+void FileSaver::work(const std::string& _path, std::shared_ptr<const std::string> _snapshot, const size_t& _unchangedPrefix, const size_t& _unchangedSuffix,
+	const TextFormat& _format, std::vector<SourceSpan> _sourceMap, const size_t& _sourceSize) {
+	const std::string& bytes = *_snapshot;
+	// the map describes the file as it was loaded or last saved, anyone else writing to it since makes it useless
+	std::error_code error;
+	const unsigned long long fileSize = std::filesystem::file_size(_path, error);
+	if (error || fileSize != _sourceSize) {
+		_sourceMap.clear();
+	}
+	const size_t textEnd = (_sourceMap.empty() ? 0 : _sourceMap.back().Text + _sourceMap.back().TextLength);
+	const size_t suffixStart = textEnd - std::min(textEnd, _unchangedSuffix);
+	size_t first = 0;
+	while (first < _sourceMap.size() && _sourceMap[first].Verbatim && _sourceMap[first].Text + _sourceMap[first].TextLength <= _unchangedPrefix) {
+		first++;
+	}
+	size_t last = _sourceMap.size();
+	while (last > first && _sourceMap[last - 1].Verbatim && _sourceMap[last - 1].Text >= suffixStart) {
+		last--;
+	}
+	// the unchanged suffix sits at the end of the snapshot, so its spans move by however much the text grew or shrank
+	const long long shift = (long long)bytes.size() - (long long)textEnd;
+	std::vector<FilePiece> pieces;
+	std::deque<std::string> encoded;
+	std::vector<SourceSpan> written;
+	size_t filePos = 0;
+	size_t copied = 0;
+	if (_format.HasBom) {
+		pieces.push_back(FilePiece{ "\xEF\xBB\xBF", 3, 0 });
+		filePos = 3;
+	}
+	if (first > 0) {
+		const size_t from = _sourceMap.front().File;
+		const size_t size = _sourceMap[first - 1].File + _sourceMap[first - 1].FileLength - from;
+		pieces.push_back(FilePiece{ nullptr, size, from });
+		for (size_t i = 0; i < first; i++) {
+			SourceSpan span = _sourceMap[i];
+			span.File = span.File - from + filePos;
+			written.push_back(span);
+		}
+		filePos += size;
+		copied += size;
+	}
+	const size_t middleFrom = (first > 0 ? _sourceMap[first - 1].Text + _sourceMap[first - 1].TextLength : 0);
+	const size_t middleTo = (last < _sourceMap.size() ? size_t((long long)_sourceMap[last].Text + shift) : bytes.size());
+	size_t pos = middleFrom;
+	while (pos < middleTo) {
+		size_t cut = std::min(middleTo, pos + FILE_SAVER_PIECE_SIZE);
+		while (cut < middleTo && cut > pos + 1 && (static_cast<unsigned char>(bytes[cut]) & 0xC0) == 0x80) {
+			cut--;
+		}
+		std::string& piece = encoded.emplace_back();
+		appendWithLineEnding(bytes.data() + pos, cut - pos, _format.Ending, piece);
+		pieces.push_back(FilePiece{ piece.data(), piece.size(), 0 });
+		written.push_back(SourceSpan{ pos, cut - pos, filePos, piece.size(), true });
+		filePos += piece.size();
+		pos = cut;
+	}
+	if (last < _sourceMap.size()) {
+		const size_t from = _sourceMap[last].File;
+		const size_t size = _sourceMap.back().File + _sourceMap.back().FileLength - from;
+		pieces.push_back(FilePiece{ nullptr, size, from });
+		for (size_t i = last; i < _sourceMap.size(); i++) {
+			SourceSpan span = _sourceMap[i];
+			span.Text = size_t((long long)span.Text + shift);
+			span.File = span.File - from + filePos;
+			written.push_back(span);
+		}
+		filePos += size;
+		copied += size;
+	}
+	m_succeeded = writeFileAtomically(_path, pieces, copied > 0 ? _path : std::string());
+	if (m_succeeded) {
+		m_sourceMap = std::move(written);
+	}
+	m_writtenBytes = filePos;
+	m_copiedBytes = copied;
+	m_finished = true;
+}
+
+bool FileSaver::isFinished() const {
+	return m_finished;
+}
+
+bool FileSaver::hasSucceeded() const {
+	return m_succeeded;
+}
+
+size_t FileSaver::getWrittenBytes() const {
+	return m_writtenBytes;
+}
+
+size_t FileSaver::getCopiedBytes() const {
+	return m_copiedBytes;
+}
+
+// only valid once isFinished() returned true
+std::vector<SourceSpan> FileSaver::takeSourceMap() {
+	return std::move(m_sourceMap);
+}
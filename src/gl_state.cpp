@@ -0,0 +1,171 @@
+#include "gl_state.h"
+
+void GLStateCache::countIssued() {
+	m_stats.issued++;
+	m_frameStats.issued++;
+}
+
+void GLStateCache::countSkipped() {
+	m_stats.skipped++;
+	m_frameStats.skipped++;
+}
+
+void GLStateCache::useProgram(unsigned int _program) {
+	if (m_program == _program) {
+		countSkipped();
+		return;
+	}
+	glUseProgram(_program);
+	m_program = _program;
+	countIssued();
+}
+
+void GLStateCache::bindVertexArray(unsigned int _vertexArray) {
+	if (m_vertexArray == _vertexArray) {
+		countSkipped();
+		return;
+	}
+	glBindVertexArray(_vertexArray);
+	m_vertexArray = _vertexArray;
+	countIssued();
+}
+
+void GLStateCache::bindArrayBuffer(unsigned int _buffer) {
+	if (m_arrayBuffer == _buffer) {
+		countSkipped();
+		return;
+	}
+	glBindBuffer(GL_ARRAY_BUFFER, _buffer);
+	m_arrayBuffer = _buffer;
+	countIssued();
+}
+
+void GLStateCache::activeTexture(unsigned int _unit) {
+	if (m_activeTextureUnit == _unit) {
+		countSkipped();
+		return;
+	}
+	glActiveTexture(GL_TEXTURE0 + _unit);
+	m_activeTextureUnit = _unit;
+	countIssued();
+}
+
+void GLStateCache::bindTexture(unsigned int _unit, unsigned int _texture) {
+	if (_unit >= GL_STATE_TEXTURE_UNITS) {
+		activeTexture(_unit);
+		glBindTexture(GL_TEXTURE_2D, _texture);
+		countIssued();
+		return;
+	}
+	if (m_boundTextures[_unit] == _texture) {
+		countSkipped();
+		return;
+	}
+	activeTexture(_unit);
+	glBindTexture(GL_TEXTURE_2D, _texture);
+	m_boundTextures[_unit] = _texture;
+	countIssued();
+}
+
+void GLStateCache::setBlend(bool _enabled, GLenum _src, GLenum _dst) {
+	if (m_blendEnabled != int(_enabled)) {
+		if (_enabled) glEnable(GL_BLEND);
+		else glDisable(GL_BLEND);
+		m_blendEnabled = int(_enabled);
+		countIssued();
+	}
+	else {
+		countSkipped();
+	}
+	if (!_enabled) {
+		return;
+	}
+	if (m_blendSrc != _src || m_blendDst != _dst) {
+		glBlendFunc(_src, _dst);
+		m_blendSrc = _src;
+		m_blendDst = _dst;
+		countIssued();
+	}
+	else {
+		countSkipped();
+	}
+}
+
+void GLStateCache::setDepthTest(bool _enabled) {
+	if (m_depthTestEnabled == int(_enabled)) {
+		countSkipped();
+		return;
+	}
+	if (_enabled) glEnable(GL_DEPTH_TEST);
+	else glDisable(GL_DEPTH_TEST);
+	m_depthTestEnabled = int(_enabled);
+	countIssued();
+}
+
+void GLStateCache::setMultisample(bool _enabled) {
+	if (m_multisampleEnabled == int(_enabled)) {
+		countSkipped();
+		return;
+	}
+	if (_enabled) glEnable(GL_MULTISAMPLE);
+	else glDisable(GL_MULTISAMPLE);
+	m_multisampleEnabled = int(_enabled);
+	countIssued();
+}
+
+void GLStateCache::forgetProgram(unsigned int _program) {
+	if (m_program == _program) {
+		m_program = 0;
+	}
+}
+
+void GLStateCache::forgetVertexArray(unsigned int _vertexArray) {
+	if (m_vertexArray == _vertexArray) {
+		m_vertexArray = 0;
+	}
+}
+
+void GLStateCache::forgetBuffer(unsigned int _buffer) {
+	if (m_arrayBuffer == _buffer) {
+		m_arrayBuffer = 0;
+	}
+}
+
+void GLStateCache::forgetTexture(unsigned int _texture) {
+	for (unsigned int i = 0; i < GL_STATE_TEXTURE_UNITS; i++) {
+		if (m_boundTextures[i] == _texture) {
+			m_boundTextures[i] = 0;
+		}
+	}
+}
+
+void GLStateCache::invalidate() {
+	m_program = 0;
+	m_vertexArray = 0;
+	m_arrayBuffer = 0;
+	m_activeTextureUnit = 0;
+	for (unsigned int i = 0; i < GL_STATE_TEXTURE_UNITS; i++) {
+		m_boundTextures[i] = 0;
+	}
+	m_blendEnabled = -1;
+	m_depthTestEnabled = -1;
+	m_multisampleEnabled = -1;
+	m_blendSrc = GL_NONE;
+	m_blendDst = GL_NONE;
+	glUseProgram(0);
+	glBindVertexArray(0);
+	glBindBuffer(GL_ARRAY_BUFFER, 0);
+	glActiveTexture(GL_TEXTURE0);
+}
+
+const GLStateStats& GLStateCache::getStats() const {
+	return m_stats;
+}
+
+const GLStateStats& GLStateCache::getFrameStats() const {
+	return m_frameStats;
+}
+
+void GLStateCache::beginFrame() {
+	m_frameStats = {};
+}
\ No newline at end of file
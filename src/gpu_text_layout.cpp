@@ -0,0 +1,231 @@
+#include "gpu_text_layout.h"
+#include "texture.h"
+#include "shader.h"
+#include "gl_state.h"
+#include "render_queue.h"
+#include "utils.h"
+#include "macros.h"
+#include "theme.h"
+
+#include <algorithm>
+#include <cstring>
+
+#define GPU_TEXT_LAYOUT_GLYPH_COUNT 128
+#define GPU_TEXT_LAYOUT_ATLAS_COLUMNS 16
+
+GpuTextLayout::GpuTextLayout() {
+	m_shader = new Shader(readFile(GLYPH_GPU_VERTEX_SHADER_PATH).c_str(), readFile(GLYPH_GPU_FRAGMENT_SHADER_PATH).c_str());
+	m_shader->use();
+	m_shader->setInt("text", 0);
+	m_shader->setInt("Metrics", 1);
+	m_shader->setInt("Codepoints", 2);
+	m_shader->setInt("Advances", 3);
+	m_shader->setInt("Lines", 4);
+	glGenVertexArrays(1, &m_VAO);
+	createTextureBuffer(m_metrics, GL_RGBA32F);
+	createTextureBuffer(m_codepoints, GL_R32UI);
+	createTextureBuffer(m_advances, GL_R32I);
+	createTextureBuffer(m_lines, GL_RG32I);
+}
+
+GpuTextLayout::~GpuTextLayout() {
+	deleteTextureBuffer(m_metrics);
+	deleteTextureBuffer(m_codepoints);
+	deleteTextureBuffer(m_advances);
+	deleteTextureBuffer(m_lines);
+	GLStateCache::get().forgetVertexArray(m_VAO);
+	glDeleteVertexArrays(1, &m_VAO);
+	delete m_atlas;
+	delete m_shader;
+}
+
+void GpuTextLayout::createTextureBuffer(TextureBuffer& _tb, unsigned int _format) {
+	glGenBuffers(1, &_tb.Buffer);
+	glBindBuffer(GL_TEXTURE_BUFFER, _tb.Buffer);
+	glBufferData(GL_TEXTURE_BUFFER, 16, NULL, GL_DYNAMIC_DRAW);
+	_tb.Capacity = 16;
+	glGenTextures(1, &_tb.Texture);
+	glBindTexture(GL_TEXTURE_BUFFER, _tb.Texture);
+	glTexBuffer(GL_TEXTURE_BUFFER, _format, _tb.Buffer);
+	glBindTexture(GL_TEXTURE_BUFFER, 0);
+	glBindBuffer(GL_TEXTURE_BUFFER, 0);
+}
+
+void GpuTextLayout::deleteTextureBuffer(TextureBuffer& _tb) {
+	glDeleteTextures(1, &_tb.Texture);
+	glDeleteBuffers(1, &_tb.Buffer);
+	_tb = {};
+}
+
+template<typename T>
+void GpuTextLayout::uploadChanged(TextureBuffer& _tb, std::vector<T>& _mirror, const std::vector<T>& _data) {
+	const size_t bytes = _data.size() * sizeof(T);
+	if (bytes == 0) {
+		_mirror.clear();
+		return;
+	}
+	glBindBuffer(GL_TEXTURE_BUFFER, _tb.Buffer);
+	if (bytes > _tb.Capacity) {
+		_tb.Capacity = std::max(bytes * 2, _tb.Capacity);
+		glBufferData(GL_TEXTURE_BUFFER, _tb.Capacity, NULL, GL_DYNAMIC_DRAW);
+		glBufferSubData(GL_TEXTURE_BUFFER, 0, bytes, _data.data());
+		m_uploadedBytes += bytes;
+		_mirror = _data;
+		glBindBuffer(GL_TEXTURE_BUFFER, 0);
+		return;
+	}
+	const size_t common = std::min(_mirror.size(), _data.size());
+	size_t first = 0;
+	while (first < common && _mirror[first] == _data[first]) {
+		first++;
+	}
+	size_t last = _data.size();
+	if (_mirror.size() == _data.size()) {
+		while (last > first && _mirror[last - 1] == _data[last - 1]) {
+			last--;
+		}
+	}
+	if (first < last) {
+		glBufferSubData(GL_TEXTURE_BUFFER, first * sizeof(T), (last - first) * sizeof(T), _data.data() + first);
+		m_uploadedBytes += (last - first) * sizeof(T);
+	}
+	_mirror = _data;
+	glBindBuffer(GL_TEXTURE_BUFFER, 0);
+}
+
+template<typename T>
+void GpuTextLayout::appendToPool(TextureBuffer& _tb, std::vector<T>& _pool, const std::vector<T>& _data) {
+	const size_t offset = _pool.size();
+	_pool.insert(_pool.end(), _data.begin(), _data.end());
+	const size_t bytes = _pool.size() * sizeof(T);
+	glBindBuffer(GL_TEXTURE_BUFFER, _tb.Buffer);
+	if (bytes > _tb.Capacity) {
+		// growing drops the buffer's contents, so the whole pool goes up again
+		_tb.Capacity = std::max(bytes * 2, _tb.Capacity);
+		glBufferData(GL_TEXTURE_BUFFER, _tb.Capacity, NULL, GL_DYNAMIC_DRAW);
+		glBufferSubData(GL_TEXTURE_BUFFER, 0, bytes, _pool.data());
+		m_uploadedBytes += bytes;
+	}
+	else if (!_data.empty()) {
+		glBufferSubData(GL_TEXTURE_BUFFER, offset * sizeof(T), _data.size() * sizeof(T), _data.data());
+		m_uploadedBytes += _data.size() * sizeof(T);
+	}
+	glBindBuffer(GL_TEXTURE_BUFFER, 0);
+}
+
+void GpuTextLayout::addGlyph(unsigned int _codepoint, const unsigned char* _bitmap, int _width, int _height, const vec2& _bearing, unsigned int _advanceX) {
+	if (_codepoint >= GPU_TEXT_LAYOUT_GLYPH_COUNT) {
+		return;
+	}
+	PendingGlyph g;
+	g.Codepoint = _codepoint;
+	g.Width = _width;
+	g.Height = _height;
+	g.Bearing = _bearing;
+	g.AdvanceX = _advanceX;
+	if (_bitmap != nullptr && _width > 0 && _height > 0) {
+		g.Bitmap.assign(_bitmap, _bitmap + size_t(_width) * size_t(_height));
+	}
+	m_pendingGlyphs.push_back(std::move(g));
+}
+
+void GpuTextLayout::buildAtlas() {
+	int cellWidth = 1;
+	int cellHeight = 1;
+	for (const auto& g : m_pendingGlyphs) {
+		cellWidth = std::max(cellWidth, g.Width + 2);
+		cellHeight = std::max(cellHeight, g.Height + 2);
+	}
+	const int columns = GPU_TEXT_LAYOUT_ATLAS_COLUMNS;
+	const int rows = (GPU_TEXT_LAYOUT_GLYPH_COUNT + columns - 1) / columns;
+	const int atlasWidth = cellWidth * columns;
+	const int atlasHeight = cellHeight * rows;
+	std::vector<unsigned char> pixels(size_t(atlasWidth) * size_t(atlasHeight), 0);
+	std::vector<float> metrics(GPU_TEXT_LAYOUT_GLYPH_COUNT * 3 * 4, 0.0f);
+	for (const auto& g : m_pendingGlyphs) {
+		const int x0 = int(g.Codepoint % columns) * cellWidth + 1;
+		const int y0 = int(g.Codepoint / columns) * cellHeight + 1;
+		if (!g.Bitmap.empty()) {
+			for (int row = 0; row < g.Height; row++) {
+				memcpy(&pixels[size_t(y0 + row) * atlasWidth + x0], &g.Bitmap[size_t(row) * g.Width], g.Width);
+			}
+		}
+		float* m = &metrics[g.Codepoint * 3 * 4];
+		m[0] = g.Bearing.x;
+		m[1] = g.Bearing.y;
+		m[2] = float(g.Width);
+		m[3] = float(g.Height);
+		m[4] = float(x0) / atlasWidth;
+		m[5] = float(y0) / atlasHeight;
+		m[6] = float(x0 + g.Width) / atlasWidth;
+		m[7] = float(y0 + g.Height) / atlasHeight;
+		m[8] = float(g.AdvanceX >> 6);
+	}
+	m_pendingGlyphs.clear();
+	delete m_atlas;
+	glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+	m_atlas = new Texture(pixels.data(), atlasWidth, atlasHeight, 1, true, false);
+	glBindBuffer(GL_TEXTURE_BUFFER, m_metrics.Buffer);
+	glBufferData(GL_TEXTURE_BUFFER, metrics.size() * sizeof(float), metrics.data(), GL_STATIC_DRAW);
+	m_metrics.Capacity = metrics.size() * sizeof(float);
+	glBindBuffer(GL_TEXTURE_BUFFER, 0);
+}
+
+// returns _offset when the pool already holds these glyphs there, otherwise appends them and returns where they went
+size_t GpuTextLayout::placeGlyphs(const size_t& _offset, const std::vector<unsigned int>& _codepoints, const std::vector<int>& _advances) {
+	const size_t count = _codepoints.size();
+	if (_offset <= m_codepointPool.size() && count <= m_codepointPool.size() - _offset &&
+		std::equal(_codepoints.begin(), _codepoints.end(), m_codepointPool.begin() + _offset) &&
+		std::equal(_advances.begin(), _advances.end(), m_advancePool.begin() + _offset)) {
+		return _offset;
+	}
+	const size_t offset = m_codepointPool.size();
+	appendToPool(m_codepoints, m_codepointPool, _codepoints);
+	appendToPool(m_advances, m_advancePool, _advances);
+	return offset;
+}
+
+void GpuTextLayout::clearGlyphs() {
+	m_codepointPool.clear();
+	m_advancePool.clear();
+}
+
+size_t GpuTextLayout::getGlyphCount() const {
+	return m_codepointPool.size();
+}
+
+void GpuTextLayout::setLines(const std::vector<int>& _lines, const size_t& _instanceCount) {
+	m_instanceCount = _instanceCount;
+	uploadChanged(m_lines, m_lineMirror, _lines);
+}
+
+void GpuTextLayout::setPalette(const vec4* _palette) {
+	m_shader->use();
+	m_shader->setVec4Array("Palette", _palette, PALETTE_SIZE);
+}
+
+void GpuTextLayout::draw(RenderQueue* _queue, const float* _viewMatrix, const vec2& _origin, bool _rainbow, float _time) const {
+	if (m_atlas == nullptr || m_instanceCount == 0 || m_lineMirror.empty()) {
+		return;
+	}
+	const GLsizei glyphCount = GLsizei(m_instanceCount);
+	const int lineCount = int(m_lineMirror.size() / 2);
+	_queue->submitCustom(RenderLayer::Text, m_shader, m_atlas->getID(), m_VAO, [=, this](Shader* shader) {
+		shader->setMat4("ViewMatrix", _viewMatrix);
+		shader->setVec2("Origin", _origin);
+		shader->setFloat("LineHeight", float(FONT_SIZE));
+		shader->setInt("LineCount", lineCount);
+		shader->setBool("Rainbow_Enabled", _rainbow);
+		shader->setFloat("Time", _time);
+		const TextureBuffer* buffers[4] = { &m_metrics, &m_codepoints, &m_advances, &m_lines };
+		for (unsigned int i = 0; i < 4; i++) {
+			GLStateCache::get().activeTexture(i + 1);
+			glBindTexture(GL_TEXTURE_BUFFER, buffers[i]->Texture);
+		}
+		glDrawArraysInstanced(GL_TRIANGLES, 0, 6, glyphCount);
+	});
+}
+
+const unsigned long long& GpuTextLayout::getUploadedBytes() const {
+	return m_uploadedBytes;
+}
\ No newline at end of file
@@ -3,9 +3,15 @@
 #include "camera.h"
 #include "utils.h"
 #include "shader.h"
+#include "gl_state.h"
+#include "render_queue.h"
+#include "gpu_text_layout.h"
 #include "macros.h"
 
 #include <cassert>
+#include <cmath>
+#include <algorithm>
+#include <climits>
 
 #include <glad/glad.h>
 
@@ -18,17 +24,17 @@
 
 extern Editor* myEditor;
 
-Label::Label(Camera* _cam, std::wstring _text) : m_camera(_cam), m_text(_text) {
+Label::Label(Camera* _cam, Utf8Text _text) : m_camera(_cam), m_text(std::move(_text)) {
 	m_shader = new Shader(readFile(GLYPH_VERTEX_SHADER_PATH).c_str(), readFile(GLYPH_FRAGMENT_SHADER_PATH).c_str());
 	glGenVertexArrays(1, &m_VAO);
-	glGenBuffers(1, &m_VBO);
-	glBindVertexArray(m_VAO);
-	glBindBuffer(GL_ARRAY_BUFFER, m_VBO);
-	glBufferData(GL_ARRAY_BUFFER, sizeof(float) * 6 * 4, NULL, GL_DYNAMIC_DRAW);
+	GLStateCache::get().bindVertexArray(m_VAO);
+	GLStateCache::get().bindArrayBuffer(myEditor->renderQueue->getVertexBufferID());
 	glEnableVertexAttribArray(0);
-	glVertexAttribPointer(0, 4, GL_FLOAT, GL_FALSE, 4 * sizeof(float), 0);
-	glBindBuffer(GL_ARRAY_BUFFER, 0);
-	glBindVertexArray(0);
+	glVertexAttribPointer(0, 4, GL_FLOAT, GL_FALSE, 5 * sizeof(float), 0);
+	glEnableVertexAttribArray(1);
+	glVertexAttribPointer(1, 1, GL_FLOAT, GL_FALSE, 5 * sizeof(float), reinterpret_cast<void*>(4 * sizeof(float)));
+	m_gpuTextLayout = new GpuTextLayout();
+	applyTheme();
 	ColorRect* baseCR = new ColorRect(m_camera);
 	baseCR->setSize(vec2i(0, FONT_SIZE));
 	baseCR->setPosition(vec2(m_position.x + baseCR->getSize().x / 2.0f, m_position.y + 10));
@@ -51,7 +57,6 @@ Label::Label(Camera* _cam, std::wstring _text) : m_camera(_cam), m_text(_text) {
 			continue;
 		}
 		if (c == L'\n') {
-			m_glyphTextureMap[c] = nullptr;
 			continue;
 		}
 		GlyphTexture* glyphTex = 
@@ -65,59 +70,37 @@ Label::Label(Camera* _cam, std::wstring _text) : m_camera(_cam), m_text(_text) {
 				static_cast<unsigned int>(face->glyph->advance.x),
 				true
 			);
-		m_glyphTextureMap[c] = glyphTex;
+		m_glyphTextures[c] = glyphTex;
+		m_gpuTextLayout->addGlyph(
+			c,
+			face->glyph->bitmap.buffer,
+			face->glyph->bitmap.width,
+			face->glyph->bitmap.rows,
+			vec2(face->glyph->bitmap_left, face->glyph->bitmap_top),
+			static_cast<unsigned int>(face->glyph->advance.x)
+		);
 	}
-
-	if (m_text == L"") return;
-	m_size = vec2();
-	float lastMaxWidth = 0.0f;
-	float lastMaxHeight = 0.0f;
-
-	for (size_t i = 0; i < m_text.size(); i++) {
-		if (m_text[i] == L'\n') {
-			if (lastMaxWidth > m_size.x) {
-				m_size.x = lastMaxWidth;
-			}
-			m_size.y += lastMaxHeight;
-			lastMaxWidth = 0.0f;
-			lastMaxHeight = 0.0f;
-			m_escapeSequenceCount++;
-			m_glyphTextures.push_back(std::nullopt);
-		}
-		else {
-			m_glyphTextures.push_back(m_glyphTextureMap[m_text[i]]);
-			m_size.x += (m_glyphTextureMap[m_text[i]]->getAdvanceX() >> 6);
-			lastMaxWidth += (m_glyphTextureMap[m_text[i]]->getAdvanceX() >> 6);
-			if (lastMaxHeight < m_glyphTextureMap[m_text[i]]->getSize().y) {
-				lastMaxHeight = m_glyphTextureMap[m_text[i]]->getSize().y;
-			}
-			if (i + 1 <= m_glyphTextures.size()) {
-				m_camera->addZoom(vec2(-0.01f));
-			}
-		}
+	m_gpuTextLayout->buildAtlas();
+	if (FT_IS_FIXED_WIDTH(face) && m_glyphTextures[L' '] != nullptr) {
+		m_fixedAdvance = int(m_glyphTextures[L' ']->getAdvanceX() >> 6);
 	}
-	if (m_size.y == 0.0f) {
-		m_size.y = lastMaxHeight;
+	for (wchar_t c = 0; c < 128; c++) {
+		m_fixedPitchGlyphs[c] = m_fixedAdvance != 0 && m_glyphTextures[c] != nullptr &&
+			int(m_glyphTextures[c]->getAdvanceX() >> 6) == m_fixedAdvance;
 	}
+
 	FT_Done_Face(face);
 	FT_Done_FreeType(ft);
-	updateHighlight();
-	for (size_t i = 0; i < m_escapeSequenceCount; i++) {
-		ColorRect* c = nullptr;
-		c = new ColorRect(m_camera);
-		c->setSize(vec2i(0, FONT_SIZE));
-		c->setPosition(vec2(m_position.x + c->getSize().x / 2.0f, m_position.y + (FONT_SIZE * i + 1) + 10));
-		c->setColor(m_selectionColor);
-		m_selectionList.push_back(c);
-	}
-	updateSelection(0, 0);
+	setText(std::move(m_text));
 }
 
 Label::~Label() {
-	for (auto& tex : m_glyphTextureMap) {
-		if (tex.second != nullptr) {
-			delete tex.second;
-		}
+	GLStateCache::get().forgetVertexArray(m_VAO);
+	glDeleteVertexArrays(1, &m_VAO);
+	delete m_gpuTextLayout;
+	delete m_shader;
+	for (GlyphTexture* tex : m_glyphTextures) {
+		delete tex;
 	}
 	for (auto& sel : m_selectionList) {
 		delete sel;
@@ -125,82 +108,311 @@ Label::~Label() {
 }
 
 void Label::update() {
-
-}
-
-void Label::draw() const {
-	glSetRenderMode(GLRenderMode::GL2D);
-	int screenWidth = myEditor->windowSize.x;
-	int screenHeight = myEditor->windowSize.y;
-	float x = m_position.x;
-	float y = -m_position.y - FONT_SIZE / 2;
-	glBindVertexArray(m_VAO);
-	m_shader->use();
-	m_shader->setMat4("ViewMatrix", m_camera->getViewMatrix().data());
-	m_shader->setMat4("ProjectionMatrix", m_camera->getProjectionMatrix().data());
-	m_shader->setVec4("textColor", m_color);
-	m_shader->setFloat("Time", glfwGetTime());
-	m_shader->setBool("Rainbow_Enabled", m_enableRainbow);
-	std::vector<SyntaxHighlight> tempHighlightList = m_higilightList;
-	SyntaxHighlight* currentHighlight = nullptr;
-	for (size_t index = 0; index < m_text.size(); index++) {
-		if (!m_enableRainbow) {
-			if (!tempHighlightList.empty() && tempHighlightList[0].Start == index) {
-				currentHighlight = &tempHighlightList[0];
-			}
-			if (currentHighlight != nullptr) {
-				m_shader->setVec4("textColor", currentHighlight->Color);
-				if (currentHighlight->End - 1 == index) {
-					currentHighlight = nullptr;
-					tempHighlightList.erase(tempHighlightList.begin());
+	size_t firstLine = 0;
+	size_t lastLine = 0;
+	getVisibleLineRange(firstLine, lastLine);
+	if (m_softWrap) {
+		reflowLines(firstLine, lastLine);
+		if (m_prefetchRows > 0) {
+			reflowLines(lastLine + 1, lastLine + size_t(m_prefetchRows));
+		}
+		else if (m_prefetchRows < 0) {
+			const size_t count = size_t(-m_prefetchRows);
+			reflowLines(firstLine > count ? firstLine - count : 0, firstLine);
+		}
+		const double deadline = glfwGetTime() + SOFT_WRAP_REFLOW_BUDGET;
+		while (m_reflowCursor < m_lines.size() && glfwGetTime() < deadline) {
+			const size_t batchEnd = std::min(m_reflowCursor + SOFT_WRAP_REFLOW_BATCH, m_lines.size());
+			for (; m_reflowCursor < batchEnd; m_reflowCursor++) {
+				if (m_lines[m_reflowCursor].Wrap.WrapWidth != m_wrapWidth) {
+					reflowLine(m_reflowCursor);
 				}
 			}
-			else {
-				m_shader->setVec4("textColor", m_color);
-			}
 		}
-		GlyphTexture* ch = nullptr;
-		if (m_glyphTextures[index].has_value()) {
-			if (m_glyphTextures[index].value() != nullptr) {
-				ch = m_glyphTextures[index].value();
-			}
+		getVisibleLineRange(firstLine, lastLine);
+	}
+	m_prefetchRows = 0;
+	if (m_selectionDirty || firstLine != m_selectionFirstLine || lastLine != m_selectionLastLine) {
+		rebuildSelection(firstLine, lastLine);
+		m_selectionFirstLine = firstLine;
+		m_selectionLastLine = lastLine;
+		m_selectionDirty = false;
+	}
+}
+
+size_t Label::findHighlight(const size_t& index) const {
+	size_t low = 0;
+	size_t high = m_higilightList.size();
+	while (low < high) {
+		const size_t middle = low + (high - low) / 2;
+		if (size_t(getHighlight(middle).getEnd()) <= index) {
+			low = middle + 1;
 		}
 		else {
+			high = middle;
+		}
+	}
+	return low;
+}
+
+// currentHighlight is the highlight the glyph at index is inside of, with a Length of zero when there is none
+TokenClass Label::nextGlyphToken(const size_t& index, size_t& highlightIndex, SyntaxHighlight& currentHighlight) const {
+	if (highlightIndex < m_higilightList.size() && getHighlight(highlightIndex).Start == index) {
+		currentHighlight = getHighlight(highlightIndex);
+	}
+	if (currentHighlight.Length == 0) {
+		return TokenClass::Default;
+	}
+	TokenClass result = currentHighlight.Token;
+	if (currentHighlight.getEnd() - 1 == index) {
+		currentHighlight.Length = 0;
+		highlightIndex++;
+	}
+	return result;
+}
+
+void Label::draw() const {
+	size_t firstLine = 0;
+	size_t lastLine = 0;
+	getVisibleLineRange(firstLine, lastLine);
+	if (m_useGpuTextLayout && !m_softWrap) {
+		drawGpuTextLayout(firstLine, lastLine);
+	}
+	else if (!m_lines.empty()) {
+		m_shader->use();
+		m_shader->setFloat("Time", glfwGetTime());
+		m_shader->setBool("Rainbow_Enabled", m_enableRainbow);
+		for (size_t line = firstLine; line <= lastLine; line++) {
+			size_t fromColumn = 0;
+			size_t toColumn = 0;
+			getVisibleColumnRange(line, fromColumn, toColumn);
+			drawLineColumns(line, fromColumn, toColumn);
+		}
+	}
+	for (auto& sel : m_selectionList) {
+		sel->draw();
+	}
+}
+
+void Label::drawLineColumns(const size_t& line, const size_t& fromColumn, const size_t& toColumn) const {
+	RenderQueue* queue = myEditor->renderQueue;
+	const float* viewMatrix = m_camera->getViewMatrix().data();
+	const size_t lineStart = size_t(getLineStart(line));
+	const size_t begin = lineStart + fromColumn;
+	const size_t end = lineStart + toColumn;
+	const std::vector<int>* breaks = (m_softWrap && line < m_lines.size()) ? &m_lines[line].Wrap.Breaks : nullptr;
+	size_t breakIndex = 0;
+	if (breaks != nullptr) {
+		breakIndex = size_t(std::upper_bound(breaks->begin(), breaks->end(), int(fromColumn)) - breaks->begin());
+	}
+	const size_t rowStartColumn = size_t(getRowStartColumn(line, breakIndex));
+	float x = m_position.x + float(getCaretAdvance(line, fromColumn) - getCaretAdvance(line, rowStartColumn));
+	float y = -m_position.y - FONT_SIZE / 2 - float(FONT_SIZE) * getRowOf(line, fromColumn);
+	size_t highlightIndex = findHighlight(begin);
+	SyntaxHighlight currentHighlight{};
+	if (highlightIndex < m_higilightList.size() && size_t(getHighlight(highlightIndex).Start) < begin) {
+		currentHighlight = getHighlight(highlightIndex);
+	}
+	for (size_t index = begin; index < end; index++) {
+		const float t = float(nextGlyphToken(index, highlightIndex, currentHighlight));
+		if (breaks != nullptr && breakIndex < breaks->size() && size_t((*breaks)[breakIndex]) == index - lineStart) {
 			x = m_position.x;
 			y -= FONT_SIZE;
+			breakIndex++;
+		}
+		const wchar_t c = m_text[index];
+		GlyphTexture* ch = (c == L'\n' ? nullptr : findGlyphTexture(c));
+		if (ch == nullptr) {
 			continue;
 		}
-		if (ch != nullptr) {
-			ch->bind();
-			float xpos = (x + ch->getBearing().x);
-			float ypos = y - (ch->getSize().y - ch->getBearing().y);
-			float w = ch->getSize().x;
-			float h = ch->getSize().y;
+		float xpos = (x + ch->getBearing().x);
+		float ypos = y - (ch->getSize().y - ch->getBearing().y);
+		float w = ch->getSize().x;
+		float h = ch->getSize().y;
 
-			float vertices[6][4] = {
-				{ xpos,     ypos + h,   0.0f, 0.0f },
-				{ xpos,     ypos,       0.0f, 1.0f },
-				{ xpos + w, ypos,       1.0f, 1.0f },
+		float vertices[6][5] = {
+			{ xpos,     ypos + h,   0.0f, 0.0f,   t },
+			{ xpos,     ypos,       0.0f, 1.0f,   t },
+			{ xpos + w, ypos,       1.0f, 1.0f,   t },
 
-				{ xpos,     ypos + h,   0.0f, 0.0f },
-				{ xpos + w, ypos,       1.0f, 1.0f },
-				{ xpos + w, ypos + h,   1.0f, 0.0f }
-			};
-			glBindTexture(GL_TEXTURE_2D, ch->getID());
-			glBindBuffer(GL_ARRAY_BUFFER, m_VBO);
-			glBufferSubData(GL_ARRAY_BUFFER, 0, sizeof(vertices), vertices);
+			{ xpos,     ypos + h,   0.0f, 0.0f,   t },
+			{ xpos + w, ypos,       1.0f, 1.0f,   t },
+			{ xpos + w, ypos + h,   1.0f, 0.0f,   t }
+		};
+		queue->submit(m_layer, m_shader, ch->getID(), m_VAO, viewMatrix, vertices, sizeof(vertices), sizeof(float) * 5);
 
-			glBindBuffer(GL_ARRAY_BUFFER, 0);
-			glDrawArrays(GL_TRIANGLES, 0, 6);
+		x += (ch->getAdvanceX() >> 6);
+	}
+}
 
-			x += (ch->getAdvanceX() >> 6);
+void Label::drawGpuTextLayout(const size_t& firstLine, const size_t& lastLine) const {
+	if (m_lines.empty()) {
+		return;
+	}
+	// a pool that is mostly lines scrolled away long ago is dropped, and the visible lines go up again
+	if (m_gpuTextLayout->getGlyphCount() > 4 * m_gpuInstanceCount + GPU_TEXT_LAYOUT_POOL_SLACK) {
+		m_gpuTextLayout->clearGlyphs();
+		m_gpuLineCache.clear();
+	}
+	const size_t visibleLines = lastLine - firstLine + 1;
+	for (auto it = m_gpuLineCache.begin(); it != m_gpuLineCache.end();) {
+		if (it->first + visibleLines < firstLine || it->first > lastLine + visibleLines) {
+			it = m_gpuLineCache.erase(it);
+		}
+		else {
+			++it;
 		}
 	}
-	m_shader->unuse();
-	glBindVertexArray(0);
-	for (auto& sel : m_selectionList) {
-		sel->draw();
+	m_gpuLines.clear();
+	m_gpuInstanceCount = 0;
+	for (size_t line = firstLine; line <= lastLine; line++) {
+		size_t fromColumn = 0;
+		size_t toColumn = 0;
+		getVisibleColumnRange(line, fromColumn, toColumn);
+		GpuLine& cached = m_gpuLineCache[line];
+		if (cached.Revision != m_revision || cached.FromColumn != fromColumn || cached.ToColumn != toColumn) {
+			// an edit elsewhere leaves the glyphs of this line as they were, which placeGlyphs notices
+			m_gpuCodepoints.clear();
+			m_gpuAdvances.clear();
+			const size_t begin = size_t(getLineStart(line)) + fromColumn;
+			const size_t end = size_t(getLineStart(line)) + toColumn;
+			int x = getCaretAdvance(line, fromColumn);
+			size_t highlightIndex = findHighlight(begin);
+			SyntaxHighlight currentHighlight{};
+			if (highlightIndex < m_higilightList.size() && size_t(getHighlight(highlightIndex).Start) < begin) {
+				currentHighlight = getHighlight(highlightIndex);
+			}
+			for (size_t index = begin; index < end; index++) {
+				TokenClass token = nextGlyphToken(index, highlightIndex, currentHighlight);
+				const wchar_t c = m_text[index];
+				if (c == L'\n') {
+					continue;
+				}
+				unsigned int codepoint = c < 128 ? (unsigned int)c : (unsigned int)L'?';
+				m_gpuCodepoints.push_back(codepoint | ((unsigned int)token << 24));
+				m_gpuAdvances.push_back(x);
+				x += getGlyphAdvance(index);
+			}
+			cached.Offset = m_gpuTextLayout->placeGlyphs(cached.Offset, m_gpuCodepoints, m_gpuAdvances);
+			cached.Count = m_gpuCodepoints.size();
+			cached.FromColumn = fromColumn;
+			cached.ToColumn = toColumn;
+			cached.Revision = m_revision;
+		}
+		m_gpuLines.push_back(int(m_gpuInstanceCount));
+		m_gpuLines.push_back(int(cached.Offset));
+		m_gpuInstanceCount += cached.Count;
+	}
+	m_gpuTextLayout->setLines(m_gpuLines, m_gpuInstanceCount);
+	vec2 origin = vec2(m_position.x, -m_position.y - FONT_SIZE / 2 - float(FONT_SIZE) * firstLine);
+	m_gpuTextLayout->draw(myEditor->renderQueue, m_camera->getViewMatrix().data(), origin, m_enableRainbow, float(glfwGetTime()));
+}
+
+void Label::getVisibleRowRange(long long& top, long long& bottom) const {
+	const vec2 topLeft = m_camera->screenToWorld(vec2(0.0f, 0.0f));
+	const vec2 bottomRight = m_camera->screenToWorld(m_camera->getScreenSize());
+	const float originY = -m_position.y - FONT_SIZE / 2;
+	top = (long long)std::floor((originY - topLeft.y) / FONT_SIZE) - 1;
+	bottom = (long long)std::ceil((originY - bottomRight.y) / FONT_SIZE) + 1;
+}
+
+void Label::getVisibleLineRange(size_t& firstLine, size_t& lastLine) const {
+	firstLine = 0;
+	lastLine = 0;
+	if (m_lines.empty()) {
+		return;
+	}
+	const long long maxLine = (long long)m_lines.size() - 1;
+	long long top = 0;
+	long long bottom = 0;
+	getVisibleRowRange(top, bottom);
+	if (m_softWrap) {
+		top = (long long)findLineByRow(std::max(top, 0LL));
+		bottom = (long long)findLineByRow(std::max(bottom, 0LL));
+	}
+	firstLine = (size_t)std::clamp(top, 0LL, maxLine);
+	lastLine = (size_t)std::clamp(bottom, (long long)firstLine, maxLine);
+}
+
+long long Label::getFirstVisibleRow() const {
+	long long top = 0;
+	long long bottom = 0;
+	getVisibleRowRange(top, bottom);
+	return top + 1;
+}
+
+size_t Label::getRowCount() const {
+	if (m_softWrap) {
+		return size_t(getWrapRows().total());
+	}
+	return m_lines.size();
+}
+
+void Label::prefetch(const long long& rows) {
+	// a line is at least one row, so lines past the edge of the viewport cover at least as many rows
+	m_prefetchRows = std::clamp(rows, -(long long)SCROLL_PREFETCH_MAX_LINES, (long long)SCROLL_PREFETCH_MAX_LINES);
+}
+
+void Label::getVisibleColumnRange(const size_t& line, size_t& fromColumn, size_t& toColumn) const {
+	const size_t length = size_t(getLineEnd(line) - getLineStart(line));
+	if (m_softWrap && line < m_lines.size()) {
+		long long top = 0;
+		long long bottom = 0;
+		getVisibleRowRange(top, bottom);
+		const std::vector<int>& breaks = m_lines[line].Wrap.Breaks;
+		const long long rowBase = getRowsBefore(line);
+		const size_t firstRow = size_t(std::clamp(top - rowBase, 0LL, (long long)breaks.size()));
+		const size_t lastRow = size_t(std::clamp(bottom - rowBase, 0LL, (long long)breaks.size()));
+		fromColumn = size_t(getRowStartColumn(line, firstRow));
+		toColumn = lastRow < breaks.size() ? size_t(breaks[lastRow]) : length;
+		return;
+	}
+	const vec2 topLeft = m_camera->screenToWorld(vec2(0.0f, 0.0f));
+	const vec2 bottomRight = m_camera->screenToWorld(m_camera->getScreenSize());
+	fromColumn = getColumnAt(line, topLeft.x - m_position.x - FONT_SIZE);
+	toColumn = std::min(length, getColumnAt(line, bottomRight.x - m_position.x + FONT_SIZE) + 1);
+	toColumn = std::max(toColumn, fromColumn);
+}
+
+void Label::setText(Utf8Text _text) {
+	if (m_editListener) {
+		m_editListener(0, m_text.getBytes().size(), _text.getBytes());
+	}
+	m_text = std::move(_text);
+	m_escapeSequenceCount = 0;
+	m_size = vec2();
+	float lastMaxWidth = 0.0f;
+	float lastMaxHeight = 0.0f;
+
+	for (size_t i = 0; i < m_text.size(); i++) {
+		const wchar_t c = m_text[i];
+		if (c == L'\n') {
+			if (lastMaxWidth > m_size.x) {
+				m_size.x = lastMaxWidth;
+			}
+			m_size.y += lastMaxHeight;
+			lastMaxWidth = 0.0f;
+			lastMaxHeight = 0.0f;
+			m_escapeSequenceCount++;
+		}
+		else {
+			GlyphTexture* tex = findGlyphTexture(c);
+			m_size.x += (tex->getAdvanceX() >> 6);
+			lastMaxWidth += (tex->getAdvanceX() >> 6);
+			if (lastMaxHeight < tex->getSize().y) {
+				lastMaxHeight = tex->getSize().y;
+			}
+		}
 	}
+	if (m_size.y == 0.0f) {
+		m_size.y = lastMaxHeight;
+	}
+	updateBlockList();
+	updateHighlight();
+	if (m_softWrap) {
+		resetWrappedLines();
+	}
+	updateSelection(0, 0);
 }
 
 void Label::push_back(const wchar_t& ch) {
@@ -208,23 +420,38 @@ void Label::push_back(const wchar_t& ch) {
 }
 
 void Label::insert(const size_t& at, const wchar_t& ch) {
-	m_text.insert(m_text.begin() + at, ch);
-	if (ch == L'\n') {
-		m_escapeSequenceCount++;
-		m_glyphTextures.insert(m_glyphTextures.begin() + at, std::nullopt);
-		m_size.y += FONT_SIZE;
+	const int line = getBelongBlock(int(at));
+	if (m_editListener) {
+		m_editListener(m_text.getByteOffset(at), 0, encodeUtf8(std::wstring(1, ch)));
+	}
+	m_text.insert(at, ch);
+	if (line < 0) {
 		updateBlockList();
 		updateHighlight();
+		if (m_softWrap) {
+			resetWrappedLines();
+		}
 		return;
 	}
-	if (m_glyphTextureMap.find(ch) == m_glyphTextureMap.end()) {
+	// only the chunk of the line around the edit is measured again, the lines after it just move over
+	const size_t row = size_t(line);
+	const size_t column = at - size_t(getLineStart(row));
+	shiftLinesAfter(row, 1);
+	m_lines[row].End++;
+	if (ch == L'\n') {
+		m_escapeSequenceCount++;
+		m_size.y += FONT_SIZE;
+		splitLine(row, column);
+		updateHighlightAround(at, 0, 1);
+		syncWrappedLines(row, column, 0);
+		syncWrappedLines(row + 1, 0, 0);
 		return;
 	}
-	GlyphTexture* tex = m_glyphTextureMap[ch];
-	m_size.x += (tex->getAdvanceX() >> 6);
-	m_glyphTextures.insert(m_glyphTextures.begin() + at, tex);
-	updateHighlight();
-	updateBlockList();
+	const int advance = getGlyphAdvance(at);
+	m_size.x += float(advance);
+	patchLine(row, column, 1, advance);
+	updateHighlightAround(at, 0, 1);
+	syncWrappedLines(row, column, 1);
 }
 
 
@@ -232,29 +459,211 @@ void Label::erase(const size_t& at) {
 	if (!(at >= 0 && at < m_text.size())) {
 		return;
 	}
-	m_text.erase(m_text.begin() + at);
-	if (m_glyphTextures[m_glyphTextures.size() - 1].has_value()){
-		m_size.x -= (m_glyphTextures[m_glyphTextures.size() - 1].value()->getAdvanceX() >> 6);
+	const int line = getBelongBlock(int(at));
+	const bool joinsLines = m_text[at] == L'\n';
+	const int advance = getGlyphAdvance(at);
+	if (!joinsLines) {
+		m_size.x -= float(advance);
 	}
 	else {
 		m_size.y -= FONT_SIZE;
 		m_escapeSequenceCount--;
 	}
-	m_glyphTextures.erase(m_glyphTextures.begin() + at);
-	updateHighlight();
-	updateBlockList();
+	if (m_editListener) {
+		const size_t byte = m_text.getByteOffset(at);
+		m_editListener(byte, m_text.getByteOffset(at + 1) - byte, std::string());
+	}
+	m_text.erase(at);
+	if (line < 0 || (joinsLines && size_t(line) + 1 >= m_lines.size())) {
+		updateBlockList();
+		updateHighlight();
+		if (m_softWrap) {
+			resetWrappedLines();
+		}
+		return;
+	}
+	const size_t row = size_t(line);
+	const size_t column = at - size_t(getLineStart(row));
+	shiftLinesAfter(row, -1);
+	if (joinsLines) {
+		joinLine(row);
+		updateHighlightAround(at, 1, 0);
+		syncWrappedLines(row, column, 0);
+		return;
+	}
+	m_lines[row].End--;
+	patchLine(row, column, -1, -advance);
+	updateHighlightAround(at, 1, 0);
+	syncWrappedLines(row, column, -1);
+}
+
+void Label::applyEdits(const std::vector<TextEdit>& edits) {
+	if (edits.empty()) {
+		return;
+	}
+	// the text splices the whole batch in place; only the lines from the first to the last edit are measured again
+	// and the highlighting is resynced once over that span
+	std::vector<TextEdit> batch;
+	std::vector<long long> growth;
+	batch.reserve(edits.size());
+	growth.reserve(edits.size());
+	size_t copied = 0;
+	long long growthBytes = 0;
+	for (const TextEdit& edit : edits) {
+		const size_t offset = std::clamp(edit.Offset, copied, m_text.size());
+		const size_t eraseEnd = std::min(offset + edit.EraseCount, m_text.size());
+		for (size_t i = offset; i < eraseEnd; i++) {
+			if (m_text[i] != L'\n') {
+				m_size.x -= float(getGlyphAdvance(i));
+			}
+			else {
+				m_size.y -= FONT_SIZE;
+				m_escapeSequenceCount--;
+			}
+		}
+		for (const wchar_t& ch : edit.Text) {
+			if (ch == L'\n') {
+				m_size.y += FONT_SIZE;
+				m_escapeSequenceCount++;
+				continue;
+			}
+			GlyphTexture* tex = findGlyphTexture(ch);
+			m_size.x += (tex != nullptr ? float(tex->getAdvanceX() >> 6) : 0.0f);
+		}
+		if (m_editListener) {
+			// offsets are told in the text as it is after the edits before this one
+			const size_t from = m_text.getByteOffset(offset);
+			const size_t to = m_text.getByteOffset(eraseEnd);
+			const std::string inserted = encodeUtf8(edit.Text);
+			m_editListener(size_t((long long)from + growthBytes), to - from, inserted);
+			growthBytes += (long long)inserted.size() - (long long)(to - from);
+		}
+		size_t inserted = edit.Text.size();
+		if (sizeof(wchar_t) == 2) {
+			// a surrogate pair is a single character of the text
+			for (size_t k = 1; k < edit.Text.size(); k++) {
+				if (edit.Text[k - 1] >= 0xD800 && edit.Text[k - 1] <= 0xDBFF && edit.Text[k] >= 0xDC00 && edit.Text[k] <= 0xDFFF) {
+					inserted--;
+					k++;
+				}
+			}
+		}
+		growth.push_back((long long)inserted - (long long)(eraseEnd - offset));
+		batch.push_back(TextEdit{ offset, eraseEnd - offset, edit.Text });
+		copied = eraseEnd;
+	}
+	// the lines each edit touches, numbered as before the batch
+	std::vector<std::pair<size_t, size_t>> touched;
+	touched.reserve(batch.size());
+	bool found = true;
+	for (const TextEdit& edit : batch) {
+		const int firstLine = getBelongBlock(int(edit.Offset));
+		const int lastLine = getBelongBlock(int(edit.Offset + edit.EraseCount));
+		found = found && firstLine >= 0 && lastLine >= 0;
+		touched.emplace_back(size_t(firstLine), size_t(lastLine));
+	}
+	const size_t oldSize = m_text.size();
+	m_text.applyEdits(batch);
+	m_selectionDirty = true;
+	if (!found) {
+		updateBlockList();
+		updateHighlight();
+		if (m_softWrap) {
+			resetWrappedLines();
+		}
+		return;
+	}
+	// edits sharing a line are laid out again together, the lines after a group only move
+	long long lineGrowth = 0;
+	size_t first = 0;
+	while (first < batch.size()) {
+		size_t last = first;
+		long long delta = growth[first];
+		while (last + 1 < batch.size() && touched[last + 1].first <= touched[last].second) {
+			last++;
+			delta += growth[last];
+		}
+		const size_t firstLine = size_t((long long)touched[first].first + lineGrowth);
+		const size_t lastLine = size_t((long long)touched[last].second + lineGrowth);
+		int lineStart = getLineStart(firstLine);
+		const size_t regionEnd = size_t((long long)getLineEnd(lastLine) + delta);
+		moveLineGap(firstLine);
+		for (size_t line = firstLine; line <= lastLine; line++) {
+			eraseLine(firstLine);
+		}
+		m_lineShift += int(delta);
+		size_t line = firstLine;
+		for (size_t i = size_t(lineStart); i <= regionEnd; i++) {
+			if (i < regionEnd && m_text[i] != L'\n') {
+				continue;
+			}
+			LineLayout layout;
+			layout.Start = lineStart;
+			layout.End = int(i);
+			measureLine(layout, size_t(lineStart), i);
+			insertLine(line, std::move(layout));
+			syncWrappedLines(line, 0, 0);
+			line++;
+			lineStart = int(i) + 1;
+		}
+		lineGrowth += (long long)(line - firstLine) - (long long)(lastLine - firstLine + 1);
+		first = last + 1;
+	}
+	const size_t erased = batch.back().Offset + batch.back().EraseCount - batch.front().Offset;
+	updateHighlightAround(batch.front().Offset, erased, size_t((long long)erased + (long long)m_text.size() - (long long)oldSize));
+}
+
+void Label::appendText(const std::string& utf8) {
+	if (utf8.empty()) {
+		return;
+	}
+	const size_t from = m_text.size();
+	const size_t lastLine = m_lines.empty() ? 0 : m_lines.size() - 1;
+	if (m_editListener) {
+		m_editListener(m_text.getBytes().size(), 0, utf8);
+	}
+	m_text.appendUtf8(utf8);
+	for (size_t i = from; i < m_text.size(); i++) {
+		if (m_text[i] == L'\n') {
+			m_size.y += FONT_SIZE;
+			m_escapeSequenceCount++;
+			continue;
+		}
+		m_size.x += float(getGlyphAdvance(i));
+	}
+	// the open last line is laid out again, highlighting restarts at the first token that reached into it
+	size_t resume = m_lines.empty() ? 0 : size_t(getLineStart(lastLine));
+	updateBlockList(lastLine);
+	for (size_t kept = m_higilightList.size(); kept > 0 && size_t(getHighlight(kept - 1).getEnd()) >= resume; kept--) {
+		resume = std::min(resume, size_t(getHighlight(kept - 1).Start));
+	}
+	updateHighlight(resume);
+	if (m_softWrap) {
+		resetWrappedLines();
+	}
+	m_selectionDirty = true;
 }
 
 void Label::pop_back() {
 	if (m_text.empty()) return;
+	if (m_editListener) {
+		const size_t byte = m_text.getByteOffset(m_text.size() - 1);
+		m_editListener(byte, m_text.getBytes().size() - byte, std::string());
+	}
 	m_text.pop_back();
-	m_glyphTextures.pop_back();
 	updateHighlight();
 	updateBlockList();
+	if (m_softWrap) {
+		resetWrappedLines();
+	}
+}
+
+void Label::setLayer(const RenderLayer& _layer) {
+	m_layer = _layer;
 }
 
-const std::vector<std::optional<GlyphTexture*>>& Label::getGlyphTextures() {
-	return m_glyphTextures;
+void Label::setEditListener(TextEditListener _listener) {
+	m_editListener = std::move(_listener);
 }
 
 void Label::setPosition(const vec2& _pos) {
@@ -272,81 +681,613 @@ const size_t& Label::getEscapeSequenceCount() {
 }
 
 
-void Label::updateBlockList() {
-	m_blockList.clear();
-	bool first_initialized = false;
-	std::pair<int, int> holder{0, 0};
-	for (size_t i = 0; i < m_glyphTextures.size(); i++) {
-		if (m_glyphTextures[i].has_value()) {
-			if (!first_initialized) {
-				first_initialized = true;
-				holder.first = i;
+void Label::updateBlockList(const size_t& fromLine) {
+	// lines before fromLine are kept as they are, which is what appending to the end needs
+	const size_t keptLines = std::min(fromLine, m_lines.size());
+	if (keptLines == 0) {
+		std::vector<LineLayout> lines;
+		int lineStart = 0;
+		for (size_t i = 0; i <= m_text.size(); i++) {
+			if (i < m_text.size() && m_text[i] != L'\n') {
+				continue;
 			}
-			else {
-				holder.second = i;
-			}
-			continue;
+			LineLayout layout;
+			layout.Start = lineStart;
+			layout.End = int(i);
+			measureLine(layout, size_t(lineStart), i);
+			lines.push_back(std::move(layout));
+			lineStart = int(i) + 1;
 		}
-		if (!first_initialized) 
-		{
-			holder = { holder.first, holder.first };
-			m_blockList.emplace_back(holder);
-			holder = { holder.first + 1, 0 };
-			first_initialized = false;
+		m_lines.assign(std::move(lines));
+		m_lineShift = 0;
+		rebuildLineTrees();
+		return;
+	}
+	moveLineGap(keptLines);
+	while (m_lines.size() > keptLines) {
+		eraseLine(keptLines);
+	}
+	m_lineShift = 0;
+	int lineStart = getLineEnd(keptLines - 1) + 1;
+	for (size_t i = size_t(lineStart); i <= m_text.size(); i++) {
+		if (i < m_text.size() && m_text[i] != L'\n') {
 			continue;
 		}
-		holder.second += 1;
-		if (holder.second == 1) {
-			holder.second += holder.first;
+		LineLayout layout;
+		layout.Start = lineStart;
+		layout.End = int(i);
+		measureLine(layout, size_t(lineStart), i);
+		insertLine(m_lines.size(), std::move(layout));
+		lineStart = int(i) + 1;
+	}
+}
+
+// one walk over the line, the chunks are only filled in once a glyph on it turns out not to be fixed pitch
+void Label::measureLine(LineLayout& layout, const size_t& lineStart, const size_t& lineEnd) const {
+	std::vector<AdvanceChunk>& chunks = layout.Chunks;
+	chunks.clear();
+	bool irregular = m_fixedAdvance == 0;
+	if (irregular) {
+		chunks.push_back(AdvanceChunk{});
+	}
+	int advance = 0;
+	for (size_t i = lineStart; i < lineEnd; i++) {
+		const size_t column = i - lineStart;
+		if (!irregular) {
+			if (isFixedPitch(m_text[i])) {
+				advance += m_fixedAdvance;
+				continue;
+			}
+			irregular = true;
+			fillFixedChunks(chunks, column);
+		}
+		if (column % LABEL_ADVANCE_CHUNK_SIZE == 0 && column > 0) {
+			chunks.push_back(AdvanceChunk{ int(column), advance });
 		}
-		m_blockList.emplace_back(holder);
-		holder = { holder.second + 1, 0 };
-		first_initialized = false;
+		advance += getGlyphAdvance(i);
+	}
+	layout.Width = advance;
+}
+
+// the chunks of the first columns of a line that is fixed pitch up to there, which need no walk over the text
+void Label::fillFixedChunks(std::vector<AdvanceChunk>& chunks, const size_t& columns) const {
+	chunks.push_back(AdvanceChunk{});
+	for (size_t column = LABEL_ADVANCE_CHUNK_SIZE; column < columns; column += LABEL_ADVANCE_CHUNK_SIZE) {
+		chunks.push_back(AdvanceChunk{ int(column), int(column) * m_fixedAdvance });
+	}
+}
+
+// one character was inserted at column (delta 1) or erased there (delta -1), and the line got advance wider;
+// the chunk holding the column is the only one walked, and only when it grew too long
+void Label::patchLine(const size_t& line, const size_t& column, const int& delta, const int& advance) {
+	LineLayout& layout = m_lines[line];
+	std::vector<AdvanceChunk>& chunks = layout.Chunks;
+	const size_t lineStart = size_t(getLineStart(line));
+	const int length = getLineEnd(line) - int(lineStart);
+	layout.Width += advance;
+	if (chunks.empty() && (delta < 0 || (m_fixedAdvance != 0 && isFixedPitch(m_text[lineStart + column])))) {
+		m_lineWidthTree.update(m_lines.toPhysical(line), layout.Width);
+		return;
+	}
+	if (chunks.empty()) {
+		fillFixedChunks(chunks, size_t(length - delta));
 	}
-	if (first_initialized) {
-		holder.second = m_glyphTextures.size();
-		m_blockList.emplace_back(holder);
+	auto it = std::upper_bound(chunks.begin(), chunks.end(), int(column), [](const int& value, const AdvanceChunk& chunk) {
+		return value < chunk.Column;
+	});
+	const size_t chunk = size_t(it - chunks.begin()) - 1;
+	for (size_t i = chunk + 1; i < chunks.size(); i++) {
+		chunks[i].Column += delta;
+		chunks[i].Advance += advance;
 	}
-	else if (m_blockList.size() != m_glyphTextures.size()) {
-		holder.second = m_glyphTextures.size();
-		m_blockList.push_back(holder);
+	if (chunk + 1 < chunks.size() && chunks[chunk + 1].Column == chunks[chunk].Column) {
+		chunks.erase(chunks.begin() + chunk + 1);
 	}
+	const int chunkEnd = chunk + 1 < chunks.size() ? chunks[chunk + 1].Column : length;
+	if (chunkEnd - chunks[chunk].Column > 2 * LABEL_ADVANCE_CHUNK_SIZE) {
+		std::vector<AdvanceChunk> split;
+		int splitAdvance = chunks[chunk].Advance;
+		for (int c = chunks[chunk].Column; c < chunkEnd; c++) {
+			if (c > chunks[chunk].Column && (c - chunks[chunk].Column) % LABEL_ADVANCE_CHUNK_SIZE == 0) {
+				split.push_back(AdvanceChunk{ c, splitAdvance });
+			}
+			splitAdvance += getGlyphAdvance(lineStart + size_t(c));
+		}
+		chunks.insert(chunks.begin() + chunk + 1, split.begin(), split.end());
+	}
+	m_lineWidthTree.update(m_lines.toPhysical(line), layout.Width);
 }
 
-int Label::getBelongBlock(const int& at) {
-	updateBlockList();
-	if (m_blockList.size() == 0) {
+// a line break was typed at column, what followed it moves to a new line with its chunks and wrap breaks
+void Label::splitLine(const size_t& line, const size_t& column) {
+	LineLayout& layout = m_lines[line];
+	const int advance = getCaretAdvance(line, column);
+	LineLayout next;
+	next.Start = layout.Start + int(column) + 1;
+	next.End = layout.End;
+	next.Width = layout.Width - advance;
+	layout.End = layout.Start + int(column);
+	layout.Width = advance;
+	if (!layout.Chunks.empty()) {
+		auto it = std::upper_bound(layout.Chunks.begin(), layout.Chunks.end(), int(column), [](const int& value, const AdvanceChunk& chunk) {
+			return value < chunk.Column;
+		});
+		next.Chunks.push_back(AdvanceChunk{});
+		for (auto moved = it; moved != layout.Chunks.end(); moved++) {
+			next.Chunks.push_back(AdvanceChunk{ moved->Column - int(column), moved->Advance - advance });
+		}
+		layout.Chunks.erase(it, layout.Chunks.end());
+	}
+	if (m_softWrap && layout.Wrap.WrapWidth == m_wrapWidth) {
+		next.Wrap.WrapWidth = m_wrapWidth;
+		for (const int& at : layout.Wrap.Breaks) {
+			if (at > int(column)) {
+				next.Wrap.Breaks.push_back(at - int(column));
+			}
+		}
+	}
+	m_lineWidthTree.update(m_lines.toPhysical(line), layout.Width);
+	insertLine(line + 1, std::move(next));
+}
+
+// the line break ending line was erased, the next line is appended to it with its chunks and wrap breaks
+void Label::joinLine(const size_t& line) {
+	LineLayout& layout = m_lines[line];
+	const LineLayout& next = m_lines[line + 1];
+	const int column = layout.End - layout.Start;
+	if (!layout.Chunks.empty() || !next.Chunks.empty()) {
+		if (layout.Chunks.empty()) {
+			fillFixedChunks(layout.Chunks, size_t(column));
+		}
+		std::vector<AdvanceChunk> appended;
+		if (next.Chunks.empty()) {
+			fillFixedChunks(appended, size_t(next.End - next.Start));
+		}
+		for (const AdvanceChunk& chunk : (next.Chunks.empty() ? appended : next.Chunks)) {
+			if (chunk.Column + column > layout.Chunks.back().Column) {
+				layout.Chunks.push_back(AdvanceChunk{ chunk.Column + column, chunk.Advance + layout.Width });
+			}
+		}
+	}
+	layout.Width += next.Width;
+	if (m_softWrap) {
+		if (layout.Wrap.WrapWidth == m_wrapWidth && next.Wrap.WrapWidth == m_wrapWidth) {
+			for (const int& at : next.Wrap.Breaks) {
+				layout.Wrap.Breaks.push_back(at + column);
+			}
+			if (!m_wrapRowsDirty) {
+				m_wrapRows.add(m_lines.toPhysical(line), (long long)next.Wrap.Breaks.size());
+			}
+		}
+		else {
+			layout.Wrap.WrapWidth = -1;
+		}
+	}
+	layout.End = getLineEnd(line + 1);
+	m_lineWidthTree.update(m_lines.toPhysical(line), layout.Width);
+	eraseLine(line + 1);
+}
+
+int Label::getLineStart(const size_t& line) const {
+	return m_lines[line].Start + (line < m_lines.gapStart() ? 0 : m_lineShift);
+}
+
+int Label::getLineEnd(const size_t& line) const {
+	return m_lines[line].End + (line < m_lines.gapStart() ? 0 : m_lineShift);
+}
+
+void Label::moveLineGap(const size_t& line) {
+	m_lines.moveGap(line, [this](LineLayout& layout, const size_t& from, const size_t& to) {
+		// a line crossing the gap takes the shift still owed to the lines after it along, or hands it back
+		const int shift = to < from ? m_lineShift : -m_lineShift;
+		layout.Start += shift;
+		layout.End += shift;
+		m_lineWidthTree.update(from, INT_MIN);
+		m_lineWidthTree.update(to, layout.Width);
+		if (m_softWrap && !m_wrapRowsDirty) {
+			const long long rows = (long long)layout.Wrap.Breaks.size() + 1;
+			m_wrapRows.add(from, -rows);
+			m_wrapRows.add(to, rows);
+		}
+	});
+}
+
+// the lines after line move by delta, which only the gap has to remember
+void Label::shiftLinesAfter(const size_t& line, const int& delta) {
+	moveLineGap(line + 1);
+	m_lineShift += delta;
+}
+
+// layout.Start and layout.End are where the line is now, not relative to the gap
+void Label::insertLine(const size_t& line, LineLayout layout) {
+	moveLineGap(line);
+	const size_t slot = m_lines.gapStart();
+	const int width = layout.Width;
+	const long long rows = (long long)layout.Wrap.Breaks.size() + 1;
+	if (m_lines.insertAtGap(std::move(layout))) {
+		rebuildLineTrees();
+		return;
+	}
+	m_lineWidthTree.update(slot, width);
+	if (m_softWrap && !m_wrapRowsDirty) {
+		m_wrapRows.add(slot, rows);
+	}
+}
+
+void Label::eraseLine(const size_t& line) {
+	moveLineGap(line);
+	const size_t slot = m_lines.toPhysical(line);
+	const LineLayout layout = m_lines.eraseAfterGap();
+	m_lineWidthTree.update(slot, INT_MIN);
+	if (m_softWrap && !m_wrapRowsDirty) {
+		m_wrapRows.add(slot, -((long long)layout.Wrap.Breaks.size() + 1));
+	}
+}
+
+void Label::rebuildLineTrees() {
+	std::vector<int> widths(m_lines.capacity(), INT_MIN);
+	for (size_t slot = 0; slot < widths.size(); slot++) {
+		if (!m_lines.isGap(slot)) {
+			widths[slot] = m_lines.physical(slot).Width;
+		}
+	}
+	m_lineWidthTree.build(widths);
+	m_wrapRowsDirty = true;
+}
+
+bool Label::isFixedPitch(const wchar_t& ch) const {
+	return m_fixedPitchGlyphs[ch < 128 ? ch : L'?'];
+}
+
+int Label::getGlyphAdvance(const size_t& index) const {
+	const wchar_t c = m_text[index];
+	if (index >= m_text.size() || c == L'\n') {
+		return 0;
+	}
+	const GlyphTexture* glyph = findGlyphTexture(c);
+	return glyph != nullptr ? int(glyph->getAdvanceX() >> 6) : 0;
+}
+
+int Label::getBelongBlock(const int& at) const {
+	if (m_lines.size() == 0) {
 		return 0;
 	}
-	for (int i = 0; i < m_blockList.size(); i++) {
-		if (m_blockList[i].first <= at && at <= m_blockList[i].second) {
-			return i;
+	size_t low = 0;
+	size_t high = m_lines.size();
+	while (low < high) {
+		const size_t middle = low + (high - low) / 2;
+		if (getLineStart(middle) <= at) {
+			low = middle + 1;
 		}
+		else {
+			high = middle;
+		}
+	}
+	if (low == 0 || at > getLineEnd(low - 1)) {
+		return -1;
 	}
-	return -1;
+	return int(low - 1);
 }
 
-int Label::getLongestBlock() {
-	size_t result = 0;
-	int value = -1;
-	for (size_t i = 0; i < m_blockList.size(); i++) {
-		if (m_blockList[i].second - m_blockList[i].first > value) {
-			value = m_blockList[i].second - m_blockList[i].first;
-			result = i;
+int Label::getCaretAdvance(const size_t& offset) const {
+	const int line = getBelongBlock(int(offset));
+	if (line < 0 || m_lines.empty()) {
+		return 0;
+	}
+	return getCaretAdvance(size_t(line), offset - size_t(getLineStart(line)));
+}
+
+int Label::getCaretAdvance(const size_t& line, const size_t& column) const {
+	if (line >= m_lines.size()) {
+		return 0;
+	}
+	const std::vector<AdvanceChunk>& chunks = m_lines[line].Chunks;
+	if (chunks.empty()) {
+		return int(column) * m_fixedAdvance;
+	}
+	const size_t lineStart = size_t(getLineStart(line));
+	const size_t target = std::min(column, size_t(getLineEnd(line)) - lineStart);
+	auto chunk = std::upper_bound(chunks.begin(), chunks.end(), int(target), [](const int& value, const AdvanceChunk& chunk) {
+		return value < chunk.Column;
+	}) - 1;
+	int advance = chunk->Advance;
+	for (size_t c = size_t(chunk->Column); c < target; c++) {
+		advance += getGlyphAdvance(lineStart + c);
+	}
+	return advance;
+}
+
+size_t Label::getColumnAt(const size_t& line, const float& x) const {
+	if (line >= m_lines.size() || x <= 0.0f) {
+		return 0;
+	}
+	const size_t lineStart = size_t(getLineStart(line));
+	const size_t length = size_t(getLineEnd(line)) - lineStart;
+	const std::vector<AdvanceChunk>& chunks = m_lines[line].Chunks;
+	if (chunks.empty()) {
+		return std::min(length, size_t(x / float(m_fixedAdvance)));
+	}
+	auto chunk = std::upper_bound(chunks.begin(), chunks.end(), int(x), [](const int& value, const AdvanceChunk& chunk) {
+		return value < chunk.Advance;
+	});
+	chunk = (chunk == chunks.begin()) ? chunk : chunk - 1;
+	size_t column = size_t(chunk->Column);
+	int advance = chunk->Advance;
+	while (column < length) {
+		const int next = advance + getGlyphAdvance(lineStart + column);
+		if (float(next) > x) {
+			break;
 		}
+		advance = next;
+		column++;
+	}
+	return column;
+}
+
+TextLayoutPosition Label::getLayoutPosition(const size_t& offset) const {
+	TextLayoutPosition result;
+	const int line = getBelongBlock(int(offset));
+	if (line < 0 || m_lines.empty()) {
+		return result;
+	}
+	result.Line = size_t(line);
+	result.Column = offset - size_t(getLineStart(line));
+	result.Row = getRowOf(result.Line, result.Column);
+	result.X = float(getCaretAdvance(result.Line, result.Column));
+	if (m_softWrap) {
+		const size_t rowInLine = result.Row - size_t(getRowsBefore(result.Line));
+		result.X -= float(getCaretAdvance(result.Line, size_t(getRowStartColumn(result.Line, rowInLine))));
 	}
 	return result;
 }
 
-const std::vector<std::pair<int, int>>& Label::getBlockList() {
-	return m_blockList;
+size_t Label::getOffsetAt(const vec2& world) const {
+	if (m_lines.empty()) {
+		return 0;
+	}
+	const long long row = std::max(0LL, (long long)std::floor((-world.y - 10.0f + FONT_SIZE / 2.0f) / FONT_SIZE));
+	size_t line = std::min(size_t(row), m_lines.size() - 1);
+	size_t rowInLine = 0;
+	if (m_softWrap) {
+		line = findLineByRow(row);
+		rowInLine = size_t(std::clamp(row - getRowsBefore(line), 0LL, (long long)m_lines[line].Wrap.Breaks.size()));
+	}
+	const size_t length = size_t(getLineEnd(line) - getLineStart(line));
+	const size_t rowStart = size_t(getRowStartColumn(line, rowInLine));
+	size_t rowEnd = length;
+	if (m_softWrap && rowInLine < m_lines[line].Wrap.Breaks.size()) {
+		rowEnd = size_t(m_lines[line].Wrap.Breaks[rowInLine]) - 1;
+	}
+	const float x = world.x - m_position.x + float(getCaretAdvance(line, rowStart));
+	size_t column = getColumnAt(line, x);
+	if (column < length) {
+		const int left = getCaretAdvance(line, column);
+		const int right = left + getGlyphAdvance(size_t(getLineStart(line)) + column);
+		if (x - float(left) > float(right) - x) {
+			column++;
+		}
+	}
+	column = std::clamp(column, rowStart, std::max(rowStart, rowEnd));
+	return size_t(getLineStart(line)) + column;
+}
+
+void Label::getWordAt(const size_t& offset, size_t& start, size_t& end) const {
+	auto isWordChar = [](const wchar_t& c) {
+		return isAlphabet(c) || isNumber(c) || c == L'_';
+	};
+	start = std::min(offset, m_text.size());
+	end = start;
+	while (start > 0 && isWordChar(m_text[start - 1])) {
+		start--;
+	}
+	while (end < m_text.size() && isWordChar(m_text[end])) {
+		end++;
+	}
+}
+
+void Label::resetWrappedLines() {
+	for (size_t line = 0; line < m_lines.size(); line++) {
+		m_lines[line].Wrap = WrappedLine{};
+	}
+	m_wrapRowsDirty = true;
+	m_reflowCursor = 0;
+	m_wrapLayoutChanged = true;
+	size_t firstLine = 0;
+	size_t lastLine = 0;
+	getVisibleLineRange(firstLine, lastLine);
+	reflowLines(firstLine, lastLine);
+}
+
+void Label::syncWrappedLines(const size_t& line, const size_t& column, const int& delta) {
+	if (!m_softWrap || line >= m_lines.size()) {
+		return;
+	}
+	reflowLine(line, column, delta);
+}
+
+// the line was edited at column, delta columns were inserted there or erased when it is negative;
+// the breaks before the row ahead of the edit still hold, and once the scan breaks past the edit
+// where an old break was moved to, the old breaks after that one hold as well
+void Label::reflowLine(const size_t& line, const size_t& column, const int& delta) {
+	WrappedLine& wrapped = m_lines[line].Wrap;
+	std::vector<int>& breaks = wrapped.Breaks;
+	const size_t before = breaks.size();
+	size_t kept = 0;
+	size_t candidate = before;
+	if (wrapped.WrapWidth == m_wrapWidth) {
+		const size_t row = size_t(std::upper_bound(breaks.begin(), breaks.end(), int(column)) - breaks.begin());
+		kept = row > 0 ? row - 1 : 0;
+		candidate = row;
+	}
+	wrapped.WrapWidth = m_wrapWidth;
+	const int base = getLineStart(line);
+	const int length = getLineEnd(line) - base;
+	const int resyncFrom = int(column) + std::max(delta, 0);
+	std::vector<int> found;
+	size_t resync = before;
+	int rowStart = kept > 0 ? breaks[kept - 1] : 0;
+	int rowStartAdvance = 0;
+	int advance = 0;
+	int lastSpace = -1;
+	int afterSpaceAdvance = 0;
+	auto breakAt = [&](const int& at, const int& atAdvance) {
+		rowStart = at;
+		rowStartAdvance = atAdvance;
+		lastSpace = -1;
+		found.push_back(at);
+		if (at < resyncFrom) {
+			return;
+		}
+		while (candidate < before && breaks[candidate] + delta < at) {
+			candidate++;
+		}
+		if (candidate < before && breaks[candidate] + delta == at) {
+			resync = candidate;
+		}
+	};
+	for (int c = rowStart; c < length && m_wrapWidth > 0 && resync == before; c++) {
+		const int glyphAdvance = getGlyphAdvance(size_t(base + c));
+		if (m_text[base + c] == L' ') {
+			lastSpace = c;
+			advance += glyphAdvance;
+			afterSpaceAdvance = advance;
+			continue;
+		}
+		if (advance + glyphAdvance - rowStartAdvance > m_wrapWidth && c != rowStart && lastSpace >= rowStart) {
+			breakAt(lastSpace + 1, afterSpaceAdvance);
+		}
+		// a word carried over to the next row is broken as well when it does not fit there either,
+		// which keeps every row start a place the scan can restart from
+		if (advance + glyphAdvance - rowStartAdvance > m_wrapWidth && c != rowStart && resync == before) {
+			breakAt(c, advance);
+		}
+		advance += glyphAdvance;
+	}
+	breaks.erase(breaks.begin() + kept, breaks.begin() + (resync < before ? resync + 1 : before));
+	for (size_t i = kept; i < breaks.size(); i++) {
+		breaks[i] += delta;
+	}
+	breaks.insert(breaks.begin() + kept, found.begin(), found.end());
+	const long long rows = (long long)breaks.size() - (long long)before;
+	if (rows != 0) {
+		if (!m_wrapRowsDirty) {
+			m_wrapRows.add(m_lines.toPhysical(line), rows);
+		}
+		m_wrapLayoutChanged = true;
+		m_selectionDirty = true;
+	}
+}
+
+void Label::reflowLines(const size_t& firstLine, const size_t& lastLine) {
+	for (size_t line = firstLine; line <= lastLine && line < m_lines.size(); line++) {
+		if (m_lines[line].Wrap.WrapWidth != m_wrapWidth) {
+			reflowLine(line);
+		}
+	}
+}
+
+// after a reset the rows are counted on the next lookup, not once for every line reflowed meanwhile
+const FenwickTree& Label::getWrapRows() const {
+	if (m_wrapRowsDirty) {
+		std::vector<int> rows(m_lines.capacity(), 0);
+		for (size_t slot = 0; slot < rows.size(); slot++) {
+			if (!m_lines.isGap(slot)) {
+				rows[slot] = int(m_lines.physical(slot).Wrap.Breaks.size()) + 1;
+			}
+		}
+		m_wrapRows.build(rows);
+		m_wrapRowsDirty = false;
+	}
+	return m_wrapRows;
+}
+
+long long Label::getRowsBefore(const size_t& line) const {
+	return getWrapRows().prefixSum(m_lines.toPhysical(line));
+}
+
+size_t Label::findLineByRow(const long long& row) const {
+	return std::min(m_lines.toLogical(getWrapRows().findByPrefix(row)), m_lines.size() - 1);
+}
+
+size_t Label::getRowOf(const size_t& line, const size_t& column) const {
+	if (!m_softWrap || line >= m_lines.size()) {
+		return line;
+	}
+	const std::vector<int>& breaks = m_lines[line].Wrap.Breaks;
+	const size_t rowInLine = size_t(std::upper_bound(breaks.begin(), breaks.end(), int(column)) - breaks.begin());
+	return size_t(getRowsBefore(line)) + rowInLine;
+}
+
+int Label::getRowStartColumn(const size_t& line, const size_t& row) const {
+	if (row == 0 || line >= m_lines.size()) {
+		return 0;
+	}
+	return m_lines[line].Wrap.Breaks[row - 1];
+}
+
+GlyphTexture* Label::findGlyphTexture(const wchar_t& ch) const {
+	if ((unsigned int)ch < 128 && m_glyphTextures[ch] != nullptr) {
+		return m_glyphTextures[ch];
+	}
+	return m_glyphTextures[L'?'];
+}
+
+int Label::getLongestBlock() const {
+	return int(m_lines.toLogical(m_lineWidthTree.getMaxIndex()));
+}
+
+int Label::getLongestBlockWidth() const {
+	return m_lineWidthTree.getMax();
+}
+
+std::pair<int, int> Label::getBlock(const size_t& index) const {
+	return std::make_pair(getLineStart(index), getLineEnd(index));
+}
+
+size_t Label::getBlockCount() const {
+	return m_lines.size();
+}
+
+
+void Label::updateHighlight(const size_t& from) {
+	m_revision++;
+	moveHighlightGap(findHighlightStart(from));
+	while (m_higilightList.size() > m_higilightList.gapStart()) {
+		m_higilightList.eraseAfterGap();
+	}
+	m_highlightShift = 0;
+	tokenize(from, m_text.size(), 0);
 }
 
+// [at, at + erased) of the old text was replaced with inserted characters
+void Label::updateHighlightAround(const size_t& at, const size_t& erased, const size_t& inserted) {
+	m_revision++;
+	// tokenizing restarts at the token the edit is in, the highlights from there on stay after the gap
+	// and those that began inside the edit are dropped right away
+	const size_t from = findTokenStart(at);
+	moveHighlightGap(findHighlightStart(from));
+	size_t covered = at + erased;
+	while (m_higilightList.size() > m_higilightList.gapStart() && size_t(getHighlight(m_higilightList.gapStart()).Start) < at + erased) {
+		covered = std::max(covered, size_t(getHighlight(m_higilightList.gapStart()).getEnd()));
+		m_higilightList.eraseAfterGap();
+	}
+	m_highlightShift += (long long)inserted - (long long)erased;
+	tokenize(from, at + inserted, covered + inserted - erased);
+}
 
-void Label::updateHighlight() {
-	m_higilightList = {};
-	size_t index = 0;
+// once the scan reaches a token boundary past resyncFrom that no old highlight covered either, the old
+// scan was there too, so the old highlights after the gap are still right, they only had to move by the edit
+void Label::tokenize(const size_t& from, const size_t& resyncFrom, const size_t& covered) {
+	size_t index = from;
 	while (index < m_text.size()) {
+		if (index >= resyncFrom && index >= covered && !isAlphabet(m_text[index]) && !isNumber(m_text[index])) {
+			while (m_higilightList.size() > m_higilightList.gapStart() && size_t(getHighlight(m_higilightList.gapStart()).getEnd()) <= index) {
+				m_higilightList.eraseAfterGap();
+			}
+			if (m_higilightList.size() == m_higilightList.gapStart() || size_t(getHighlight(m_higilightList.gapStart()).Start) > index) {
+				return;
+			}
+		}
 		if (isAlphabet(m_text[index])) {
 			size_t start = index;
 			std::wstring keyword = L"";
@@ -356,11 +1297,7 @@ void Label::updateHighlight() {
 			}
 			size_t end = index;
 			if (m_Keywords.find(keyword) != m_Keywords.end()) {
-				SyntaxHighlight s;
-				s.Color = m_Keywords[keyword];
-				s.Start = start;
-				s.End = end;
-				m_higilightList.push_back(s);
+				pushHighlight(start, end, m_Keywords[keyword]);
 			}
 #if TARGET_LANG == TARGET_LANG_TYPE_CPP || TARGET_LANG == TARGET_LANG_TYPE_JAVASCRIPT
 			else {
@@ -370,11 +1307,7 @@ void Label::updateHighlight() {
 				}
 				size_t functionEnd = index;
 				if (m_text[index] == L'(') {
-					SyntaxHighlight s;
-					s.Color = m_FunctionColor;
-					s.Start = functionStart;
-					s.End = functionEnd;
-					m_higilightList.push_back(s);
+					pushHighlight(functionStart, functionEnd, TokenClass::Function);
 				}
 			}
 #endif
@@ -406,11 +1339,7 @@ void Label::updateHighlight() {
 #endif
 			}
 			size_t end = index;
-			SyntaxHighlight s;
-			s.Color = m_NumberLiteralColor;
-			s.Start = start;
-			s.End = end;
-			m_higilightList.push_back(s);
+			pushHighlight(start, end, TokenClass::NumberLiteral);
 			continue;
 		}
 #if TARGET_LANG == TARGET_LANG_TYPE_CPP || TARGET_LANG == TARGET_LANG_TYPE_JAVASCRIPT
@@ -423,11 +1352,7 @@ void Label::updateHighlight() {
 						index++;
 					}
 					size_t end = index;
-					SyntaxHighlight s;
-					s.Color = m_CommentColor;
-					s.Start = start;
-					s.End = end;
-					m_higilightList.push_back(s);
+					pushHighlight(start, end, TokenClass::Comment);
 					continue;
 				}
 				else if (m_text[index + 1] == L'*') {
@@ -438,11 +1363,7 @@ void Label::updateHighlight() {
 					}
 					size_t end = index;
 					end += 2;
-					SyntaxHighlight s;
-					s.Color = m_CommentColor;
-					s.Start = start;
-					s.End = end;
-					m_higilightList.push_back(s);
+					pushHighlight(start, end, TokenClass::Comment);
 					continue;
 				}
 			}
@@ -458,11 +1379,7 @@ void Label::updateHighlight() {
 			}
 			index++;
 			size_t end = index;
-			SyntaxHighlight s;
-			s.Color = m_StringLiteralColor;
-			s.Start = start;
-			s.End = end;
-			m_higilightList.push_back(s);
+			pushHighlight(start, end, TokenClass::StringLiteral);
 			continue;
 		}
 		else if (m_text[index] == L'\'' && index + 1 < m_text.size()) {
@@ -473,11 +1390,7 @@ void Label::updateHighlight() {
 			}
 			index++;
 			size_t end = index;
-			SyntaxHighlight s;
-			s.Color = m_StringLiteralColor;
-			s.Start = start;
-			s.End = end;
-			m_higilightList.push_back(s);
+			pushHighlight(start, end, TokenClass::StringLiteral);
 			continue;
 		}
 		else if (m_text[index] == L'#') {
@@ -491,11 +1404,7 @@ void Label::updateHighlight() {
 			bool parseHeader = m_text[index] == L' ';
 			index++;
 			size_t end = index;
-			SyntaxHighlight s;
-			s.Color = m_PreprocessorColor;
-			s.Start = start;
-			s.End = end;
-			m_higilightList.push_back(s);
+			pushHighlight(start, end, TokenClass::Preprocessor);
 			if (parseHeader && m_text[index] == L'<') {
 				size_t headerStart = index;
 				while (m_text[index] != L'\n' && index < m_text.size()) {
@@ -503,11 +1412,7 @@ void Label::updateHighlight() {
 				}
 				size_t headerEnd = index;
 				if ( headerStart < headerEnd) {
-					SyntaxHighlight ss;
-					ss.Color = m_StringLiteralColor;
-					ss.Start = headerStart;
-					ss.End = headerEnd;
-					m_higilightList.push_back(ss);
+					pushHighlight(headerStart, headerEnd, TokenClass::StringLiteral);
 				}
 			}
 #elif TARGET_LANG == TARGET_LANG_TYPE_PYTHON
@@ -520,111 +1425,204 @@ void Label::updateHighlight() {
 			bool parseHeader = m_text[index] == L' ';
 			index++;
 			size_t end = index;
-			SyntaxHighlight s;
-			s.Color = m_CommentColor;
-			s.Start = start;
-			s.End = end;
-			m_higilightList.push_back(s);
+			pushHighlight(start, end, TokenClass::Comment);
 #endif
 		}
 		else {
 			index++;
 		}
 	}
+	// the scan ran off the end of the text, none of the old highlights is left to keep
+	while (m_higilightList.size() > m_higilightList.gapStart()) {
+		m_higilightList.eraseAfterGap();
+	}
+	m_highlightShift = 0;
 }
 
-const std::wstring& Label::getText() {
+void Label::pushHighlight(const size_t& start, const size_t& end, const TokenClass& token) {
+	size_t from = start;
+	while (from < end) {
+		size_t length = std::min(end - from, size_t(SYNTAX_HIGHLIGHT_MAX_LENGTH));
+		SyntaxHighlight s;
+		s.Start = (unsigned int)from;
+		s.Length = (unsigned short)length;
+		s.Token = token;
+		m_higilightList.insertAtGap(s);
+		from += length;
+	}
+}
+
+// the first highlight that starts at index or later
+size_t Label::findHighlightStart(const size_t& index) const {
+	size_t low = 0;
+	size_t high = m_higilightList.size();
+	while (low < high) {
+		const size_t middle = low + (high - low) / 2;
+		if (size_t(getHighlight(middle).Start) < index) {
+			low = middle + 1;
+		}
+		else {
+			high = middle;
+		}
+	}
+	return low;
+}
+
+// the last place at or before index the tokenizer surely started a token at, which only the text before index decides:
+// the start of the highlighted token index is in, or the first column after a character no token took along
+size_t Label::findTokenStart(const size_t& index) const {
+	size_t highlight = findHighlightStart(index);
+	for (size_t position = index; position > 0; position--) {
+		const size_t previous = position - 1;
+		while (highlight > 0 && size_t(getHighlight(highlight - 1).Start) > previous) {
+			highlight--;
+		}
+		if (highlight > 0 && size_t(getHighlight(highlight - 1).getEnd()) > previous) {
+			// a long token was split into several highlights, and a header name is part of its directive
+			size_t first = highlight - 1;
+			while (first > 0) {
+				const SyntaxHighlight before = getHighlight(first - 1);
+				const SyntaxHighlight current = getHighlight(first);
+				const bool continued = before.Token == current.Token && before.Length == SYNTAX_HIGHLIGHT_MAX_LENGTH;
+				const bool header = before.Token == TokenClass::Preprocessor && current.Token == TokenClass::StringLiteral;
+				if (before.getEnd() != current.Start || !(continued || header)) {
+					break;
+				}
+				first--;
+			}
+			return size_t(getHighlight(first).Start);
+		}
+		// a slash or a quote is only left alone because of the character after it, which the edit may have changed
+		const wchar_t ch = m_text[previous];
+		if (!isAlphabet(ch) && !isNumber(ch) && ch != L'/' && ch != L'"' && ch != L'\'') {
+			return position;
+		}
+	}
+	return 0;
+}
+
+SyntaxHighlight Label::getHighlight(const size_t& index) const {
+	SyntaxHighlight s = m_higilightList[index];
+	if (index >= m_higilightList.gapStart()) {
+		s.Start = (unsigned int)((long long)s.Start + m_highlightShift);
+	}
+	return s;
+}
+
+void Label::moveHighlightGap(const size_t& index) {
+	m_higilightList.moveGap(index, [this](SyntaxHighlight& s, const size_t& from, const size_t& to) {
+		const long long shift = to < from ? m_highlightShift : -m_highlightShift;
+		s.Start = (unsigned int)((long long)s.Start + shift);
+	});
+}
+
+const Utf8Text& Label::getText() {
 	return m_text;
 }
 
+const unsigned long long& Label::getRevision() const {
+	return m_revision;
+}
+
+void Label::resetChangeTracking() {
+	m_text.resetChangeTracking();
+}
+
+void Label::limitUnchanged(const size_t& prefix, const size_t& suffix) {
+	m_text.limitUnchanged(prefix, suffix);
+}
+
 void Label::updateSelection(const size_t& from, const size_t& to) {
 	assert(0 <= from && from <= m_text.size());
 	assert(0 <= to && to <= m_text.size());
-	int activatedBlockStart = getBelongBlock(from);
-	int activatedBlockEnd = getBelongBlock(to);
-	if (activatedBlockStart == -1 || activatedBlockEnd == -1) {
-		return;
+	m_selectionFrom = from;
+	m_selectionTo = to;
+	m_selectionDirty = true;
+}
+
+void Label::setExtraSelections(const std::vector<std::pair<size_t, size_t>>& ranges) {
+	m_extraSelections = ranges;
+	m_selectionDirty = true;
+}
+
+void Label::rebuildSelection(const size_t& firstVisibleLine, const size_t& lastVisibleLine) {
+	for (size_t i = 0; i < m_usedSelectionRects && i < m_selectionList.size(); i++) {
+		m_selectionList[i]->setSize(vec2i(0, m_selectionList[i]->getSize().y));
 	}
-	if (m_selectionList.size() < activatedBlockEnd) {
+	if (m_lines.empty()) {
 		return;
 	}
-	for (auto& cr : m_selectionList) {
-		cr->setSize(vec2i(0, cr->getSize().y));
+	size_t used = 0;
+	selectRange(used, m_selectionFrom, m_selectionTo, firstVisibleLine, lastVisibleLine);
+	if (!m_extraSelections.empty()) {
+		// extra selections are sorted and disjoint, so only the ones overlapping the visible lines are walked
+		const size_t visibleFrom = size_t(getLineStart(firstVisibleLine));
+		const size_t visibleTo = size_t(getLineEnd(lastVisibleLine));
+		auto it = std::partition_point(m_extraSelections.begin(), m_extraSelections.end(), [&visibleFrom](const std::pair<size_t, size_t>& range) {
+			return range.second < visibleFrom;
+		});
+		for (; it != m_extraSelections.end() && it->first <= visibleTo; it++) {
+			selectRange(used, it->first, it->second, firstVisibleLine, lastVisibleLine);
+		}
 	}
-	if (m_blockList.empty()) {
+	m_usedSelectionRects = used;
+}
+
+void Label::selectRange(size_t& used, const size_t& from, const size_t& to, const size_t& firstVisibleLine, const size_t& lastVisibleLine) {
+	const size_t clampedFrom = std::min(from, m_text.size());
+	const size_t clampedTo = std::min(to, m_text.size());
+	int activatedBlockStart = getBelongBlock(clampedFrom);
+	int activatedBlockEnd = getBelongBlock(clampedTo);
+	if (activatedBlockStart == -1 || activatedBlockEnd == -1) {
 		return;
 	}
 	{
-		int firstStart = from;
-		int firstEnd = from;
-
-		while (firstEnd < m_blockList[activatedBlockStart].second) {
-			firstEnd++;
-		}
-		if (firstEnd > to) {
-			firstEnd = to;
-		}
-		int posX = 0;
-		int posY = 10 + FONT_SIZE * (activatedBlockStart);
-		int sizeX = 0;
-		const int sizeY = FONT_SIZE;
-		for (int index = 0; index < firstStart; index++) {
-			if (m_glyphTextures[index].has_value() && m_glyphTextures[index].value() != nullptr) {
-				posX += (m_glyphTextures[index].value()->getAdvanceX() >> 6);
-			}
-			else {
-				posX = 0;
-			}
-		}
-		for (int index = firstStart; index < firstEnd; index++) {
-			if (m_glyphTextures[index].has_value() && m_glyphTextures[index].value() != nullptr) {
-				sizeX += (m_glyphTextures[index].value()->getAdvanceX() >> 6);
-			}
-		}
-
-		m_selectionList[0]->setSize(vec2i(sizeX, sizeY));
-		m_selectionList[0]->setPosition(vec2(m_position.x + m_selectionList[0]->getSize().x / 2.0f + posX, posY));
+		const int lineStart = getLineStart(activatedBlockStart);
+		const int firstEnd = std::min(getLineEnd(activatedBlockStart), int(clampedTo));
+		selectColumns(used, activatedBlockStart, clampedFrom - lineStart, firstEnd - lineStart);
 	}
-	{
-		for (int i = activatedBlockStart + 1; i < activatedBlockEnd; i++) {
-			int middleStart = m_blockList[i].first;
-			int middleEnd = m_blockList[i].second;
-			int posX = 0;
-			int posY = 10 + FONT_SIZE * i;
-			int sizeX = 0;
-			const int sizeY = FONT_SIZE;
-
-			for (int index = middleStart; index < middleEnd; index++) {
-				if (m_glyphTextures[index].has_value() && m_glyphTextures[index].value() != nullptr) {
-					sizeX += (m_glyphTextures[index].value()->getAdvanceX() >> 6);
-				}
-			}
-
-			m_selectionList[i]->setSize(vec2i(sizeX, sizeY));
-			m_selectionList[i]->setPosition(vec2(m_position.x + m_selectionList[i]->getSize().x / 2.0f + posX, posY));
-		}
+	const int middleFirst = std::max(activatedBlockStart + 1, int(firstVisibleLine));
+	const int middleLast = std::min(activatedBlockEnd - 1, int(lastVisibleLine));
+	for (int i = middleFirst; i <= middleLast; i++) {
+		selectColumns(used, i, 0, getLineEnd(i) - getLineStart(i));
 	}
-	if (activatedBlockStart != activatedBlockEnd && m_blockList.size() > activatedBlockEnd){
-		int lastStart = to;
-		int lastEnd = to;
-		while (lastStart > m_blockList[activatedBlockEnd].first) {
-			lastStart--;
-		}
-
-		int posX = 0;
-		int posY = 10 + FONT_SIZE * (activatedBlockEnd);
-		int sizeX = 0;
-		const int sizeY = FONT_SIZE;
+	if (activatedBlockStart != activatedBlockEnd && m_lines.size() > activatedBlockEnd) {
+		selectColumns(used, activatedBlockEnd, 0, clampedTo - getLineStart(activatedBlockEnd));
+	}
+}
 
-		for (int index = lastStart; index < lastEnd; index++) {
-			if (m_glyphTextures[index].has_value() && m_glyphTextures[index].value() != nullptr) {
-				sizeX += (m_glyphTextures[index].value()->getAdvanceX() >> 6);
-			}
+void Label::selectColumns(size_t& used, const size_t& line, const size_t& fromColumn, const size_t& toColumn) {
+	if (!m_softWrap) {
+		const int posX = getCaretAdvance(line, fromColumn);
+		setSelectionRect(used, line, posX, getCaretAdvance(line, toColumn) - posX);
+		return;
+	}
+	const std::vector<int>& breaks = m_lines[line].Wrap.Breaks;
+	const size_t length = size_t(getLineEnd(line) - getLineStart(line));
+	const size_t rowBase = size_t(getRowsBefore(line));
+	size_t row = size_t(std::upper_bound(breaks.begin(), breaks.end(), int(fromColumn)) - breaks.begin());
+	while (true) {
+		const size_t rowStart = size_t(getRowStartColumn(line, row));
+		const size_t rowEnd = row < breaks.size() ? size_t(breaks[row]) : length;
+		const size_t segmentFrom = std::max(fromColumn, rowStart);
+		const size_t segmentTo = std::min(toColumn, rowEnd);
+		const int rowOrigin = getCaretAdvance(line, rowStart);
+		const int posX = getCaretAdvance(line, segmentFrom) - rowOrigin;
+		setSelectionRect(used, rowBase + row, posX, std::max(getCaretAdvance(line, segmentTo) - rowOrigin - posX, 0));
+		if (rowEnd >= toColumn || row >= breaks.size()) {
+			break;
 		}
+		row++;
+	}
+}
 
-		m_selectionList[m_selectionList.size()-1]->setSize(vec2i(sizeX, sizeY));
-		m_selectionList[m_selectionList.size()-1]->setPosition(vec2(m_position.x + m_selectionList[m_selectionList.size()-1]->getSize().x / 2.0f + posX, posY));
+void Label::setSelectionRect(size_t& used, const size_t& row, const int& x, const int& width) {
+	if (used >= m_selectionList.size()) {
+		addSelectionSection();
 	}
+	ColorRect* rect = m_selectionList[used++];
+	rect->setSize(vec2i(width, FONT_SIZE));
+	rect->setPosition(vec2(m_position.x + rect->getSize().x / 2.0f + x, 10 + FONT_SIZE * float(row)));
 }
 
 void Label::addSelectionSection() {
@@ -658,4 +1656,66 @@ void Label::eraseSelectionSection(const int& at) {
 
 void Label::toggleRainbow() {
 	m_enableRainbow = !m_enableRainbow;
-}
\ No newline at end of file
+}
+
+void Label::applyTheme() {
+	const Theme& theme = getThemes()[m_themeIndex];
+	m_shader->use();
+	m_shader->setVec4Array("Palette", theme.Palette, PALETTE_SIZE);
+	m_gpuTextLayout->setPalette(theme.Palette);
+}
+
+void Label::cycleTheme() {
+	m_themeIndex = (m_themeIndex + 1) % getThemes().size();
+	applyTheme();
+}
+
+const Theme& Label::getTheme() const {
+	return getThemes()[m_themeIndex];
+}
+
+void Label::toggleGpuTextLayout() {
+	m_useGpuTextLayout = !m_useGpuTextLayout;
+	m_gpuTextLayout->clearGlyphs();
+	m_gpuLineCache.clear();
+}
+
+void Label::toggleSoftWrap() {
+	m_softWrap = !m_softWrap;
+	if (m_softWrap) {
+		resetWrappedLines();
+	}
+	else {
+		for (size_t line = 0; line < m_lines.size(); line++) {
+			m_lines[line].Wrap = WrappedLine{};
+		}
+		m_wrapRows.build({});
+		m_wrapRowsDirty = false;
+		m_wrapLayoutChanged = true;
+	}
+}
+
+const bool& Label::isSoftWrap() const {
+	return m_softWrap;
+}
+
+void Label::setWrapWidth(const int& width) {
+	if (width == m_wrapWidth) {
+		return;
+	}
+	m_wrapWidth = width;
+	m_reflowCursor = 0;
+	if (!m_softWrap) {
+		return;
+	}
+	size_t firstLine = 0;
+	size_t lastLine = 0;
+	getVisibleLineRange(firstLine, lastLine);
+	reflowLines(firstLine, lastLine);
+}
+
+bool Label::consumeWrapLayoutChanged() {
+	const bool changed = m_wrapLayoutChanged;
+	m_wrapLayoutChanged = false;
+	return changed;
+}
@@ -0,0 +1,197 @@
+#include "large_file_view.h"
+#include "text_codec.h"
+
+#include <algorithm>
+#include <cstring>
+
+#define LARGE_FILE_VIEW_INDEX_STRIDE 1024
+#define LARGE_FILE_VIEW_SCAN_BATCH (8 << 20)
+#define LARGE_FILE_VIEW_MAX_WINDOW_BYTES (16 << 20)
+#define LARGE_FILE_VIEW_READ_CHUNK (256 << 10)
+
+LargeFileView::LargeFileView(const std::string& _path) : m_path(_path) {
+	m_file = new FileReader(_path);
+	m_fileSize = m_file->getSize();
+	if (!m_file->isOpen() || m_fileSize == 0) {
+		m_finished = true;
+		return;
+	}
+	m_thread = std::thread(&LargeFileView::work, this);
+}
+
+LargeFileView::~LargeFileView() {
+	m_cancelled = true;
+	if (m_thread.joinable()) {
+		m_thread.join();
+	}
+	delete m_file;
+}
+
+void LargeFileView::work() {
+	const unsigned long long size = m_fileSize;
+	std::vector<char> buffer(LARGE_FILE_VIEW_SCAN_BATCH);
+	std::vector<unsigned long long> found;
+	// picks up where the last scan stopped when the file grew
+	size_t newlines = m_lineCount - 1;
+	unsigned long long offset = m_scannedBytes;
+	while (offset < size && !m_cancelled) {
+		const size_t read = m_file->readAt(offset, buffer.data(), size_t(std::min<unsigned long long>(size - offset, buffer.size())));
+		// the file shrank since it was measured, refresh() starts over once it is followed again
+		if (read == 0) {
+			break;
+		}
+		size_t pos = 0;
+		while (pos < read) {
+			const void* newline = memchr(buffer.data() + pos, '\n', read - pos);
+			if (newline == nullptr) {
+				break;
+			}
+			pos = size_t(static_cast<const char*>(newline) - buffer.data()) + 1;
+			newlines++;
+			if (newlines % LARGE_FILE_VIEW_INDEX_STRIDE == 0) {
+				found.push_back(offset + pos);
+			}
+		}
+		offset += read;
+		// checkpoints are published a batch at a time so readers rarely wait on the lock
+		{
+			std::lock_guard<std::mutex> lock(m_mutex);
+			m_checkpoints.insert(m_checkpoints.end(), found.begin(), found.end());
+		}
+		found.clear();
+		m_lineCount = newlines + 1;
+		m_scannedBytes = offset;
+	}
+	m_finished = true;
+}
+
+unsigned long long LargeFileView::skipLines(unsigned long long _offset, size_t _count) const {
+	std::vector<char> buffer(LARGE_FILE_VIEW_READ_CHUNK);
+	while (_count > 0) {
+		const size_t read = m_file->readAt(_offset, buffer.data(), buffer.size());
+		if (read == 0) {
+			break;
+		}
+		size_t pos = 0;
+		while (_count > 0 && pos < read) {
+			const void* newline = memchr(buffer.data() + pos, '\n', read - pos);
+			if (newline == nullptr) {
+				pos = read;
+				break;
+			}
+			pos = size_t(static_cast<const char*>(newline) - buffer.data()) + 1;
+			_count--;
+		}
+		_offset += pos;
+	}
+	return _offset;
+}
+
+unsigned long long LargeFileView::findLineStart(const size_t& _line) const {
+	size_t checkpoint = 0;
+	unsigned long long offset = 0;
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+		checkpoint = std::min(_line / LARGE_FILE_VIEW_INDEX_STRIDE, m_checkpoints.size() - 1);
+		offset = m_checkpoints[checkpoint];
+	}
+	// lines past what the worker has indexed so far are simply walked to
+	return skipLines(offset, _line - checkpoint * LARGE_FILE_VIEW_INDEX_STRIDE);
+}
+
+const bool& LargeFileView::isOpen() const {
+	return m_file->isOpen();
+}
+
+bool LargeFileView::isIndexed() const {
+	return m_finished;
+}
+
+float LargeFileView::getProgress() const {
+	if (m_fileSize == 0) {
+		return 1.0f;
+	}
+	return m_finished ? 1.0f : float(double(m_scannedBytes) / double(m_fileSize));
+}
+
+size_t LargeFileView::getLineCount() const {
+	return m_lineCount;
+}
+
+bool LargeFileView::refresh() {
+	if (!m_finished) {
+		return false;
+	}
+	// a rotated log is a new file under the same name, so it is opened again rather than measured through the old handle
+	FileReader* file = new FileReader(m_path);
+	const unsigned long long size = file->getSize();
+	if (!file->isOpen() || size == m_fileSize) {
+		delete file;
+		return false;
+	}
+	if (m_thread.joinable()) {
+		m_thread.join();
+	}
+	if (size < m_scannedBytes) {
+		// the file was truncated or replaced, none of the index can be trusted
+		std::lock_guard<std::mutex> lock(m_mutex);
+		m_checkpoints.assign(1, 0);
+		m_lineCount = 1;
+		m_scannedBytes = 0;
+	}
+	delete m_file;
+	m_file = file;
+	m_fileSize = size;
+	m_finished = false;
+	m_thread = std::thread(&LargeFileView::work, this);
+	return true;
+}
+
+std::string LargeFileView::getLines(const size_t& _first, const size_t& _count, size_t& _loadedLines) const {
+	_loadedLines = 0;
+	std::string result;
+	if (m_fileSize == 0 || _count == 0) {
+		return result;
+	}
+	const unsigned long long start = findLineStart(_first);
+	// read on until the window holds _count lines, the file ends or a pathological line fills it
+	std::string bytes;
+	size_t searched = 0;
+	bool ended = false;
+	while (true) {
+		const void* newline = (searched < bytes.size() ? memchr(bytes.data() + searched, '\n', bytes.size() - searched) : nullptr);
+		if (newline != nullptr) {
+			const size_t end = size_t(static_cast<const char*>(newline) - bytes.data());
+			_loadedLines++;
+			if (_loadedLines == _count) {
+				bytes.resize(end);
+				break;
+			}
+			searched = end + 1;
+			continue;
+		}
+		searched = bytes.size();
+		if (ended || bytes.size() >= LARGE_FILE_VIEW_MAX_WINDOW_BYTES) {
+			_loadedLines++;
+			break;
+		}
+		const size_t old = bytes.size();
+		bytes.resize(old + LARGE_FILE_VIEW_READ_CHUNK);
+		const size_t read = m_file->readAt(start + old, &bytes[old], LARGE_FILE_VIEW_READ_CHUNK);
+		bytes.resize(old + read);
+		ended = read < LARGE_FILE_VIEW_READ_CHUNK;
+	}
+	if (bytes.size() > LARGE_FILE_VIEW_MAX_WINDOW_BYTES) {
+		// a pathological line is cut rather than copied whole, at a character boundary
+		size_t end = LARGE_FILE_VIEW_MAX_WINDOW_BYTES;
+		while (end > 0 && (static_cast<unsigned char>(bytes[end]) & 0xC0) == 0x80) {
+			end--;
+		}
+		bytes.resize(end);
+	}
+	if (!bytes.empty() && bytes.back() == '\r') {
+		bytes.pop_back();
+	}
+	normalizeUtf8(reinterpret_cast<const unsigned char*>(bytes.data()), bytes.size(), result, start == 0);
+	return result;
+}
@@ -0,0 +1,105 @@
+#include "latency_tracker.h"
+#include "macros.h"
+
+#include <algorithm>
+#include <cstdio>
+
+LatencyStats LatencyTracker::computeStats(std::vector<double>& _values) {
+	LatencyStats stats;
+	stats.Count = _values.size();
+	if (_values.empty()) {
+		return stats;
+	}
+	std::sort(_values.begin(), _values.end());
+	stats.Min = _values.front();
+	stats.Max = _values.back();
+	stats.Median = _values[_values.size() / 2];
+	stats.P99 = _values[std::min(_values.size() - 1, _values.size() * 99 / 100)];
+	return stats;
+}
+
+void LatencyTracker::markInput(const double& _time) {
+	m_pendingInputs.push_back(_time);
+}
+
+bool LatencyTracker::hasPendingInput() const {
+	return !m_pendingInputs.empty();
+}
+
+void LatencyTracker::endFrame(const double& _submitTime, const double& _completeTime) {
+	for (const double& input : m_pendingInputs) {
+		const LatencySample sample{ input, _submitTime, _completeTime };
+		if (m_samples.size() < LATENCY_SAMPLE_COUNT) {
+			m_samples.push_back(sample);
+		}
+		else {
+			m_samples[m_nextSample] = sample;
+		}
+		m_nextSample = (m_nextSample + 1) % LATENCY_SAMPLE_COUNT;
+		m_totalSamples++;
+	}
+	m_pendingInputs.clear();
+}
+
+LatencyStats LatencyTracker::getSubmitStats() const {
+	std::vector<double> values;
+	values.reserve(m_samples.size());
+	for (const auto& s : m_samples) {
+		values.push_back(s.SubmitTime - s.InputTime);
+	}
+	return computeStats(values);
+}
+
+LatencyStats LatencyTracker::getCompleteStats() const {
+	std::vector<double> values;
+	values.reserve(m_samples.size());
+	for (const auto& s : m_samples) {
+		if (s.CompleteTime >= 0.0) {
+			values.push_back(s.CompleteTime - s.InputTime);
+		}
+	}
+	return computeStats(values);
+}
+
+std::wstring LatencyTracker::getSummary() const {
+	const LatencyStats submit = getSubmitStats();
+	const LatencyStats complete = getCompleteStats();
+	wchar_t buffer[256];
+	swprintf(buffer, 256, L"swap  min %.1f  med %.1f  p99 %.1f ms  (%zu)",
+		submit.Min * 1000.0, submit.Median * 1000.0, submit.P99 * 1000.0, submit.Count);
+	std::wstring summary = buffer;
+	if (complete.Count > 0) {
+		swprintf(buffer, 256, L"\ngpu   min %.1f  med %.1f  p99 %.1f ms  (%zu)",
+			complete.Min * 1000.0, complete.Median * 1000.0, complete.P99 * 1000.0, complete.Count);
+		summary += buffer;
+	}
+	return summary;
+}
+
+bool LatencyTracker::dumpReport(const std::string& _path) const {
+	FILE* file = fopen(_path.c_str(), "w");
+	if (file == nullptr) {
+		PUSH_ERROR("Cannot Write Latency Report");
+		return false;
+	}
+	const LatencyStats stats[2] = { getSubmitStats(), getCompleteStats() };
+	const char* names[2] = { "input_to_swap", "input_to_gpu_complete" };
+	fprintf(file, "# %llu samples recorded, last %zu kept\n", m_totalSamples, m_samples.size());
+	for (int i = 0; i < 2; i++) {
+		fprintf(file, "# %s count=%zu min=%.3fms median=%.3fms p99=%.3fms max=%.3fms\n", names[i], stats[i].Count,
+			stats[i].Min * 1000.0, stats[i].Median * 1000.0, stats[i].P99 * 1000.0, stats[i].Max * 1000.0);
+	}
+	fprintf(file, "input_time,swap_ms,gpu_complete_ms\n");
+	// oldest first
+	const size_t start = m_samples.size() < LATENCY_SAMPLE_COUNT ? 0 : m_nextSample;
+	for (size_t i = 0; i < m_samples.size(); i++) {
+		const LatencySample& s = m_samples[(start + i) % m_samples.size()];
+		fprintf(file, "%.6f,%.3f,", s.InputTime, (s.SubmitTime - s.InputTime) * 1000.0);
+		if (s.CompleteTime >= 0.0) {
+			fprintf(file, "%.3f", (s.CompleteTime - s.InputTime) * 1000.0);
+		}
+		fprintf(file, "\n");
+	}
+	fclose(file);
+	return true;
+}
@@ -0,0 +1,50 @@
+#include "max_segment_tree.h"
+
+#include <algorithm>
+#include <climits>
+
+void MaxSegmentTree::build(const std::vector<int>& _values) {
+	m_size = _values.size();
+	m_leafCount = 1;
+	while (m_leafCount < m_size) {
+		m_leafCount <<= 1;
+	}
+	m_nodes.assign(m_leafCount * 2, INT_MIN);
+	std::copy(_values.begin(), _values.end(), m_nodes.begin() + m_leafCount);
+	for (size_t i = m_leafCount - 1; i > 0; i--) {
+		m_nodes[i] = std::max(m_nodes[i * 2], m_nodes[i * 2 + 1]);
+	}
+}
+
+void MaxSegmentTree::update(const size_t& _index, const int& _value) {
+	if (_index >= m_size) {
+		return;
+	}
+	size_t i = _index + m_leafCount;
+	m_nodes[i] = _value;
+	for (i >>= 1; i > 0; i >>= 1) {
+		m_nodes[i] = std::max(m_nodes[i * 2], m_nodes[i * 2 + 1]);
+	}
+}
+
+int MaxSegmentTree::getMax() const {
+	if (m_size == 0) {
+		return 0;
+	}
+	return m_nodes[1];
+}
+
+size_t MaxSegmentTree::getMaxIndex() const {
+	if (m_size == 0) {
+		return 0;
+	}
+	size_t i = 1;
+	while (i < m_leafCount) {
+		i = (m_nodes[i * 2] == m_nodes[i]) ? i * 2 : i * 2 + 1;
+	}
+	return i - m_leafCount;
+}
+
+const size_t& MaxSegmentTree::size() const {
+	return m_size;
+}
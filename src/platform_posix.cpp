@@ -0,0 +1,280 @@
+#include "platform.h"
+#include "macros.h"
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <climits>
+#include <cstdlib>
+#include <cerrno>
+#include <algorithm>
+#ifdef __linux__
+#include <sys/inotify.h>
+#endif
+
+MappedFile::MappedFile(const std::string& _path) {
+	const int fd = open(_path.c_str(), O_RDONLY | O_CLOEXEC);
+	if (fd < 0) {
+		return;
+	}
+	struct stat info;
+	if (fstat(fd, &info) != 0) {
+		close(fd);
+		return;
+	}
+	m_open = true;
+	m_size = size_t(info.st_size);
+	if (m_size == 0) {
+		close(fd);
+		return;
+	}
+	void* mapping = mmap(nullptr, m_size, PROT_READ, MAP_PRIVATE, fd, 0);
+	close(fd);
+	if (mapping == MAP_FAILED) {
+		PUSH_ERROR("Cannot Map File");
+		m_open = false;
+		m_size = 0;
+		return;
+	}
+	// the file is decoded front to back exactly once
+	madvise(mapping, m_size, MADV_SEQUENTIAL);
+	m_data = static_cast<const unsigned char*>(mapping);
+}
+
+MappedFile::~MappedFile() {
+	if (m_data != nullptr) {
+		munmap(const_cast<unsigned char*>(m_data), m_size);
+	}
+}
+
+const bool& MappedFile::isOpen() const {
+	return m_open;
+}
+
+const unsigned char* MappedFile::getData() const {
+	return m_data;
+}
+
+const size_t& MappedFile::getSize() const {
+	return m_size;
+}
+
+FileReader::FileReader(const std::string& _path) {
+	m_descriptor = open(_path.c_str(), O_RDONLY | O_CLOEXEC);
+	m_open = m_descriptor >= 0;
+}
+
+FileReader::~FileReader() {
+	if (m_descriptor >= 0) {
+		close(m_descriptor);
+	}
+}
+
+const bool& FileReader::isOpen() const {
+	return m_open;
+}
+
+unsigned long long FileReader::getSize() const {
+	struct stat info;
+	if (!m_open || fstat(m_descriptor, &info) != 0) {
+		return 0;
+	}
+	return (unsigned long long)info.st_size;
+}
+
+size_t FileReader::readAt(const unsigned long long& _offset, void* _buffer, const size_t& _size) const {
+	if (!m_open) {
+		return 0;
+	}
+	size_t total = 0;
+	while (total < _size) {
+		const ssize_t read = pread(m_descriptor, static_cast<char*>(_buffer) + total, _size - total, off_t(_offset + total));
+		if (read < 0 && errno == EINTR) {
+			continue;
+		}
+		if (read <= 0) {
+			break;
+		}
+		total += size_t(read);
+	}
+	return total;
+}
+
+FileWatcher::FileWatcher(const std::string& _path) : m_path(_path) {
+#ifdef __linux__
+	m_descriptor = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+	if (m_descriptor < 0) {
+		PUSH_ERROR("Cannot Watch File");
+		return;
+	}
+	if (inotify_add_watch(m_descriptor, _path.c_str(), IN_MODIFY | IN_CLOSE_WRITE | IN_ATTRIB) < 0) {
+		PUSH_ERROR("Cannot Watch File");
+		close(m_descriptor);
+		m_descriptor = -1;
+		return;
+	}
+#endif
+	m_open = true;
+	consumeChange();
+}
+
+FileWatcher::~FileWatcher() {
+	if (m_descriptor >= 0) {
+		close(m_descriptor);
+	}
+}
+
+const bool& FileWatcher::isOpen() const {
+	return m_open;
+}
+
+bool FileWatcher::consumeChange() {
+	if (!m_open) {
+		return false;
+	}
+#ifdef __linux__
+	// a burst of writes queues many events, they all collapse into one change
+	alignas(struct inotify_event) char buffer[4096];
+	bool changed = false;
+	while (read(m_descriptor, buffer, sizeof(buffer)) > 0) {
+		changed = true;
+	}
+	return changed;
+#else
+	struct stat info;
+	if (stat(m_path.c_str(), &info) != 0) {
+		return false;
+	}
+	const long long size = (long long)info.st_size;
+	const long long modified = (long long)info.st_mtime;
+	const bool changed = size != m_lastSize || modified != m_lastModified;
+	m_lastSize = size;
+	m_lastModified = modified;
+	return changed;
+#endif
+}
+
+static bool writeAll(const int& _fd, const char* _data, size_t _size) {
+	while (_size > 0) {
+		const ssize_t count = write(_fd, _data, _size);
+		if (count < 0 && errno == EINTR) {
+			continue;
+		}
+		if (count <= 0) {
+			return false;
+		}
+		_data += count;
+		_size -= size_t(count);
+	}
+	return true;
+}
+
+static bool copyRange(const int& _from, const int& _to, size_t _offset, size_t _size) {
+#ifdef __linux__
+	// stays inside the kernel, and shares the blocks outright on file systems with reflinks
+	while (_size > 0) {
+		off_t offset = off_t(_offset);
+		const ssize_t count = copy_file_range(_from, &offset, _to, nullptr, _size, 0);
+		if (count < 0 && errno == EINTR) {
+			continue;
+		}
+		if (count <= 0) {
+			break;
+		}
+		_offset += size_t(count);
+		_size -= size_t(count);
+	}
+	if (_size == 0) {
+		return true;
+	}
+#endif
+	// other systems, or file systems copy_file_range does not support
+	static thread_local char buffer[1 << 16];
+	while (_size > 0) {
+		const ssize_t count = pread(_from, buffer, std::min(_size, sizeof(buffer)), off_t(_offset));
+		if (count < 0 && errno == EINTR) {
+			continue;
+		}
+		if (count <= 0 || !writeAll(_to, buffer, size_t(count))) {
+			return false;
+		}
+		_offset += size_t(count);
+		_size -= size_t(count);
+	}
+	return true;
+}
+
+bool writeFileAtomically(const std::string& _path, const std::vector<FilePiece>& _pieces, const std::string& _sourcePath) {
+	// write through a symbolic link instead of replacing it, and keep the permissions of the old file
+	char resolved[PATH_MAX];
+	const std::string path = (realpath(_path.c_str(), resolved) != nullptr ? std::string(resolved) : _path);
+	mode_t mode = 0644;
+	struct stat info;
+	if (stat(path.c_str(), &info) == 0) {
+		mode = info.st_mode & 07777;
+	}
+	const std::string temporary = path + ".saving";
+	const int fd = open(temporary.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, mode);
+	if (fd < 0) {
+		PUSH_ERROR("Cannot Create File");
+		return false;
+	}
+	const int source = (_sourcePath.empty() ? -1 : open(_sourcePath.c_str(), O_RDONLY | O_CLOEXEC));
+	bool written = true;
+	for (const FilePiece& piece : _pieces) {
+		if (piece.Data != nullptr) {
+			written = writeAll(fd, piece.Data, piece.Size);
+		}
+		else {
+			written = source >= 0 && copyRange(source, fd, piece.SourceOffset, piece.Size);
+		}
+		if (!written) {
+			break;
+		}
+	}
+	if (source >= 0) {
+		close(source);
+	}
+	const bool flushed = written && fsync(fd) == 0;
+	close(fd);
+	if (!flushed || rename(temporary.c_str(), path.c_str()) != 0) {
+		PUSH_ERROR("Cannot Write File");
+		unlink(temporary.c_str());
+		return false;
+	}
+	// the rename itself is only durable once the directory entry is on disk
+	const std::string::size_type pos = path.find_last_of('/');
+	const std::string directory = (pos == std::string::npos ? "." : (pos == 0 ? "/" : path.substr(0, pos)));
+	const int directoryFd = open(directory.c_str(), O_RDONLY | O_CLOEXEC);
+	if (directoryFd >= 0) {
+		fsync(directoryFd);
+		close(directoryFd);
+	}
+	return true;
+}
+
+bool appendFileDurably(const std::string& _path, const std::string& _bytes) {
+	const int fd = open(_path.c_str(), O_WRONLY | O_CREAT | O_APPEND | O_CLOEXEC, 0644);
+	if (fd < 0) {
+		return false;
+	}
+	// only the data has to be durable, the size update comes with it and the rest of the metadata does not matter
+#ifdef __APPLE__
+	const bool written = writeAll(fd, _bytes.data(), _bytes.size()) && fsync(fd) == 0;
+#else
+	const bool written = writeAll(fd, _bytes.data(), _bytes.size()) && fdatasync(fd) == 0;
+#endif
+	close(fd);
+	return written;
+}
+
+std::string getExecutableDirectory() {
+	char buffer[PATH_MAX];
+	const ssize_t length = readlink("/proc/self/exe", buffer, sizeof(buffer) - 1);
+	if (length <= 0) {
+		return ".";
+	}
+	const std::string path(buffer, size_t(length));
+	return path.substr(0, path.find_last_of('/'));
+}
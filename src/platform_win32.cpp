@@ -0,0 +1,218 @@
+#include "platform.h"
+#include "macros.h"
+
+#include <Windows.h>
+#include <cstdint>
+
+MappedFile::MappedFile(const std::string& _path) {
+	HANDLE file = CreateFileA(_path.c_str(), GENERIC_READ, FILE_SHARE_READ | FILE_SHARE_WRITE, NULL, OPEN_EXISTING, FILE_FLAG_SEQUENTIAL_SCAN, NULL);
+	if (file == INVALID_HANDLE_VALUE) {
+		return;
+	}
+	LARGE_INTEGER size;
+	if (!GetFileSizeEx(file, &size)) {
+		CloseHandle(file);
+		return;
+	}
+	// a 32-bit build cannot address the view of a file past 4 GB, and size_t would silently truncate its size
+	if ((unsigned long long)size.QuadPart > (unsigned long long)SIZE_MAX) {
+		PUSH_ERROR("File Too Large To Map");
+		CloseHandle(file);
+		return;
+	}
+	m_open = true;
+	m_fileHandle = file;
+	m_size = size_t(size.QuadPart);
+	if (m_size == 0) {
+		return;
+	}
+	HANDLE mapping = CreateFileMappingA(file, NULL, PAGE_READONLY, 0, 0, NULL);
+	if (mapping == NULL) {
+		PUSH_ERROR("Cannot Map File");
+		m_open = false;
+		m_size = 0;
+		return;
+	}
+	m_mappingHandle = mapping;
+	m_data = static_cast<const unsigned char*>(MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0));
+	if (m_data == nullptr) {
+		PUSH_ERROR("Cannot Map File");
+		m_open = false;
+		m_size = 0;
+	}
+}
+
+MappedFile::~MappedFile() {
+	if (m_data != nullptr) {
+		UnmapViewOfFile(m_data);
+	}
+	if (m_mappingHandle != nullptr) {
+		CloseHandle(m_mappingHandle);
+	}
+	if (m_fileHandle != nullptr) {
+		CloseHandle(m_fileHandle);
+	}
+}
+
+const bool& MappedFile::isOpen() const {
+	return m_open;
+}
+
+const unsigned char* MappedFile::getData() const {
+	return m_data;
+}
+
+const size_t& MappedFile::getSize() const {
+	return m_size;
+}
+
+FileReader::FileReader(const std::string& _path) {
+	HANDLE file = CreateFileA(_path.c_str(), GENERIC_READ, FILE_SHARE_READ | FILE_SHARE_WRITE | FILE_SHARE_DELETE, NULL, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL);
+	if (file == INVALID_HANDLE_VALUE) {
+		return;
+	}
+	m_handle = file;
+	m_open = true;
+}
+
+FileReader::~FileReader() {
+	if (m_handle != nullptr) {
+		CloseHandle(m_handle);
+	}
+}
+
+const bool& FileReader::isOpen() const {
+	return m_open;
+}
+
+unsigned long long FileReader::getSize() const {
+	LARGE_INTEGER size;
+	if (!m_open || !GetFileSizeEx(m_handle, &size)) {
+		return 0;
+	}
+	return (unsigned long long)size.QuadPart;
+}
+
+size_t FileReader::readAt(const unsigned long long& _offset, void* _buffer, const size_t& _size) const {
+	if (!m_open) {
+		return 0;
+	}
+	size_t total = 0;
+	while (total < _size) {
+		// the offset travels with the request, so the shared handle's file pointer is never relied on
+		const unsigned long long offset = _offset + total;
+		OVERLAPPED request = {};
+		request.Offset = DWORD(offset & 0xFFFFFFFF);
+		request.OffsetHigh = DWORD(offset >> 32);
+		DWORD read = 0;
+		const size_t remaining = _size - total;
+		const DWORD chunk = DWORD(remaining < (1u << 30) ? remaining : (1u << 30));
+		if (!ReadFile(m_handle, static_cast<char*>(_buffer) + total, chunk, &read, &request) || read == 0) {
+			break;
+		}
+		total += read;
+	}
+	return total;
+}
+
+FileWatcher::FileWatcher(const std::string& _path) : m_path(_path) {
+	// Win32 can only watch directories, any write in the directory of the file counts
+	const std::string::size_type pos = _path.find_last_of("\\/");
+	const std::string directory = (pos == std::string::npos ? "." : _path.substr(0, pos));
+	HANDLE handle = FindFirstChangeNotificationA(directory.c_str(), FALSE, FILE_NOTIFY_CHANGE_SIZE | FILE_NOTIFY_CHANGE_LAST_WRITE);
+	if (handle == INVALID_HANDLE_VALUE) {
+		PUSH_ERROR("Cannot Watch File");
+		return;
+	}
+	m_handle = handle;
+	m_open = true;
+}
+
+FileWatcher::~FileWatcher() {
+	if (m_handle != nullptr) {
+		FindCloseChangeNotification(m_handle);
+	}
+}
+
+const bool& FileWatcher::isOpen() const {
+	return m_open;
+}
+
+bool FileWatcher::consumeChange() {
+	if (!m_open || WaitForSingleObject(m_handle, 0) != WAIT_OBJECT_0) {
+		return false;
+	}
+	FindNextChangeNotification(m_handle);
+	return true;
+}
+
+static bool writeAll(HANDLE _file, const char* _data, size_t _size) {
+	while (_size > 0) {
+		const DWORD request = DWORD(_size < (1u << 30) ? _size : (1u << 30));
+		DWORD count = 0;
+		if (!WriteFile(_file, _data, request, &count, NULL) || count == 0) {
+			return false;
+		}
+		_data += count;
+		_size -= count;
+	}
+	return true;
+}
+
+bool writeFileAtomically(const std::string& _path, const std::vector<FilePiece>& _pieces, const std::string& _sourcePath) {
+	const std::string temporary = _path + ".saving";
+	HANDLE file = CreateFileA(temporary.c_str(), GENERIC_WRITE, 0, NULL, CREATE_ALWAYS, FILE_ATTRIBUTE_NORMAL, NULL);
+	if (file == INVALID_HANDLE_VALUE) {
+		PUSH_ERROR("Cannot Create File");
+		return false;
+	}
+	bool written = true;
+	{
+		// scoped so the source is closed again before it gets replaced, and read through a small buffer
+		// because a 32-bit process may have no room to map all of it
+		FileReader source(_sourcePath.empty() ? std::string() : _sourcePath);
+		static thread_local char buffer[1 << 16];
+		for (const FilePiece& piece : _pieces) {
+			if (piece.Data != nullptr) {
+				written = writeAll(file, piece.Data, piece.Size);
+			}
+			else {
+				size_t copied = 0;
+				while (written && copied < piece.Size) {
+					const size_t remaining = piece.Size - copied;
+					const size_t request = (remaining < sizeof(buffer) ? remaining : sizeof(buffer));
+					written = source.readAt(piece.SourceOffset + copied, buffer, request) == request && writeAll(file, buffer, request);
+					copied += request;
+				}
+			}
+			if (!written) {
+				break;
+			}
+		}
+	}
+	const bool flushed = written && FlushFileBuffers(file);
+	CloseHandle(file);
+	if (!flushed || !MoveFileExA(temporary.c_str(), _path.c_str(), MOVEFILE_REPLACE_EXISTING | MOVEFILE_WRITE_THROUGH)) {
+		PUSH_ERROR("Cannot Write File");
+		DeleteFileA(temporary.c_str());
+		return false;
+	}
+	return true;
+}
+
+bool appendFileDurably(const std::string& _path, const std::string& _bytes) {
+	HANDLE file = CreateFileA(_path.c_str(), FILE_APPEND_DATA, FILE_SHARE_READ, NULL, OPEN_ALWAYS, FILE_ATTRIBUTE_NORMAL, NULL);
+	if (file == INVALID_HANDLE_VALUE) {
+		return false;
+	}
+	const bool written = writeAll(file, _bytes.data(), _bytes.size()) && FlushFileBuffers(file);
+	CloseHandle(file);
+	return written;
+}
+
+std::string getExecutableDirectory() {
+	char buffer[MAX_PATH];
+	GetModuleFileNameA(NULL, buffer, MAX_PATH);
+	std::string::size_type pos = std::string(buffer).find_last_of("\\/");
+	return std::string(buffer).substr(0, pos);
+}
@@ -0,0 +1,134 @@
+#include "render_queue.h"
+#include "stream_buffer.h"
+#include "gl_state.h"
+#include "shader.h"
+#include "utils.h"
+#include "macros.h"
+
+#include <algorithm>
+#include <numeric>
+#include <cstring>
+
+RenderQueue::RenderQueue() {
+	m_vertexStream = new StreamBuffer(RENDER_QUEUE_STREAM_BUFFER_SIZE);
+}
+
+RenderQueue::~RenderQueue() {
+	delete m_vertexStream;
+}
+
+unsigned long long RenderQueue::makeSortKey(RenderLayer _layer, unsigned int _program, unsigned int _texture) {
+	return (static_cast<unsigned long long>(_layer) << 56) |
+		(static_cast<unsigned long long>(_program & 0xFFFFFF) << 32) |
+		static_cast<unsigned long long>(_texture);
+}
+
+bool RenderQueue::canMerge(const RenderCommand& _a, const RenderCommand& _b) {
+	if (_a.Custom || _b.Custom) {
+		return false;
+	}
+	return _a.SortKey == _b.SortKey &&
+		_a.Program == _b.Program &&
+		_a.VertexArray == _b.VertexArray &&
+		_a.ViewMatrix == _b.ViewMatrix &&
+		_a.Stride == _b.Stride;
+}
+
+void RenderQueue::submit(RenderLayer _layer, Shader* _program, unsigned int _texture, unsigned int _vertexArray,
+	const float* _viewMatrix, const void* _vertices, size_t _vertexBytes, size_t _stride) {
+	if (_vertexBytes == 0) {
+		return;
+	}
+	RenderCommand cmd;
+	cmd.SortKey = makeSortKey(_layer, _program->ID, _texture);
+	cmd.Program = _program;
+	cmd.Texture = _texture;
+	cmd.VertexArray = _vertexArray;
+	cmd.ViewMatrix = _viewMatrix;
+	cmd.Stride = _stride;
+	cmd.VertexOffset = m_vertexArena.size();
+	cmd.VertexBytes = _vertexBytes;
+	const unsigned char* bytes = static_cast<const unsigned char*>(_vertices);
+	m_vertexArena.insert(m_vertexArena.end(), bytes, bytes + _vertexBytes);
+	m_commands.push_back(std::move(cmd));
+}
+
+void RenderQueue::submitCustom(RenderLayer _layer, Shader* _program, unsigned int _texture, unsigned int _vertexArray,
+	const std::function<void(Shader*)>& _custom) {
+	RenderCommand cmd;
+	cmd.SortKey = makeSortKey(_layer, _program->ID, _texture);
+	cmd.Program = _program;
+	cmd.Texture = _texture;
+	cmd.VertexArray = _vertexArray;
+	cmd.Custom = _custom;
+	m_commands.push_back(std::move(cmd));
+}
+
+void RenderQueue::flush(const float* _projectionMatrix) {
+	m_stats = {};
+	m_stats.submitted = m_commands.size();
+	m_order.resize(m_commands.size());
+	std::iota(m_order.begin(), m_order.end(), size_t(0));
+	std::stable_sort(m_order.begin(), m_order.end(), [this](size_t a, size_t b) {
+		return m_commands[a].SortKey < m_commands[b].SortKey;
+	});
+	glSetRenderMode(GLRenderMode::GL2D);
+	GLStateCache& state = GLStateCache::get();
+	Shader* currentProgram = nullptr;
+	const float* currentView = nullptr;
+	size_t i = 0;
+	while (i < m_order.size()) {
+		const RenderCommand& cmd = m_commands[m_order[i]];
+		if (cmd.Program != currentProgram) {
+			cmd.Program->use();
+			cmd.Program->setMat4("ProjectionMatrix", _projectionMatrix);
+			currentProgram = cmd.Program;
+			currentView = nullptr;
+		}
+		if (cmd.ViewMatrix != nullptr && cmd.ViewMatrix != currentView) {
+			cmd.Program->setMat4("ViewMatrix", cmd.ViewMatrix);
+			currentView = cmd.ViewMatrix;
+		}
+		state.bindVertexArray(cmd.VertexArray);
+		if (cmd.Texture != 0) {
+			state.bindTexture(0, cmd.Texture);
+		}
+		if (cmd.Custom) {
+			cmd.Custom(cmd.Program);
+			currentView = nullptr;
+			m_stats.drawCalls++;
+			i++;
+			continue;
+		}
+		size_t j = i + 1;
+		size_t bytes = cmd.VertexBytes;
+		while (j < m_order.size() && canMerge(cmd, m_commands[m_order[j]])) {
+			bytes += m_commands[m_order[j]].VertexBytes;
+			j++;
+		}
+		size_t offset = 0;
+		unsigned char* dst = static_cast<unsigned char*>(m_vertexStream->map(bytes, cmd.Stride, offset));
+		if (dst != nullptr) {
+			for (size_t k = i; k < j; k++) {
+				const RenderCommand& part = m_commands[m_order[k]];
+				memcpy(dst, m_vertexArena.data() + part.VertexOffset, part.VertexBytes);
+				dst += part.VertexBytes;
+			}
+			m_vertexStream->unmap();
+			glDrawArrays(GL_TRIANGLES, GLint(offset / cmd.Stride), GLsizei(bytes / cmd.Stride));
+			m_stats.drawCalls++;
+			m_stats.merged += j - i - 1;
+		}
+		i = j;
+	}
+	m_commands.clear();
+	m_vertexArena.clear();
+}
+
+const unsigned int& RenderQueue::getVertexBufferID() const {
+	return m_vertexStream->getID();
+}
+
+const RenderQueueStats& RenderQueue::getStats() const {
+	return m_stats;
+}
\ No newline at end of file
@@ -0,0 +1,90 @@
+#include "stream_buffer.h"
+#include "gl_state.h"
+#include "macros.h"
+
+#include <cassert>
+#include <cstring>
+
+StreamBuffer::StreamBuffer(size_t _capacity) {
+	glGenBuffers(1, &m_VBO);
+	orphan(_capacity);
+}
+
+StreamBuffer::~StreamBuffer() {
+	GLStateCache::get().forgetBuffer(m_VBO);
+	glDeleteBuffers(1, &m_VBO);
+}
+
+void StreamBuffer::orphan(size_t _capacity) {
+	GLStateCache::get().bindArrayBuffer(m_VBO);
+	glBufferData(GL_ARRAY_BUFFER, _capacity, NULL, GL_STREAM_DRAW);
+	if (m_capacity != 0) {
+		m_orphanCount++;
+	}
+	m_capacity = _capacity;
+	m_head = 0;
+}
+
+void* StreamBuffer::map(size_t _size, size_t _alignment, size_t& _offset) {
+	assert(!m_mapped);
+	if (_size == 0) {
+		_offset = m_head;
+		return nullptr;
+	}
+	size_t aligned = m_head;
+	if (_alignment > 1 && aligned % _alignment != 0) {
+		aligned += _alignment - aligned % _alignment;
+	}
+	if (aligned + _size > m_capacity) {
+		size_t capacity = m_capacity;
+		while (capacity < _size) {
+			capacity *= 2;
+		}
+		orphan(capacity);
+		aligned = 0;
+	}
+	GLStateCache::get().bindArrayBuffer(m_VBO);
+	void* ptr = glMapBufferRange(GL_ARRAY_BUFFER, aligned, _size,
+		GL_MAP_WRITE_BIT | GL_MAP_INVALIDATE_RANGE_BIT | GL_MAP_UNSYNCHRONIZED_BIT);
+	if (ptr == nullptr) {
+		PUSH_ERROR("Cannot Map Stream Buffer");
+		_offset = aligned;
+		return nullptr;
+	}
+	m_mapped = true;
+	m_mappedOffset = aligned;
+	m_head = aligned + _size;
+	_offset = aligned;
+	return ptr;
+}
+
+void StreamBuffer::unmap() {
+	if (!m_mapped) {
+		return;
+	}
+	GLStateCache::get().bindArrayBuffer(m_VBO);
+	glUnmapBuffer(GL_ARRAY_BUFFER);
+	m_mapped = false;
+}
+
+size_t StreamBuffer::push(const void* _data, size_t _size, size_t _alignment) {
+	size_t offset = 0;
+	void* ptr = map(_size, _alignment, offset);
+	if (ptr != nullptr) {
+		memcpy(ptr, _data, _size);
+		unmap();
+	}
+	return offset;
+}
+
+const unsigned int& StreamBuffer::getID() const {
+	return m_VBO;
+}
+
+const size_t& StreamBuffer::getCapacity() const {
+	return m_capacity;
+}
+
+const unsigned long long& StreamBuffer::getOrphanCount() const {
+	return m_orphanCount;
+}
\ No newline at end of file
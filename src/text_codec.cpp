@@ -0,0 +1,318 @@
+#include "text_codec.h"
+
+#include <algorithm>
+#include <bit>
+#include <cstring>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+	#define TEXT_CODEC_SSE2
+	#include <emmintrin.h>
+#endif
+
+#define TEXT_CODEC_REPLACEMENT 0xFFFD
+#define TEXT_CODEC_CHUNK 4096
+
+static wchar_t* appendCodepoint(wchar_t* _out, unsigned int _codepoint) {
+	if (sizeof(wchar_t) == 2 && _codepoint >= 0x10000) {
+		_codepoint -= 0x10000;
+		*_out++ = wchar_t(0xD800 + (_codepoint >> 10));
+		*_out++ = wchar_t(0xDC00 + (_codepoint & 0x3FF));
+		return _out;
+	}
+	*_out++ = wchar_t(_codepoint);
+	return _out;
+}
+
+// length of the well formed sequence at _data, 0 when it is malformed
+static size_t readSequence(const unsigned char* _data, size_t _available, unsigned int& _codepoint) {
+	const unsigned char lead = _data[0];
+	size_t length = 0;
+	unsigned int minimum = 0;
+	if ((lead & 0xE0) == 0xC0) {
+		length = 2;
+		_codepoint = lead & 0x1F;
+		minimum = 0x80;
+	}
+	else if ((lead & 0xF0) == 0xE0) {
+		length = 3;
+		_codepoint = lead & 0x0F;
+		minimum = 0x800;
+	}
+	else if ((lead & 0xF8) == 0xF0) {
+		length = 4;
+		_codepoint = lead & 0x07;
+		minimum = 0x10000;
+	}
+	if (length == 0 || length > _available) {
+		return 0;
+	}
+	for (size_t k = 1; k < length; k++) {
+		if ((_data[k] & 0xC0) != 0x80) {
+			return 0;
+		}
+		_codepoint = (_codepoint << 6) | (_data[k] & 0x3F);
+	}
+	if (_codepoint < minimum || _codepoint > 0x10FFFF || (_codepoint >= 0xD800 && _codepoint <= 0xDFFF)) {
+		return 0;
+	}
+	return length;
+}
+
+// CRLF wins when at least half of the line breaks use it, text without any keeps the platform default
+static void detectLineEnding(TextFormat& _format, size_t _newlines, size_t _crlfs) {
+	if (_crlfs > 0 && _crlfs >= _newlines - _crlfs) {
+		_format.Ending = LineEnding::CRLF;
+	}
+	else if (_newlines > 0) {
+		_format.Ending = LineEnding::LF;
+	}
+}
+
+#ifdef TEXT_CODEC_SSE2
+// widens 16 bytes that are all ASCII and free of '\r', returns false without writing anything otherwise
+static bool decodeAsciiBlock(const unsigned char* _data, wchar_t* _out, size_t& _newlines) {
+	const __m128i bytes = _mm_loadu_si128(reinterpret_cast<const __m128i*>(_data));
+	const __m128i carriageReturns = _mm_cmpeq_epi8(bytes, _mm_set1_epi8('\r'));
+	if (_mm_movemask_epi8(_mm_or_si128(bytes, carriageReturns)) != 0) {
+		return false;
+	}
+	_newlines += size_t(std::popcount(unsigned(_mm_movemask_epi8(_mm_cmpeq_epi8(bytes, _mm_set1_epi8('\n'))))));
+	const __m128i zero = _mm_setzero_si128();
+	const __m128i low = _mm_unpacklo_epi8(bytes, zero);
+	const __m128i high = _mm_unpackhi_epi8(bytes, zero);
+	if constexpr (sizeof(wchar_t) == 2) {
+		_mm_storeu_si128(reinterpret_cast<__m128i*>(_out), low);
+		_mm_storeu_si128(reinterpret_cast<__m128i*>(_out + 8), high);
+	}
+	else {
+		_mm_storeu_si128(reinterpret_cast<__m128i*>(_out), _mm_unpacklo_epi16(low, zero));
+		_mm_storeu_si128(reinterpret_cast<__m128i*>(_out + 4), _mm_unpackhi_epi16(low, zero));
+		_mm_storeu_si128(reinterpret_cast<__m128i*>(_out + 8), _mm_unpacklo_epi16(high, zero));
+		_mm_storeu_si128(reinterpret_cast<__m128i*>(_out + 12), _mm_unpackhi_epi16(high, zero));
+	}
+	return true;
+}
+
+// narrows 16 characters that are all ASCII (and free of '\n' when it has to become CRLF)
+static bool encodeAsciiBlock(const wchar_t* _text, char* _out, bool _crlf) {
+	const __m128i* in = reinterpret_cast<const __m128i*>(_text);
+	const __m128i newline = (sizeof(wchar_t) == 2 ? _mm_set1_epi16('\n') : _mm_set1_epi32('\n'));
+	if constexpr (sizeof(wchar_t) == 2) {
+		const __m128i a = _mm_loadu_si128(in);
+		const __m128i b = _mm_loadu_si128(in + 1);
+		const __m128i wide = _mm_and_si128(_mm_or_si128(a, b), _mm_set1_epi16(short(0xFF80)));
+		if (_mm_movemask_epi8(_mm_cmpeq_epi16(wide, _mm_setzero_si128())) != 0xFFFF) {
+			return false;
+		}
+		if (_crlf && _mm_movemask_epi8(_mm_or_si128(_mm_cmpeq_epi16(a, newline), _mm_cmpeq_epi16(b, newline))) != 0) {
+			return false;
+		}
+		_mm_storeu_si128(reinterpret_cast<__m128i*>(_out), _mm_packus_epi16(a, b));
+	}
+	else {
+		const __m128i a = _mm_loadu_si128(in);
+		const __m128i b = _mm_loadu_si128(in + 1);
+		const __m128i c = _mm_loadu_si128(in + 2);
+		const __m128i d = _mm_loadu_si128(in + 3);
+		const __m128i any = _mm_or_si128(_mm_or_si128(a, b), _mm_or_si128(c, d));
+		const __m128i wide = _mm_and_si128(any, _mm_set1_epi32(int(0xFFFFFF80)));
+		if (_mm_movemask_epi8(_mm_cmpeq_epi32(wide, _mm_setzero_si128())) != 0xFFFF) {
+			return false;
+		}
+		if (_crlf) {
+			const __m128i newlines = _mm_or_si128(
+				_mm_or_si128(_mm_cmpeq_epi32(a, newline), _mm_cmpeq_epi32(b, newline)),
+				_mm_or_si128(_mm_cmpeq_epi32(c, newline), _mm_cmpeq_epi32(d, newline)));
+			if (_mm_movemask_epi8(newlines) != 0) {
+				return false;
+			}
+		}
+		_mm_storeu_si128(reinterpret_cast<__m128i*>(_out), _mm_packus_epi16(_mm_packs_epi32(a, b), _mm_packs_epi32(c, d)));
+	}
+	return true;
+}
+#endif
+
+TextFormat decodeUtf8(const unsigned char* _data, size_t _size, std::wstring& _out) {
+	TextFormat format;
+	size_t i = 0;
+	if (_size >= 3 && _data[0] == 0xEF && _data[1] == 0xBB && _data[2] == 0xBF) {
+		format.HasBom = true;
+		i = 3;
+	}
+	// every byte becomes at most one wchar_t, a 4 byte sequence at most two
+	_out.resize(_size - i);
+	wchar_t* const begin = _out.data();
+	wchar_t* out = begin;
+	size_t newlines = 0;
+	size_t crlfs = 0;
+	while (i < _size) {
+#ifdef TEXT_CODEC_SSE2
+		if (i + 16 <= _size && decodeAsciiBlock(_data + i, out, newlines)) {
+			i += 16;
+			out += 16;
+			continue;
+		}
+#endif
+		const unsigned char lead = _data[i];
+		if (lead < 0x80) {
+			if (lead == '\r' && i + 1 < _size && _data[i + 1] == '\n') {
+				crlfs++;
+				i++;
+				continue;
+			}
+			newlines += (lead == '\n');
+			*out++ = wchar_t(lead);
+			i++;
+			continue;
+		}
+		unsigned int codepoint = 0;
+		const size_t length = readSequence(_data + i, _size - i, codepoint);
+		if (length == 0) {
+			format.Valid = false;
+			*out++ = wchar_t(TEXT_CODEC_REPLACEMENT);
+			i++;
+			continue;
+		}
+		out = appendCodepoint(out, codepoint);
+		i += length;
+	}
+	_out.resize(size_t(out - begin));
+	detectLineEnding(format, newlines, crlfs);
+	return format;
+}
+
+TextFormat normalizeUtf8(const unsigned char* _data, size_t _size, std::string& _out, bool _detectBom) {
+	TextFormat format;
+	size_t i = 0;
+	if (_detectBom && _size >= 3 && _data[0] == 0xEF && _data[1] == 0xBB && _data[2] == 0xBF) {
+		format.HasBom = true;
+		i = 3;
+	}
+	// output only outgrows the input when a malformed byte is widened to the 3 byte replacement character
+	_out.resize(_size - i);
+	size_t written = 0;
+	size_t newlines = 0;
+	size_t crlfs = 0;
+	while (i < _size) {
+#ifdef TEXT_CODEC_SSE2
+		if (i + 16 <= _size) {
+			const __m128i bytes = _mm_loadu_si128(reinterpret_cast<const __m128i*>(_data + i));
+			const __m128i carriageReturns = _mm_cmpeq_epi8(bytes, _mm_set1_epi8('\r'));
+			if (_mm_movemask_epi8(_mm_or_si128(bytes, carriageReturns)) == 0) {
+				newlines += size_t(std::popcount(unsigned(_mm_movemask_epi8(_mm_cmpeq_epi8(bytes, _mm_set1_epi8('\n'))))));
+				_mm_storeu_si128(reinterpret_cast<__m128i*>(&_out[written]), bytes);
+				i += 16;
+				written += 16;
+				continue;
+			}
+		}
+#endif
+		const unsigned char lead = _data[i];
+		if (lead < 0x80) {
+			if (lead == '\r' && i + 1 < _size && _data[i + 1] == '\n') {
+				crlfs++;
+				i++;
+				continue;
+			}
+			newlines += (lead == '\n');
+			_out[written++] = char(lead);
+			i++;
+			continue;
+		}
+		unsigned int codepoint = 0;
+		const size_t length = readSequence(_data + i, _size - i, codepoint);
+		if (length == 0) {
+			format.Valid = false;
+			const size_t needed = written + 3 + (_size - i - 1);
+			if (_out.size() < needed) {
+				_out.resize(std::max(needed, _out.size() + _out.size() / 2));
+			}
+			_out[written++] = char(0xEF);
+			_out[written++] = char(0xBF);
+			_out[written++] = char(0xBD);
+			i++;
+			continue;
+		}
+		std::copy(_data + i, _data + i + length, _out.begin() + written);
+		written += length;
+		i += length;
+	}
+	_out.resize(written);
+	detectLineEnding(format, newlines, crlfs);
+	return format;
+}
+
+std::string encodeUtf8(const std::wstring& _text, const TextFormat& _format) {
+	const bool crlf = _format.Ending == LineEnding::CRLF;
+	std::string result;
+	result.reserve(_text.size() + (_format.HasBom ? 3 : 0));
+	if (_format.HasBom) {
+		result.append("\xEF\xBB\xBF");
+	}
+	// encoded a chunk at a time into a fixed buffer, a character never takes more than 4 bytes
+	char buffer[TEXT_CODEC_CHUNK * 4 + 8];
+	const size_t size = _text.size();
+	size_t i = 0;
+	while (i < size) {
+		const size_t end = std::min(i + TEXT_CODEC_CHUNK, size);
+		char* out = buffer;
+		while (i < end) {
+#ifdef TEXT_CODEC_SSE2
+			if (i + 16 <= end && encodeAsciiBlock(_text.data() + i, out, crlf)) {
+				i += 16;
+				out += 16;
+				continue;
+			}
+#endif
+			unsigned int codepoint = (unsigned int)_text[i++];
+			if (sizeof(wchar_t) == 2 && codepoint >= 0xD800 && codepoint <= 0xDBFF && i < size &&
+				(unsigned int)_text[i] >= 0xDC00 && (unsigned int)_text[i] <= 0xDFFF) {
+				codepoint = 0x10000 + ((codepoint - 0xD800) << 10) + ((unsigned int)_text[i] - 0xDC00);
+				i++;
+			}
+			if (codepoint < 0x80) {
+				if (codepoint == '\n' && crlf) {
+					*out++ = '\r';
+				}
+				*out++ = char(codepoint);
+			}
+			else if (codepoint < 0x800) {
+				*out++ = char(0xC0 | (codepoint >> 6));
+				*out++ = char(0x80 | (codepoint & 0x3F));
+			}
+			else if (codepoint < 0x10000) {
+				*out++ = char(0xE0 | (codepoint >> 12));
+				*out++ = char(0x80 | ((codepoint >> 6) & 0x3F));
+				*out++ = char(0x80 | (codepoint & 0x3F));
+			}
+			else {
+				*out++ = char(0xF0 | (codepoint >> 18));
+				*out++ = char(0x80 | ((codepoint >> 12) & 0x3F));
+				*out++ = char(0x80 | ((codepoint >> 6) & 0x3F));
+				*out++ = char(0x80 | (codepoint & 0x3F));
+			}
+		}
+		result.append(buffer, size_t(out - buffer));
+	}
+	return result;
+}
+
+void appendWithLineEnding(const char* _data, size_t _size, LineEnding _ending, std::string& _out) {
+	if (_ending != LineEnding::CRLF) {
+		_out.append(_data, _size);
+		return;
+	}
+	_out.reserve(_out.size() + _size + _size / 32);
+	const char* end = _data + _size;
+	const char* copied = _data;
+	const void* newline = memchr(copied, '\n', size_t(end - copied));
+	while (newline != nullptr) {
+		const char* at = static_cast<const char*>(newline);
+		_out.append(copied, size_t(at - copied));
+		_out.append("\r\n");
+		copied = at + 1;
+		newline = memchr(copied, '\n', size_t(end - copied));
+	}
+	_out.append(copied, size_t(end - copied));
+}
@@ -1,5 +1,6 @@
 #include "texture.h"
 #include "macros.h"
+#include "gl_state.h"
 #include <vector>
 
 
@@ -7,7 +8,7 @@ Texture::Texture(unsigned char* _data, int _width, int _height, int _channels, b
 	m_size.x = _width;
 	m_size.y = _height;
 	glGenTextures(1, &m_textureID);
-	glBindTexture(GL_TEXTURE_2D, m_textureID);
+	GLStateCache::get().bindTexture(0, m_textureID);
 	if (_repeatTex) {
 		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
 	} else {
@@ -34,12 +35,12 @@ Texture::Texture(unsigned char* _data, int _width, int _height, int _channels, b
 }
 
 Texture::~Texture() {
+	GLStateCache::get().forgetTexture(m_textureID);
 	glDeleteTextures(1, &m_textureID);
 }
 
 void Texture::bind(int _offset) const {
-	glActiveTexture(GL_TEXTURE0 + _offset);
-	glBindTexture(GL_TEXTURE_2D, m_textureID);
+	GLStateCache::get().bindTexture(_offset, m_textureID);
 }
 
 const uint32_t& Texture::getID() const {
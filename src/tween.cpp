@@ -2,6 +2,12 @@
 #include "camera.h"
 #include "math_utils.h"
 
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+
+#define TWEEN_MAX_FRAME_DELTA 0.1
+
 static double linear(double t) {
 	return t;
 }
@@ -77,12 +83,19 @@ static double truncate(double num) {
 	return num;
 }
 
+static double now() {
+	return std::chrono::duration<double>(std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
 void Tween::update() {
 	if (!m_isPlaying) {
 		return;
 	}
-	auto iter = m_currentList.begin();
-	for (size_t index = 0; index < m_currentList.size(); index++) {
+	// advance by the real frame time so animations keep their duration when frames are slow or vsync is off
+	const double time = now();
+	const double delta = std::clamp(time - m_lastUpdateTime, 0.0, TWEEN_MAX_FRAME_DELTA);
+	m_lastUpdateTime = time;
+	for (size_t index = 0; index < m_currentList.size();) {
 		TweenInfo& info = m_currentList[index];
 		if (info.Duration <= info.PlaybackPosition) {
 			if (info.PropertyType == TweenablePropertyType::CameraPosition) {
@@ -95,12 +108,10 @@ void Tween::update() {
 				info.Object->setZoomOffset(info.EndValue);
 				info.Object->setZoomOffset(vec2(truncate(info.Object->getZoomOffset().x), truncate(info.Object->getZoomOffset().y)));
 			}
-			iter = m_currentList.erase(iter);
+			m_currentList.erase(m_currentList.begin() + index);
 			continue;
 		}
 
-		const double& targetFPS = 60.0;
-
 		double t = info.PlaybackPosition / info.Duration;
 		if (t > 1.0) t = 1.0;
 
@@ -176,8 +187,8 @@ void Tween::update() {
 			break;
 		}
 		}
-		info.PlaybackPosition += 1.0 / targetFPS;
-		iter++;
+		info.PlaybackPosition += delta;
+		index++;
 	}
 
 }
@@ -186,6 +197,9 @@ void Tween::interpolateProperty(const TweenInfo& _info) {
 	m_currentList.push_back(_info);
 }
 void Tween::start() {
+	if (!m_isPlaying) {
+		m_lastUpdateTime = now();
+	}
 	m_isPlaying = true;
 }
 void Tween::stop() {
@@ -0,0 +1,487 @@
+#include "utf8_text.h"
+
+#include <algorithm>
+#include <cstring>
+
+#define UTF8_TEXT_INDEX_STRIDE 256
+#define UTF8_TEXT_REPLACEMENT 0xFFFD
+
+static inline size_t sequenceLength(const unsigned char& _lead) {
+	if (_lead < 0x80) {
+		return 1;
+	}
+	if ((_lead & 0xE0) == 0xC0) {
+		return 2;
+	}
+	if ((_lead & 0xF0) == 0xE0) {
+		return 3;
+	}
+	return 4;
+}
+
+// the buffer only ever holds well formed UTF-8, so decoding needs no checks
+static inline unsigned int decodeAt(const unsigned char* _data) {
+	const unsigned char lead = _data[0];
+	if (lead < 0x80) {
+		return lead;
+	}
+	if ((lead & 0xE0) == 0xC0) {
+		return ((lead & 0x1F) << 6) | (_data[1] & 0x3F);
+	}
+	if ((lead & 0xF0) == 0xE0) {
+		return ((lead & 0x0F) << 12) | ((_data[1] & 0x3F) << 6) | (_data[2] & 0x3F);
+	}
+	return ((lead & 0x07) << 18) | ((_data[1] & 0x3F) << 12) | ((_data[2] & 0x3F) << 6) | (_data[3] & 0x3F);
+}
+
+static inline size_t encodeCodepoint(unsigned int _codepoint, char* _out) {
+	if ((_codepoint >= 0xD800 && _codepoint <= 0xDFFF) || _codepoint > 0x10FFFF) {
+		_codepoint = UTF8_TEXT_REPLACEMENT;
+	}
+	if (_codepoint < 0x80) {
+		_out[0] = char(_codepoint);
+		return 1;
+	}
+	if (_codepoint < 0x800) {
+		_out[0] = char(0xC0 | (_codepoint >> 6));
+		_out[1] = char(0x80 | (_codepoint & 0x3F));
+		return 2;
+	}
+	if (_codepoint < 0x10000) {
+		_out[0] = char(0xE0 | (_codepoint >> 12));
+		_out[1] = char(0x80 | ((_codepoint >> 6) & 0x3F));
+		_out[2] = char(0x80 | (_codepoint & 0x3F));
+		return 3;
+	}
+	_out[0] = char(0xF0 | (_codepoint >> 18));
+	_out[1] = char(0x80 | ((_codepoint >> 12) & 0x3F));
+	_out[2] = char(0x80 | ((_codepoint >> 6) & 0x3F));
+	_out[3] = char(0x80 | (_codepoint & 0x3F));
+	return 4;
+}
+
+Utf8Text::Utf8Text(const std::wstring& _text) {
+	append(_text);
+}
+
+Utf8Text::Utf8Text(Utf8Text&& _other) noexcept {
+	swap(_other);
+}
+
+Utf8Text& Utf8Text::operator=(Utf8Text&& _other) noexcept {
+	if (this != &_other) {
+		Utf8Text moved;
+		moved.swap(_other);
+		swap(moved);
+	}
+	return *this;
+}
+
+Utf8Text Utf8Text::fromUtf8(std::string _bytes) {
+	Utf8Text text;
+	text.m_bytes = std::make_shared<std::string>(std::move(_bytes));
+	text.indexFrom(0);
+	return text;
+}
+
+void Utf8Text::indexFrom(const size_t& _entry) {
+	m_size = indexBetween(_entry, m_bytes->size());
+	resetCache();
+}
+
+// drops the entries after _entry and indexes again up to _byteEnd, the end or where a kept entry starts; returns the codepoint there
+size_t Utf8Text::indexBetween(const size_t& _entry, const size_t& _byteEnd) {
+	m_index.resize(_entry + 1);
+	const unsigned char* data = reinterpret_cast<const unsigned char*>(m_bytes->data());
+	size_t codepoint = m_index[_entry].Codepoint;
+	size_t next = codepoint + UTF8_TEXT_INDEX_STRIDE;
+	size_t b = m_index[_entry].Byte;
+	while (b < _byteEnd) {
+		// a whole stride of ASCII is skipped without looking at every lead byte
+		if (b + (next - codepoint) <= _byteEnd) {
+			const unsigned char* end = data + b + (next - codepoint);
+			if (std::find_if(data + b, end, [](const unsigned char& c) { return c >= 0x80; }) == end) {
+				b += next - codepoint;
+				codepoint = next;
+				if (b < _byteEnd) {
+					m_index.push_back(IndexEntry{ codepoint, b });
+					next += UTF8_TEXT_INDEX_STRIDE;
+				}
+				continue;
+			}
+		}
+		if (codepoint == next) {
+			m_index.push_back(IndexEntry{ codepoint, b });
+			next += UTF8_TEXT_INDEX_STRIDE;
+		}
+		b += sequenceLength(data[b]);
+		codepoint++;
+	}
+	return codepoint;
+}
+
+size_t Utf8Text::findEntry(const size_t& _index) const {
+	// front-to-back scans stay in the cached chunk or step into the next one
+	for (size_t entry = m_cacheEntry; entry < m_index.size() && entry <= m_cacheEntry + 1; entry++) {
+		if (m_index[entry].Codepoint <= _index && (entry + 1 == m_index.size() || _index < m_index[entry + 1].Codepoint)) {
+			return entry;
+		}
+	}
+	auto it = std::upper_bound(m_index.begin(), m_index.end(), _index, [](const size_t& value, const IndexEntry& entry) {
+		return value < entry.Codepoint;
+	});
+	return size_t(it - m_index.begin()) - 1;
+}
+
+size_t Utf8Text::findEntryByByte(const size_t& _byte) const {
+	auto it = std::upper_bound(m_index.begin(), m_index.end(), _byte, [](const size_t& value, const IndexEntry& entry) {
+		return value < entry.Byte;
+	});
+	return size_t(it - m_index.begin()) - 1;
+}
+
+size_t Utf8Text::getEntryEnd(const size_t& _entry, size_t& _byteEnd) const {
+	if (_entry + 1 < m_index.size()) {
+		_byteEnd = m_index[_entry + 1].Byte;
+		return m_index[_entry + 1].Codepoint;
+	}
+	_byteEnd = m_bytes->size();
+	return m_size;
+}
+
+void Utf8Text::shiftEntries(const size_t& _entry, const long long& _codepoints, const long long& _bytes) {
+	for (size_t i = _entry + 1; i < m_index.size(); i++) {
+		m_index[i].Codepoint = size_t((long long)m_index[i].Codepoint + _codepoints);
+		m_index[i].Byte = size_t((long long)m_index[i].Byte + _bytes);
+	}
+}
+
+void Utf8Text::resetCache() const {
+	m_cacheEntry = 0;
+	m_cacheChunkStart = 0;
+	m_cacheChunkEnd = 0;
+	m_cacheChunkByte = 0;
+	m_cacheAscii = false;
+	m_cacheCodepoint = 0;
+	m_cacheByte = 0;
+}
+
+const size_t& Utf8Text::size() const {
+	return m_size;
+}
+
+bool Utf8Text::empty() const {
+	return m_size == 0;
+}
+
+wchar_t Utf8Text::lookup(const size_t& _index) const {
+	if (_index >= m_size) {
+		return L'\0';
+	}
+	const unsigned int codepoint = decodeAt(reinterpret_cast<const unsigned char*>(m_bytes->data()) + getByteOffset(_index));
+	if (sizeof(wchar_t) == 2 && codepoint >= 0x10000) {
+		return wchar_t(UTF8_TEXT_REPLACEMENT);
+	}
+	return wchar_t(codepoint);
+}
+
+size_t Utf8Text::getByteOffset(const size_t& _index) const {
+	if (_index >= m_size) {
+		return m_bytes->size();
+	}
+	const size_t entry = findEntry(_index);
+	size_t byteEnd = 0;
+	const size_t codepointEnd = getEntryEnd(entry, byteEnd);
+	const IndexEntry& start = m_index[entry];
+	if (m_cacheEntry != entry || m_cacheChunkStart != start.Codepoint || m_cacheChunkEnd != codepointEnd) {
+		m_cacheEntry = entry;
+		m_cacheChunkStart = start.Codepoint;
+		m_cacheChunkEnd = codepointEnd;
+		m_cacheChunkByte = start.Byte;
+		m_cacheAscii = byteEnd - start.Byte == codepointEnd - start.Codepoint;
+		m_cacheCodepoint = start.Codepoint;
+		m_cacheByte = start.Byte;
+	}
+	if (m_cacheAscii) {
+		return start.Byte + (_index - start.Codepoint);
+	}
+	size_t codepoint = start.Codepoint;
+	size_t b = start.Byte;
+	if (m_cacheCodepoint <= _index) {
+		codepoint = m_cacheCodepoint;
+		b = m_cacheByte;
+	}
+	const unsigned char* data = reinterpret_cast<const unsigned char*>(m_bytes->data());
+	while (codepoint < _index) {
+		b += sequenceLength(data[b]);
+		codepoint++;
+	}
+	m_cacheCodepoint = codepoint;
+	m_cacheByte = b;
+	return b;
+}
+
+size_t Utf8Text::getCodepointIndex(const size_t& _byte) const {
+	if (_byte >= m_bytes->size()) {
+		return m_size;
+	}
+	const size_t entry = findEntryByByte(_byte);
+	size_t codepoint = m_index[entry].Codepoint;
+	size_t b = m_index[entry].Byte;
+	const unsigned char* data = reinterpret_cast<const unsigned char*>(m_bytes->data());
+	while (b < _byte) {
+		b += sequenceLength(data[b]);
+		codepoint++;
+	}
+	return codepoint;
+}
+
+std::wstring Utf8Text::substr(const size_t& _from, const size_t& _count) const {
+	const size_t from = std::min(_from, m_size);
+	const size_t to = std::min(m_size, from + std::min(_count, m_size - from));
+	const size_t byteFrom = getByteOffset(from);
+	const size_t byteTo = getByteOffset(to);
+	std::wstring result;
+	result.reserve(to - from);
+	const unsigned char* data = reinterpret_cast<const unsigned char*>(m_bytes->data());
+	for (size_t b = byteFrom; b < byteTo; b += sequenceLength(data[b])) {
+		const unsigned int codepoint = decodeAt(data + b);
+		if (sizeof(wchar_t) == 2 && codepoint >= 0x10000) {
+			result.push_back(wchar_t(0xD800 + ((codepoint - 0x10000) >> 10)));
+			result.push_back(wchar_t(0xDC00 + ((codepoint - 0x10000) & 0x3FF)));
+			continue;
+		}
+		result.push_back(wchar_t(codepoint));
+	}
+	return result;
+}
+
+size_t Utf8Text::find(const std::wstring& _needle, const size_t& _from) const {
+	if (_from > m_size) {
+		return npos;
+	}
+	// well formed UTF-8 never matches in the middle of a sequence, so searching the bytes is enough
+	const size_t found = m_bytes->find(encodeUtf8(_needle), getByteOffset(_from));
+	if (found == std::string::npos) {
+		return npos;
+	}
+	return getCodepointIndex(found);
+}
+
+// copies that still share the bytes keep seeing them as they were, the first edit after sharing pays for the copy
+std::string& Utf8Text::mutableBytes() {
+	if (m_bytes.use_count() > 1) {
+		m_bytes = std::make_shared<std::string>(*m_bytes);
+	}
+	return *m_bytes;
+}
+
+std::shared_ptr<const std::string> Utf8Text::shareBytes() const {
+	return m_bytes;
+}
+
+const std::string& Utf8Text::getBytes() const {
+	return *m_bytes;
+}
+
+std::string Utf8Text::encode(const TextFormat& _format) const {
+	std::string result;
+	if (_format.HasBom) {
+		result.append("\xEF\xBB\xBF");
+	}
+	appendWithLineEnding(m_bytes->data(), m_bytes->size(), _format.Ending, result);
+	return result;
+}
+
+const size_t& Utf8Text::getUnchangedPrefix() const {
+	return m_unchangedPrefix;
+}
+
+const size_t& Utf8Text::getUnchangedSuffix() const {
+	return m_unchangedSuffix;
+}
+
+void Utf8Text::noteEdit(const size_t& _byte, const size_t& _erasedBytes) {
+	m_unchangedPrefix = std::min(m_unchangedPrefix, _byte);
+	m_unchangedSuffix = std::min(m_unchangedSuffix, m_bytes->size() - _byte - _erasedBytes);
+}
+
+void Utf8Text::reserve(const size_t& _bytes) {
+	mutableBytes().reserve(_bytes);
+	m_index.reserve(_bytes / UTF8_TEXT_INDEX_STRIDE + 1);
+}
+
+void Utf8Text::insert(const size_t& _at, const wchar_t& _ch) {
+	const size_t at = std::min(_at, m_size);
+	char encoded[4];
+	const size_t length = encodeCodepoint((unsigned int)_ch, encoded);
+	const size_t entry = (at == m_size ? m_index.size() - 1 : findEntry(at));
+	const size_t byte = getByteOffset(at);
+	noteEdit(byte, 0);
+	mutableBytes().insert(byte, encoded, length);
+	shiftEntries(entry, 1, (long long)length);
+	m_size++;
+	resetCache();
+	size_t byteEnd = 0;
+	if (getEntryEnd(entry, byteEnd) - m_index[entry].Codepoint > 2 * UTF8_TEXT_INDEX_STRIDE) {
+		const size_t splitAt = m_index[entry].Codepoint + UTF8_TEXT_INDEX_STRIDE;
+		const size_t splitByte = getByteOffset(splitAt);
+		m_index.insert(m_index.begin() + entry + 1, IndexEntry{ splitAt, splitByte });
+		resetCache();
+	}
+}
+
+void Utf8Text::erase(const size_t& _at) {
+	if (_at >= m_size) {
+		return;
+	}
+	const size_t entry = findEntry(_at);
+	const size_t byte = getByteOffset(_at);
+	const size_t length = sequenceLength((unsigned char)(*m_bytes)[byte]);
+	noteEdit(byte, length);
+	mutableBytes().erase(byte, length);
+	shiftEntries(entry, -1, -(long long)length);
+	m_size--;
+	// an emptied chunk now starts where the next one does
+	if (entry + 1 < m_index.size() && m_index[entry + 1].Codepoint == m_index[entry].Codepoint) {
+		m_index.erase(m_index.begin() + entry + 1);
+	}
+	else if (entry + 1 == m_index.size() && entry > 0 && m_index[entry].Codepoint == m_size) {
+		m_index.pop_back();
+	}
+	resetCache();
+}
+
+void Utf8Text::pop_back() {
+	if (m_size > 0) {
+		erase(m_size - 1);
+	}
+}
+
+void Utf8Text::append(const Utf8Text& _other, const size_t& _from, const size_t& _count) {
+	const size_t from = std::min(_from, _other.m_size);
+	const size_t to = from + std::min(_count, _other.m_size - from);
+	if (from == to) {
+		return;
+	}
+	const size_t byteFrom = _other.getByteOffset(from);
+	noteEdit(m_bytes->size(), 0);
+	mutableBytes().append(*_other.m_bytes, byteFrom, _other.getByteOffset(to) - byteFrom);
+	indexFrom(m_index.size() - 1);
+}
+
+void Utf8Text::append(const std::wstring& _text) {
+	if (_text.empty()) {
+		return;
+	}
+	noteEdit(m_bytes->size(), 0);
+	mutableBytes().append(encodeUtf8(_text));
+	indexFrom(m_index.size() - 1);
+}
+
+// _bytes must already be well formed, e.g. the output of normalizeUtf8
+void Utf8Text::appendUtf8(const std::string& _bytes) {
+	if (_bytes.empty()) {
+		return;
+	}
+	noteEdit(m_bytes->size(), 0);
+	mutableBytes().append(_bytes);
+	indexFrom(m_index.size() - 1);
+}
+
+void Utf8Text::swap(Utf8Text& _other) {
+	m_bytes.swap(_other.m_bytes);
+	m_index.swap(_other.m_index);
+	std::swap(m_size, _other.m_size);
+	std::swap(m_unchangedPrefix, _other.m_unchangedPrefix);
+	std::swap(m_unchangedSuffix, _other.m_unchangedSuffix);
+	resetCache();
+	_other.resetCache();
+}
+
+// from here on the whole text counts as unchanged, e.g. right after it was loaded or saved
+void Utf8Text::resetChangeTracking() {
+	m_unchangedPrefix = m_bytes->size();
+	m_unchangedSuffix = m_bytes->size();
+}
+
+void Utf8Text::limitUnchanged(const size_t& _prefix, const size_t& _suffix) {
+	m_unchangedPrefix = std::min(m_unchangedPrefix, _prefix);
+	m_unchangedSuffix = std::min(m_unchangedSuffix, _suffix);
+}
+
+// the edits are in order and do not overlap; every byte after the first one moves once, in place,
+// and only the index between the first and the last edit is rebuilt, the entries after it are shifted
+void Utf8Text::applyEdits(const std::vector<TextEdit>& _edits) {
+	if (_edits.empty()) {
+		return;
+	}
+	struct Splice {
+		size_t From;
+		size_t To;
+		std::string Bytes;
+		long long Shift;
+	};
+	std::vector<Splice> splices;
+	splices.reserve(_edits.size());
+	long long growth = 0;
+	for (const TextEdit& edit : _edits) {
+		Splice splice{ getByteOffset(edit.Offset), getByteOffset(edit.Offset + edit.EraseCount), encodeUtf8(edit.Text), 0 };
+		growth += (long long)splice.Bytes.size() - (long long)(splice.To - splice.From);
+		// how far the unchanged bytes after this edit move
+		splice.Shift = growth;
+		splices.push_back(std::move(splice));
+	}
+	const size_t firstEntry = findEntry(_edits.front().Offset);
+	const size_t lastEntry = findEntry(_edits.back().Offset + _edits.back().EraseCount);
+	noteEdit(splices.front().From, splices.back().To - splices.front().From);
+	std::string& bytes = mutableBytes();
+	const size_t oldSize = bytes.size();
+	const size_t newSize = size_t((long long)oldSize + growth);
+	if (newSize > oldSize) {
+		bytes.resize(newSize);
+	}
+	// the bytes moving left go front to back and the ones moving right back to front,
+	// that way no segment lands on one that has not moved yet
+	auto moveSegment = [&](const size_t& i) {
+		const size_t from = splices[i].To;
+		const size_t to = (i + 1 < splices.size() ? splices[i + 1].From : oldSize);
+		if (to > from) {
+			std::memmove(bytes.data() + size_t((long long)from + splices[i].Shift), bytes.data() + from, to - from);
+		}
+	};
+	for (size_t i = 0; i < splices.size(); i++) {
+		if (splices[i].Shift < 0) {
+			moveSegment(i);
+		}
+	}
+	for (size_t i = splices.size(); i-- > 0;) {
+		if (splices[i].Shift > 0) {
+			moveSegment(i);
+		}
+	}
+	long long shift = 0;
+	for (const Splice& splice : splices) {
+		std::memcpy(bytes.data() + size_t((long long)splice.From + shift), splice.Bytes.data(), splice.Bytes.size());
+		shift = splice.Shift;
+	}
+	if (newSize < oldSize) {
+		bytes.resize(newSize);
+	}
+	std::vector<IndexEntry> kept(m_index.begin() + lastEntry + 1, m_index.end());
+	if (kept.empty()) {
+		indexFrom(firstEntry);
+		return;
+	}
+	const size_t keptCodepoint = kept.front().Codepoint;
+	for (IndexEntry& entry : kept) {
+		entry.Byte = size_t((long long)entry.Byte + growth);
+	}
+	const long long codepoints = (long long)indexBetween(firstEntry, kept.front().Byte) - (long long)keptCodepoint;
+	for (IndexEntry& entry : kept) {
+		entry.Codepoint = size_t((long long)entry.Codepoint + codepoints);
+	}
+	m_index.insert(m_index.end(), kept.begin(), kept.end());
+	m_size = size_t((long long)m_size + codepoints);
+	resetCache();
+}